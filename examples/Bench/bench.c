@@ -0,0 +1,338 @@
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Throughput benchmark of the extraction engine. Synthetic archives are generated in memory with the creator, then
+ * pushed into the engine in chunks of several sizes, from 1 byte to 1 MiB, with callbacks doing nothing (the cost of
+ * the parser alone), reading every data byte (the cost a real consumer would at least pay), or doing nothing with
+ * small files delivered in batches.
+ * For each profile, chunk size and callback kind it prints MB/s and headers/s.
+ */
+#include "tarStreamCreator.h"
+#include "tarStreamExtractor.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* an archive built in memory */
+typedef struct
+{
+    uint8_t *data;
+    size_t   size;
+    size_t   cap;
+    unsigned members;
+} archive_t;
+
+/* a synthetic archive */
+typedef struct
+{
+    const char *name;
+    const char *descr;
+    void (*build)(tarStrCr_t *cr, archive_t *ar);
+} profile_t;
+
+/* largest batch of small files (see tarStrEx_set_batchCallback()) */
+#define BATCH_MAX 256
+
+static static_tarStrCr_t static_tarCr;
+static static_tarStrEx_t static_seTar;
+static uint8_t           fileData[1024 * 1024];
+static volatile uint64_t sink; /* keeps the reading callback from being optimized away */
+static tarStrEx_member_t batchMembers[BATCH_MAX];
+static char              batchNames[BATCH_MAX * 64];
+
+static int emit(void *param, const uint8_t *data, size_t dataSz)
+{
+    archive_t *ar = (archive_t *)param;
+    if (ar->size + dataSz > ar->cap)
+    {
+        ar->cap  = 2 * (ar->size + dataSz);
+        ar->data = realloc(ar->data, ar->cap);
+        if (NULL == ar->data)
+        {
+            return -1;
+        }
+    }
+    memcpy(&ar->data[ar->size], data, dataSz);
+    ar->size += dataSz;
+    return 0;
+}
+
+static void add_file(tarStrCr_t *cr, archive_t *ar, const char *name, uint64_t size, uint32_t owner)
+{
+    tarStrEx_entry_t entry = {.name = name, .size = size, .mode = 0644, .owner = owner, .type = TAR_TYPE_REG};
+    uint64_t         n;
+
+    tarStrCr_file_begin(cr, &entry);
+    for (; size > 0; size -= n)
+    {
+        n = (size < sizeof(fileData)) ? size : sizeof(fileData);
+        tarStrCr_file_data(cr, fileData, n);
+    }
+    tarStrCr_file_end(cr);
+    ar->members++;
+}
+
+static void add_dir(tarStrCr_t *cr, archive_t *ar, const char *name)
+{
+    tarStrEx_entry_t entry = {.name = name, .mode = 0755, .type = TAR_TYPE_DIR};
+    tarStrCr_file_begin(cr, &entry);
+    ar->members++;
+}
+
+/* many tiny files: headers dominate */
+static void build_tiny(tarStrCr_t *cr, archive_t *ar)
+{
+    char     name[64];
+    unsigned i;
+    for (i = 0; i < 50000; i++)
+    {
+        snprintf(name, sizeof(name), "tiny/file_%05u.txt", i);
+        add_file(cr, ar, name, 1 + (i * 37) % 600, 1000);
+    }
+}
+
+/* few huge files: data dominates */
+static void build_huge(tarStrCr_t *cr, archive_t *ar)
+{
+    char     name[64];
+    unsigned i;
+    for (i = 0; i < 4; i++)
+    {
+        snprintf(name, sizeof(name), "huge/blob_%u.bin", i);
+        add_file(cr, ar, name, 32 * 1024 * 1024 + i * 1000, 1000);
+    }
+}
+
+/* deep directory trees: long paths, split into ustar prefix and name */
+static void build_deep(tarStrCr_t *cr, archive_t *ar)
+{
+    char     path[TARSTEX_PATH_MAX];
+    size_t   len;
+    unsigned tree, depth, i;
+    for (tree = 0; tree < 200; tree++)
+    {
+        len = (size_t)snprintf(path, sizeof(path), "tree_%03u/", tree);
+        add_dir(cr, ar, path);
+        for (depth = 0; depth < 20; depth++)
+        {
+            len += (size_t)snprintf(&path[len], sizeof(path) - len, "level_%02u/", depth);
+            add_dir(cr, ar, path);
+            for (i = 0; i < 4; i++)
+            {
+                snprintf(&path[len], sizeof(path) - len, "f%u", i);
+                add_file(cr, ar, path, 2000, 1000);
+            }
+            path[len] = '\0';
+        }
+    }
+}
+
+/* every member with a PAX header: paths too long for ustar, ids too large for the octal fields */
+static void build_pax(tarStrCr_t *cr, archive_t *ar)
+{
+    char     name[TARSTEX_PATH_MAX];
+    unsigned i;
+    for (i = 0; i < 20000; i++)
+    {
+        snprintf(name, sizeof(name),
+                 "pax/a_single_directory_name_that_is_far_too_long_to_fit_the_ustar_prefix_field_of_the_header_"
+                 "of_a_tar_archive_and_so_forces_a_pax_extended_header_%05u/file_with_a_long_name_as_well_%05u.dat",
+                 i, i);
+        add_file(cr, ar, name, 1 + (i * 53) % 3000, 3000000 + i);
+    }
+}
+
+static const profile_t profiles[] = {
+    {"tiny", "50000 files of 1-600 bytes", build_tiny},
+    {"huge", "4 files of 32 MiB", build_huge},
+    {"deep", "200 trees 20 levels deep", build_deep},
+    {"pax", "20000 files with PAX headers", build_pax},
+};
+
+static const size_t chunkSizes[] = {1, 16, 512, 4096, 65535, 1024 * 1024};
+
+static int cb_fileInit(void *param, const char *path)
+{
+    (void)param;
+    (void)path;
+    return 0;
+}
+
+static int cb_dirCreate(void *param, const char *path)
+{
+    (void)param;
+    (void)path;
+    return 0;
+}
+
+static int cb_recvNoop(void *param, const uint8_t *data, size_t dataSz)
+{
+    (void)param;
+    (void)data;
+    (void)dataSz;
+    return 0;
+}
+
+static int cb_recvRead(void *param, const uint8_t *data, size_t dataSz)
+{
+    uint64_t sum = 0;
+    size_t   i;
+    (void)param;
+    for (i = 0; i < dataSz; i++)
+    {
+        sum += data[i];
+    }
+    sink += sum;
+    return 0;
+}
+
+static int cb_fileFinalize(void *param)
+{
+    (void)param;
+    return 0;
+}
+
+static int cb_batchNoop(void *param, const tarStrEx_member_t *members, size_t count)
+{
+    (void)param;
+    (void)members;
+    (void)count;
+    return 0;
+}
+
+/* how the callbacks consume the data */
+static const struct
+{
+    const char   *name;
+    cb_recvData_t recvData;
+    int           batched; /* small files are delivered in batches */
+} modes[] = {
+    {"noop", cb_recvNoop, 0},
+    {"read", cb_recvRead, 0},
+    {"batch", cb_recvNoop, 1},
+};
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief extract the archive once, pushing chunkSz bytes at a time
+ * process_data is used up to its 64 KiB limit, process_buffer beyond
+ */
+static int run_once(const archive_t *ar, size_t chunkSz, cb_recvData_t recvData, int batched)
+{
+    tarStrEx_t *tar;
+    size_t      i, n;
+    int         res = TARSTEX_ESUCCESS;
+
+    tarStrEx_init(&static_seTar, &tar, NULL, cb_fileInit, cb_dirCreate, recvData, cb_fileFinalize);
+    if (batched)
+    {
+        tarStrEx_set_batchCallback(tar, cb_batchNoop, batchMembers, BATCH_MAX, batchNames, sizeof(batchNames));
+    }
+    for (i = 0; (i < ar->size) && (TARSTEX_ESUCCESS == res); i += n)
+    {
+        n = (ar->size - i < chunkSz) ? ar->size - i : chunkSz;
+        res = (n <= UINT16_MAX) ? tarStrEx_process_data(tar, &ar->data[i], (uint16_t)n)
+                                : tarStrEx_process_buffer(tar, &ar->data[i], n);
+    }
+    if (TARSTEX_ESUCCESS == res)
+    {
+        res = tarStrEx_finalize(tar);
+    }
+    return res;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *only    = NULL;
+    double      minTime = 0.5;
+    archive_t   ar;
+    tarStrCr_t *cr;
+    double      t0, elapsed;
+    unsigned    p, c, k, runs;
+    int         opt;
+
+    while ((opt = getopt(argc, argv, "p:t:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'p':
+            only = optarg;
+            break;
+        case 't':
+            minTime = atof(optarg);
+            break;
+        default:
+            fprintf(stderr, "Use: %s [-p tiny|huge|deep|pax] [-t min_seconds_per_run]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    for (k = 0; k < sizeof(fileData); k++)
+    {
+        fileData[k] = (uint8_t)(k * 131 + 7);
+    }
+
+    printf("%-5s %-8s %8s %10s %12s\n", "arch", "recvData", "chunk", "MB/s", "headers/s");
+    for (p = 0; p < sizeof(profiles) / sizeof(profiles[0]); p++)
+    {
+        if ((NULL != only) && (0 != strcmp(only, profiles[p].name)))
+        {
+            continue;
+        }
+        memset(&ar, 0, sizeof(ar));
+        tarStrCr_init(&static_tarCr, &cr, &ar, emit);
+        profiles[p].build(cr, &ar);
+        if ((TARSTEX_ESUCCESS != tarStrCr_finalize(cr)) || (NULL == ar.data))
+        {
+            fprintf(stderr, "Error generating the %s archive\n", profiles[p].name);
+            return EXIT_FAILURE;
+        }
+        printf("# %s: %s, %u members, %.1f MB\n", profiles[p].name, profiles[p].descr, ar.members, ar.size / 1e6);
+
+        for (k = 0; k < sizeof(modes) / sizeof(modes[0]); k++)
+        {
+            for (c = 0; c < sizeof(chunkSizes) / sizeof(chunkSizes[0]); c++)
+            {
+                /* repeat the extraction until the run is long enough to be measured */
+                runs = 0;
+                t0   = now();
+                do
+                {
+                    if (TARSTEX_ESUCCESS != run_once(&ar, chunkSizes[c], modes[k].recvData, modes[k].batched))
+                    {
+                        fprintf(stderr, "Extraction of the %s archive failed\n", profiles[p].name);
+                        return EXIT_FAILURE;
+                    }
+                    runs++;
+                    elapsed = now() - t0;
+                } while (elapsed < minTime);
+                printf("%-5s %-8s %8zu %10.1f %12.0f\n", profiles[p].name, modes[k].name, chunkSizes[c],
+                       runs * (ar.size / 1e6) / elapsed, runs * ar.members / elapsed);
+                fflush(stdout);
+            }
+        }
+        free(ar.data);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,174 @@
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * This example creates a tar archive, written to the standard output, out of the files and directories given on the
+ * command line (directories are walked recursively). File data is read in large chunks and handed to the creator,
+ * which passes it on to the output with no copies.
+ */
+#include "tarStreamCreator.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define READ_SZ (1024 * 1024)
+
+static static_tarStrCr_t static_tarCr;
+static uint8_t           readBuff[READ_SZ];
+
+static int emit(void *param, const uint8_t *data, size_t dataSz)
+{
+    return (fwrite(data, 1, dataSz, (FILE *)param) == dataSz) ? 0 : -1;
+}
+
+static int add_path(tarStrCr_t *cr, const char *path);
+
+static int add_dir(tarStrCr_t *cr, const char *path)
+{
+    char           child[TARSTEX_PATH_MAX];
+    DIR           *dir = opendir(path);
+    struct dirent *de;
+    int            res = TARSTEX_ESUCCESS;
+
+    if (NULL == dir)
+    {
+        perror(path);
+        return TARSTEX_EFAILURE;
+    }
+    while ((TARSTEX_ESUCCESS == res) && (NULL != (de = readdir(dir))))
+    {
+        if ((0 == strcmp(de->d_name, ".")) || (0 == strcmp(de->d_name, "..")))
+        {
+            continue;
+        }
+        if (snprintf(child, sizeof(child), "%s/%s", path, de->d_name) >= (int)sizeof(child))
+        {
+            fprintf(stderr, "%s/%s: path too long\n", path, de->d_name);
+            res = TARSTEX_ETOOLONG;
+            break;
+        }
+        res = add_path(cr, child);
+    }
+    closedir(dir);
+    return res;
+}
+
+static int add_path(tarStrCr_t *cr, const char *path)
+{
+    char             name[TARSTEX_PATH_MAX];
+    char             target[TARSTEX_PATH_MAX];
+    struct stat      st;
+    tarStrEx_entry_t entry = {0};
+    ssize_t          n;
+    int              fd, res;
+
+    if (0 != lstat(path, &st))
+    {
+        perror(path);
+        return TARSTEX_EFAILURE;
+    }
+    entry.name  = name;
+    entry.mtime = (int64_t)st.st_mtime;
+    entry.mode  = st.st_mode & 07777;
+    entry.owner = st.st_uid;
+    entry.group = st.st_gid;
+    snprintf(name, sizeof(name), "%s", path);
+
+    if (S_ISDIR(st.st_mode))
+    {
+        entry.type = TAR_TYPE_DIR;
+        if (snprintf(name, sizeof(name), "%s/", path) >= (int)sizeof(name))
+        {
+            return TARSTEX_ETOOLONG;
+        }
+        res = tarStrCr_file_begin(cr, &entry);
+        return (TARSTEX_ESUCCESS == res) ? add_dir(cr, path) : res;
+    }
+    if (S_ISLNK(st.st_mode))
+    {
+        n = readlink(path, target, sizeof(target) - 1);
+        if (n < 0)
+        {
+            perror(path);
+            return TARSTEX_EFAILURE;
+        }
+        target[n]      = '\0';
+        entry.type     = TAR_TYPE_SYM;
+        entry.linkname = target;
+        return tarStrCr_file_begin(cr, &entry);
+    }
+    if (!S_ISREG(st.st_mode))
+    {
+        fprintf(stderr, "%s: unsupported file type, skipped\n", path);
+        return TARSTEX_ESUCCESS;
+    }
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        perror(path);
+        return TARSTEX_EFAILURE;
+    }
+    entry.type = TAR_TYPE_REG;
+    entry.size = (uint64_t)st.st_size;
+    res        = tarStrCr_file_begin(cr, &entry);
+    while ((TARSTEX_ESUCCESS == res) && ((n = read(fd, readBuff, sizeof(readBuff))) > 0))
+    {
+        res = tarStrCr_file_data(cr, readBuff, (size_t)n);
+    }
+    close(fd);
+    if (TARSTEX_ESUCCESS == res)
+    {
+        res = tarStrCr_file_end(cr); /* fails if the file has been truncated meanwhile */
+    }
+    if (TARSTEX_ESUCCESS != res)
+    {
+        fprintf(stderr, "%s: error %d\n", path, res);
+    }
+    return res;
+}
+
+int main(int argc, char *argv[])
+{
+    tarStrCr_t *cr;
+    int         i;
+    int         res = TARSTEX_ESUCCESS;
+
+    if (argc < 2)
+    {
+        fprintf(stderr, "Use: %s <path>... > archive.tar\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    tarStrCr_init(&static_tarCr, &cr, stdout, emit);
+    for (i = 1; (i < argc) && (TARSTEX_ESUCCESS == res); i++)
+    {
+        res = add_path(cr, argv[i]);
+    }
+    if (TARSTEX_ESUCCESS == res)
+    {
+        res = tarStrCr_finalize(cr);
+    }
+    if ((TARSTEX_ESUCCESS != res) || (0 != fflush(stdout)))
+    {
+        fprintf(stderr, "Archive creation failed (%d)\n", res);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
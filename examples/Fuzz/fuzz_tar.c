@@ -0,0 +1,289 @@
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * libFuzzer harness of the extraction engine. The first two bytes of the input select the options and seed the sizes
+ * of the chunks; the rest is the archive, pushed in chunks of varying size so that headers, extended headers and
+ * sparse maps straddle process calls. Depending on the options members are skipped (and jumped over with
+ * tarStrEx_skip()), sparse files and batches are enabled, file data is moved by the harness itself
+ * (tarStrEx_payload_consumed()), fileFinalize fails, and after every chunk the engine is checkpointed and restored
+ * into a fresh state, which goes on from the restored offset. The callbacks check that the engine keeps its promises:
+ * data only within an open file, never more than its size, finalize only after init, resumed files where they were
+ * left, a failing fileFinalize reported at the end whichever way the data came. Any broken promise aborts.
+ */
+#include "tarStreamExtractor.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define OPT_SKIP       0x01 /* skip every other file */
+#define OPT_SPARSE     0x02 /* restore sparse files through recvDataAt */
+#define OPT_BATCH      0x04 /* deliver small files in batches */
+#define OPT_CHECKPOINT 0x08 /* checkpoint and restore after every chunk */
+#define OPT_FILTER     0x10 /* extract only the members whose path does not start with 's' */
+#define OPT_FINFAIL    0x20 /* fileFinalize fails */
+#define OPT_MOVE       0x40 /* file data is moved by the harness (TARSTEX_CB_PASSTHROUGH) */
+
+#define BLOCK_SZ    (512)
+#define MAX_CHUNK   (4096)
+#define EXT_NUM     (16)
+#define BATCH_NUM   (8)
+#define BATCH_NAMES (2 * TARSTEX_PATH_MAX)
+
+#define CHECK(cond)                                                                                                    \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if (!(cond))                                                                                                   \
+        {                                                                                                              \
+            abort();                                                                                                   \
+        }                                                                                                              \
+    } while (0)
+
+typedef struct
+{
+    unsigned opts;
+    unsigned files;     /* files seen by fileInit, to skip every other one */
+    int      open;      /* a file is being received */
+    int      sparse;    /* the open file is sparse */
+    uint64_t size;      /* size of the open file */
+    uint64_t received;  /* bytes of the open file received through recvData */
+    int      truncated; /* the archive ended early: tarStrEx_finalize() closes the open file as it is */
+    int      finFailed; /* a fileFinalize failed */
+    uint8_t  sum;       /* all bytes delivered are read, for the sanitizer to see them */
+} fuzzState_t;
+
+static static_tarStrEx_t static_seTar[2];
+static tarStrEx_extent_t sparseMap[EXT_NUM];
+static tarStrEx_member_t members[BATCH_NUM];
+static char              names[BATCH_NAMES];
+
+static void touch(fuzzState_t *st, const uint8_t *data, size_t dataSz)
+{
+    size_t i;
+
+    for (i = 0; i < dataSz; i++)
+    {
+        st->sum ^= data[i];
+    }
+}
+
+static int fuzz_fileInitEx(void *param, const tarStrEx_entry_t *entry)
+{
+    fuzzState_t *st = (fuzzState_t *)param;
+
+    CHECK(!st->open);
+    CHECK(strlen(entry->name) < TARSTEX_PATH_MAX);
+    if ((0 != (st->opts & OPT_SKIP)) && (0 != (st->files++ & 1)))
+    {
+        return TARSTEX_CB_SKIP;
+    }
+    st->open     = 1;
+    st->sparse   = (TAR_TYPE_SPARSE == entry->type) && (0 != (st->opts & OPT_SPARSE));
+    st->size     = entry->size;
+    st->received = 0;
+    return ((0 != (st->opts & OPT_MOVE)) && (TAR_TYPE_REG == entry->type)) ? TARSTEX_CB_PASSTHROUGH : 0;
+}
+
+static int fuzz_dirCreate(void *param, const char *path)
+{
+    fuzzState_t *st = (fuzzState_t *)param;
+
+    CHECK(!st->open);
+    CHECK(strlen(path) < TARSTEX_PATH_MAX);
+    return 0;
+}
+
+static int fuzz_recvData(void *param, const uint8_t *data, size_t dataSz)
+{
+    fuzzState_t *st = (fuzzState_t *)param;
+
+    CHECK(st->open && !st->sparse);
+    CHECK(dataSz <= st->size - st->received);
+    touch(st, data, dataSz);
+    st->received += dataSz;
+    return 0;
+}
+
+static int fuzz_recvDataAt(void *param, uint64_t fileOffset, const uint8_t *data, size_t dataSz)
+{
+    fuzzState_t *st = (fuzzState_t *)param;
+
+    CHECK(st->open && st->sparse);
+    CHECK((fileOffset <= st->size) && (dataSz <= st->size - fileOffset));
+    touch(st, data, dataSz);
+    return 0;
+}
+
+static int fuzz_fileFinalize(void *param)
+{
+    fuzzState_t *st = (fuzzState_t *)param;
+
+    CHECK(st->open);
+    CHECK(st->sparse || st->truncated || (st->received == st->size));
+    st->open = 0;
+    if (0 != (st->opts & OPT_FINFAIL))
+    {
+        st->finFailed = 1;
+        return -1;
+    }
+    return 0;
+}
+
+static int fuzz_link(void *param, const tarStrEx_entry_t *entry)
+{
+    fuzzState_t *st = (fuzzState_t *)param;
+
+    CHECK(!st->open);
+    /* a link header may have no target (see cb_link_t) */
+    CHECK((NULL == entry->linkname) || ('\0' != entry->linkname[0]));
+    CHECK((NULL == entry->linkname) || (strlen(entry->linkname) < TARSTEX_PATH_MAX));
+    return 0;
+}
+
+static int fuzz_batch(void *param, const tarStrEx_member_t *batch, size_t count)
+{
+    fuzzState_t *st = (fuzzState_t *)param;
+    size_t       i;
+
+    CHECK(!st->open);
+    CHECK((0 != count) && (count <= BATCH_NUM));
+    for (i = 0; i < count; i++)
+    {
+        CHECK(strlen(batch[i].entry.name) < TARSTEX_PATH_MAX);
+        touch(st, batch[i].data, (size_t)batch[i].entry.size);
+    }
+    return 0;
+}
+
+static int fuzz_resume(void *param, const tarStrEx_entry_t *entry, uint64_t delivered)
+{
+    fuzzState_t *st = (fuzzState_t *)param;
+
+    /* the state of the callbacks is kept across the restore: the file must be the one left open */
+    CHECK(st->open && !st->sparse);
+    CHECK((entry->size == st->size) && (delivered == st->received));
+    st->received = delivered;
+    return 0;
+}
+
+static int fuzz_filter(const void *ctx, const char *path)
+{
+    (void)ctx;
+    return 's' != path[0];
+}
+
+static tarStrEx_t *fuzz_init(static_tarStrEx_t *static_seTar, fuzzState_t *st)
+{
+    tarStrEx_t *seTar;
+
+    tarStrEx_init(static_seTar, &seTar, st, NULL, fuzz_dirCreate, fuzz_recvData, fuzz_fileFinalize);
+    tarStrEx_set_fileInitEx(seTar, fuzz_fileInitEx);
+    tarStrEx_set_linkCallback(seTar, fuzz_link);
+    if (0 != (st->opts & OPT_SPARSE))
+    {
+        tarStrEx_set_sparse(seTar, fuzz_recvDataAt, sparseMap, EXT_NUM);
+    }
+    if (0 != (st->opts & OPT_BATCH))
+    {
+        tarStrEx_set_batchCallback(seTar, fuzz_batch, members, BATCH_NUM, names, sizeof(names));
+    }
+    if (0 != (st->opts & OPT_FILTER))
+    {
+        tarStrEx_set_filter(seTar, fuzz_filter, NULL);
+    }
+    return seTar;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    tarStrEx_checkpoint_t cp;
+    fuzzState_t           st = {0};
+    tarStrEx_t           *seTar;
+    tarStrEx_t           *restored;
+    unsigned              cur = 0;
+    uint32_t              seed;
+    size_t                off = 0;
+    size_t                n;
+    uint64_t              skip, pending;
+    int                   res = TARSTEX_ESUCCESS;
+
+    if (size < 2)
+    {
+        return 0;
+    }
+    st.opts = data[0];
+    seed    = data[1];
+    data += 2;
+    size -= 2;
+
+    seTar = fuzz_init(&static_seTar[cur], &st);
+    while ((TARSTEX_ESUCCESS == res) && (off < size) && !tarStrEx_complete(seTar))
+    {
+        skip    = tarStrEx_skippable(seTar);
+        pending = tarStrEx_payload_pending(seTar, NULL);
+        if (0 != skip)
+        {
+            n   = (skip < size - off) ? (size_t)skip : size - off;
+            res = tarStrEx_skip(seTar, n);
+        }
+        else if (0 != pending)
+        {
+            /* moved as a splice would, a failing fileFinalize included */
+            n = (pending < size - off) ? (size_t)pending : size - off;
+            CHECK(st.open && (n <= st.size - st.received));
+            touch(&st, data + off, n);
+            st.received += n;
+            CHECK(TARSTEX_ESUCCESS == tarStrEx_payload_consumed(seTar, n));
+        }
+        else
+        {
+            seed = seed * 1103515245u + 12345u;
+            n    = 1 + (seed >> 16) % MAX_CHUNK;
+            if (0 != (seed & 0x8000))
+            {
+                n = BLOCK_SZ * (1 + n / BLOCK_SZ); /* whole blocks keep headers at chunk boundaries, for batches */
+            }
+            n    = (n < size - off) ? n : size - off;
+            res  = tarStrEx_process_buffer(seTar, data + off, n);
+        }
+        if (TARSTEX_ESUCCESS != res)
+        {
+            break;
+        }
+        off += n;
+        CHECK(tarStrEx_offset(seTar) == off);
+        if ((0 != (st.opts & OPT_CHECKPOINT)) &&
+            (TARSTEX_ESUCCESS == tarStrEx_checkpoint(seTar, &cp)))
+        {
+            /* the engine must go on from the restored state as if nothing happened */
+            restored = fuzz_init(&static_seTar[cur ^ 1], &st);
+            CHECK(TARSTEX_ESUCCESS == tarStrEx_restore(restored, &cp, fuzz_resume));
+            CHECK(tarStrEx_offset(restored) <= off);
+            off   = (size_t)tarStrEx_offset(restored);
+            seTar = restored;
+            cur ^= 1;
+        }
+    }
+    if (TARSTEX_ESUCCESS == res)
+    {
+        st.truncated = 1;
+        res          = tarStrEx_finalize(seTar);
+        CHECK(!st.open); /* every file initialized is finalized, wherever the archive ends */
+        CHECK((TARSTEX_ESUCCESS != res) == st.finFailed);
+    }
+    return 0;
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Runs the fuzz harness once over every file given on the command line, e.g. to replay a crash or a corpus with a
+ * compiler that has no libFuzzer.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define INPUT_MAX (16 * 1024 * 1024)
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+static uint8_t input[INPUT_MAX];
+
+int main(int argc, char *argv[])
+{
+    FILE  *f;
+    size_t size;
+    int    i;
+
+    for (i = 1; i < argc; i++)
+    {
+        f = fopen(argv[i], "rb");
+        if (NULL == f)
+        {
+            perror(argv[i]);
+            return EXIT_FAILURE;
+        }
+        size = fread(input, 1, sizeof(input), f);
+        fclose(f);
+        LLVMFuzzerTestOneInput(input, size);
+    }
+    printf("%d inputs run\n", argc - 1);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,318 @@
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * This example serves many connections at once with a few threads (see tarStreamServer.h), the engine states being
+ * taken from a pool (see tarStreamPool.h). The same tar file is sent on every connection, each one from its own
+ * thread and in blocks of random size, through a pair of connected sockets; every connection computes the MD5 digest
+ * of the files it receives. Once all of them are over, the digests must be the same on every connection: those of the
+ * first one are printed, in the format of the Tar2Md5 example.
+ */
+#include "tarStreamDigest.h"
+#include "tarStreamExtractor.h"
+#include "tarStreamPool.h"
+#include "tarStreamServer.h"
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#define MAX_CONNS (64)
+#define RECV_SZ   (16 * 1024)
+
+typedef struct userTarStruct
+{
+    FILE       *out;  /* listing of the connection */
+    char       *text; /* listing, once out is closed */
+    size_t      textSz;
+    char        path[TARSTEX_PATH_MAX];
+    uint64_t    fsz;
+    tarStrDig_t dig;
+    int         res; /* outcome reported by the done callback */
+} userTarStruct_t;
+
+/* sending side of a connection */
+typedef struct sender
+{
+    int            fd;
+    const uint8_t *data;
+    size_t         dataSz;
+    unsigned       seed;
+    int            running; /* the thread has been started */
+    pthread_t      id;
+} sender_t;
+
+/* callbacks */
+static int fileInit(userTarStruct_t *, const char *path);
+static int dirCreate(userTarStruct_t *, const char *path);
+static int recvData(userTarStruct_t *, const uint8_t *data, size_t dataSz);
+static int fileFinalize(userTarStruct_t *);
+static int linkCreate(userTarStruct_t *, const tarStrEx_entry_t *entry);
+
+static tarStrPool_slot_t slots[MAX_CONNS];
+static tarStrPool_t      pool;
+static tarStrSrv_conn_t  conns[MAX_CONNS];
+static tarStrSrv_t       srv;
+static uint8_t           recvMem[TARSTRSRV_MAX_THREADS * RECV_SZ];
+static userTarStruct_t   usrPar[MAX_CONNS];
+static sender_t          senders[MAX_CONNS];
+
+static pthread_mutex_t doneLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  doneCond = PTHREAD_COND_INITIALIZER;
+static unsigned        nDone;
+static unsigned        nAdded; /* connections added, the next one is given usrPar[nAdded] */
+
+static int conn_open(void *param, int fd, static_tarStrEx_t *ctx, tarStrEx_t **tar, void **connParam)
+{
+    /* called by tarStrSrv_add(): the slot of the pool may have served an earlier connection, the record is new */
+    userTarStruct_t *usr = &usrPar[nAdded];
+
+    usr->out = open_memstream(&usr->text, &usr->textSz);
+    if (NULL == usr->out)
+    {
+        return -1;
+    }
+    tarStrEx_init(ctx, tar, usr, (cb_fileInit_t)fileInit, (cb_dirCreate_t)dirCreate, (cb_recvData_t)recvData,
+                  (cb_fileFinalize_t)fileFinalize);
+    tarStrEx_set_linkCallback(*tar, (cb_link_t)linkCreate);
+    tarStrEx_set_hash(*tar, &tarStrDig_md5, &usr->dig);
+    *connParam = usr;
+    return 0;
+}
+
+static void conn_done(void *param, int fd, void *connParam, int res)
+{
+    userTarStruct_t *usr = (userTarStruct_t *)connParam;
+
+    fclose(usr->out);
+    usr->res = res;
+    pthread_mutex_lock(&doneLock);
+    nDone++;
+    pthread_cond_signal(&doneCond);
+    pthread_mutex_unlock(&doneLock);
+}
+
+/**
+ * @brief sending thread: write the archive to the socket in blocks of random size
+ *
+ * @param arg sender
+ * @return NULL
+ */
+static void *send_main(void *arg)
+{
+    sender_t *snd = (sender_t *)arg;
+    size_t    off = 0;
+    size_t    block_size;
+    ssize_t   len;
+
+    while (off < snd->dataSz)
+    {
+        block_size = 90 + rand_r(&snd->seed) % (RECV_SZ - 90 + 1);
+        if (block_size > snd->dataSz - off)
+        {
+            block_size = snd->dataSz - off;
+        }
+        /* the server closes the connection once the end of the archive is reached: the padding may not be read */
+        len = send(snd->fd, snd->data + off, block_size, MSG_NOSIGNAL);
+        if (len < 0)
+        {
+            break;
+        }
+        off += (size_t)len;
+    }
+    close(snd->fd);
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned    nThreads = 4;
+    unsigned    nConns   = 16;
+    unsigned    started  = 0;
+    unsigned    failed   = 0;
+    struct stat st;
+    uint8_t    *base;
+    unsigned    i;
+    int         sv[2];
+    int         opt;
+
+    while (-1 != (opt = getopt(argc, argv, "t:c:")))
+    {
+        switch (opt)
+        {
+        case 't':
+            nThreads = atoi(optarg);
+            break;
+        case 'c':
+            nConns = atoi(optarg);
+            break;
+        default:
+            optind = argc; /* print the usage */
+            break;
+        }
+    }
+    if ((optind + 1 != argc) || (0 == nThreads) || (nThreads > TARSTRSRV_MAX_THREADS) || (0 == nConns) ||
+        (nConns > MAX_CONNS))
+    {
+        fprintf(stderr, "Use: %s [-t <n_threads>] [-c <n_connections>] <nome_file>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int fd = open(argv[optind], O_RDONLY);
+    if (fd < 0)
+    {
+        perror("Error opening file");
+        return EXIT_FAILURE;
+    }
+    if ((0 != fstat(fd, &st)) || (0 == st.st_size))
+    {
+        fprintf(stderr, "Error reading file size\n");
+        close(fd);
+        return EXIT_FAILURE;
+    }
+    base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (MAP_FAILED == base)
+    {
+        perror("Error mapping file");
+        return EXIT_FAILURE;
+    }
+
+    tarStrPool_init(&pool, slots, nConns);
+    tarStrSrv_cfg_t cfg = {
+        .nThreads = nThreads,
+        .pool     = &pool,
+        .bufMem   = recvMem,
+        .bufSz    = RECV_SZ,
+        .open     = conn_open,
+        .done     = conn_done,
+        .param    = NULL,
+    };
+    if (TARSTEX_ESUCCESS != tarStrSrv_init(&srv, &cfg, conns))
+    {
+        fprintf(stderr, "Error starting the server\n");
+        return EXIT_FAILURE;
+    }
+
+    for (i = 0; i < nConns; i++)
+    {
+        if (0 != socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv))
+        {
+            perror("Error creating the connection");
+            break;
+        }
+        if (TARSTEX_ESUCCESS != tarStrSrv_add(&srv, sv[0]))
+        {
+            fprintf(stderr, "Error adding the connection\n");
+            close(sv[0]);
+            close(sv[1]);
+            break;
+        }
+        nAdded++;
+        senders[i] = (sender_t){.fd = sv[1], .data = base, .dataSz = st.st_size, .seed = i + 1};
+        if (0 != pthread_create(&senders[i].id, NULL, send_main, &senders[i]))
+        {
+            close(sv[1]); /* the server sees the connection closed, and reports it */
+            break;
+        }
+        senders[i].running = 1;
+    }
+    started = nAdded;
+
+    /* every connection added is reported once by the done callback */
+    pthread_mutex_lock(&doneLock);
+    while (nDone < started)
+    {
+        pthread_cond_wait(&doneCond, &doneLock);
+    }
+    pthread_mutex_unlock(&doneLock);
+    for (i = 0; i < started; i++)
+    {
+        if (senders[i].running)
+        {
+            pthread_join(senders[i].id, NULL);
+        }
+    }
+    tarStrSrv_stop(&srv);
+    munmap(base, st.st_size);
+
+    for (i = 0; i < started; i++)
+    {
+        if ((TARSTEX_ESUCCESS != usrPar[i].res) || (usrPar[i].textSz != usrPar[0].textSz) ||
+            (0 != memcmp(usrPar[i].text, usrPar[0].text, usrPar[0].textSz)))
+        {
+            fprintf(stderr, "connection %u failed (%d)\n", i, usrPar[i].res);
+            failed++;
+        }
+    }
+    if (started > 0)
+    {
+        fwrite(usrPar[0].text, 1, usrPar[0].textSz, stdout);
+    }
+    fprintf(stderr, "%u of %u connections ok, %u threads, pool high-water %zu of %zu\n", started - failed, nConns,
+            nThreads, tarStrPool_highWater(&pool), tarStrPool_size(&pool));
+    for (i = 0; i < started; i++)
+    {
+        free(usrPar[i].text);
+    }
+    return ((started == nConns) && (0 == failed)) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int fileInit(userTarStruct_t *userParam, const char *path)
+{
+    snprintf(userParam->path, sizeof(userParam->path), "%s", path);
+    userParam->fsz = 0;
+    return 0;
+}
+
+static int dirCreate(userTarStruct_t *userParam, const char *path)
+{
+    fprintf(userParam->out, "create dir %s\n", path);
+    return 0;
+}
+
+static int recvData(userTarStruct_t *userParam, const uint8_t *data, size_t dataSz)
+{
+    userParam->fsz += dataSz; /* the digest is computed by the engine */
+    return 0;
+}
+
+static int fileFinalize(userTarStruct_t *userParam)
+{
+    char   digestStr[TARSTRDIG_MAX_SZ * 2 + 1];
+    size_t i;
+
+    for (i = 0; i < userParam->dig.digestSz; i++)
+    {
+        sprintf(&digestStr[2 * i], "%02x", userParam->dig.digest[i]);
+    }
+    digestStr[2 * i] = '\0';
+    fprintf(userParam->out, "%s %s (sz %" PRIu64 ")\n", userParam->path, digestStr, userParam->fsz);
+    return 0;
+}
+
+static int linkCreate(userTarStruct_t *userParam, const tarStrEx_entry_t *entry)
+{
+    fprintf(userParam->out, "%s link %s -> %s\n", (TAR_TYPE_SYM == entry->type) ? "symbolic" : "hard", entry->name,
+            (NULL != entry->linkname) ? entry->linkname : "");
+    return 0;
+}
@@ -0,0 +1,202 @@
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * This example extracts a tar archive (read from a file, or from the standard input) into a directory, using the
+ * Linux disk backend. The archive is read in large chunks, so that file data reaches the backend in long runs.
+ * With -s file data is instead moved from the input to the output files with splice(), never entering user space.
+ * With -w the files are written by a pool of worker threads, while the archive is still being parsed.
+ * Sparse files are restored with their holes, or extracted as they are stored with -S. With -i and -x only the members
+ * matching the patterns are extracted.
+ */
+#include "tarStreamDisk.h"
+#include "tarStreamExtractor.h"
+#include "tarStreamFilter.h"
+#include "tarStreamSplice.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define READ_SZ  (1024 * 1024)
+#define BUF_SZ   (1024 * 1024)
+#define BUF_NUM  (4)
+#define DIRS_NUM (64 * 1024)
+#define EXT_NUM  (4096)
+#define PAT_NUM  (16)
+
+static static_tarStrEx_t static_seTar;
+static tarStrDisk_t      disk;
+static uint8_t           readBuff[READ_SZ];
+static uint8_t           writeMem[BUF_NUM * BUF_SZ] __attribute__((aligned(TARSTRDISK_ALIGN)));
+static tarStrDisk_dir_t  dirs[DIRS_NUM];
+static char              dirNames[DIRS_NUM * 64];
+static tarStrEx_extent_t sparseMap[EXT_NUM];
+static tarStrFlt_t       filter;
+static uint8_t           filterMem[PAT_NUM * TARSTRFLT_PATTERN_SZ(64, 2)];
+
+static int disk_outFd(void *param)
+{
+    return tarStrDisk_fd((const tarStrDisk_t *)param);
+}
+
+int main(int argc, char *argv[])
+{
+    tarStrEx_t *seTar;
+    unsigned    flags    = 0;
+    unsigned    nWorkers = 0;
+    unsigned    nBufs    = BUF_NUM;
+    const char *include[PAT_NUM];
+    const char *exclude[PAT_NUM];
+    unsigned    nInclude = 0;
+    unsigned    nExclude = 0;
+    int         stored   = 0; /* sparse files as stored */
+    int         opt, fd, res;
+    ssize_t     bytes_read;
+
+    while ((opt = getopt(argc, argv, "di:mpsStuw:x:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'd':
+            flags |= TARSTRDISK_F_DIRECT;
+            break;
+        case 'i':
+            if (nInclude < PAT_NUM)
+            {
+                include[nInclude++] = optarg;
+            }
+            break;
+        case 'm':
+            flags |= TARSTRDISK_F_MODES;
+            break;
+        case 'p':
+            flags |= TARSTRDISK_F_PREALLOC;
+            break;
+        case 's':
+            flags |= TARSTRDISK_F_SPLICE;
+            break;
+        case 'S':
+            stored = 1;
+            break;
+        case 't':
+            flags |= TARSTRDISK_F_TIMES;
+            break;
+        case 'u':
+            flags |= TARSTRDISK_F_URING;
+            break;
+        case 'w':
+            nWorkers = (unsigned)atoi(optarg);
+            break;
+        case 'x':
+            if (nExclude < PAT_NUM)
+            {
+                exclude[nExclude++] = optarg;
+            }
+            break;
+        default:
+            optind = argc; /* print usage */
+            break;
+        }
+    }
+    if (optind + 1 > argc)
+    {
+        fprintf(stderr,
+                "Use: %s [-d] [-m] [-p] [-s] [-S] [-t] [-u] [-w <n_workers>] [-i <pattern>]... [-x <pattern>]... "
+                "<out_dir> [tar_file]\n",
+                argv[0]);
+        fprintf(stderr, "  -d O_DIRECT, -m restore modes, -p preallocate, -s splice, -S sparse files as stored, "
+                        "-t restore mtime, -u io_uring, -w worker threads, -i include, -x exclude\n");
+        return EXIT_FAILURE;
+    }
+    if (0 != nWorkers)
+    {
+        /* smaller buffers, so that small files are spread over the workers */
+        nBufs = TARSTRDISK_MAX_BUFS;
+    }
+
+    tarStrDisk_cfg_t cfg = {
+        .rootFd     = open(argv[optind], O_RDONLY | O_DIRECTORY),
+        .bufMem     = writeMem,
+        .bufSz      = (BUF_NUM * BUF_SZ) / nBufs,
+        .nBufs      = nBufs,
+        .flags      = flags,
+        .nWorkers   = nWorkers,
+        .dirs       = dirs,
+        .maxDirs    = DIRS_NUM,
+        .dirNames   = dirNames,
+        .dirNamesSz = sizeof(dirNames),
+        .sparseMap  = stored ? NULL : sparseMap,
+        .maxExtents = EXT_NUM,
+    };
+    if (cfg.rootFd < 0)
+    {
+        perror("Error opening output directory");
+        return EXIT_FAILURE;
+    }
+    fd = (optind + 1 < argc) ? open(argv[optind + 1], O_RDONLY) : STDIN_FILENO;
+    if (fd < 0)
+    {
+        perror("Error opening file");
+        return EXIT_FAILURE;
+    }
+    if ((TARSTEX_ESUCCESS != tarStrDisk_init(&disk, &cfg)) ||
+        (TARSTEX_ESUCCESS != tarStrDisk_attach(&disk, &static_seTar, &seTar)))
+    {
+        fprintf(stderr, "Error initializing the disk backend\n");
+        return EXIT_FAILURE;
+    }
+    if ((0 != nInclude + nExclude) &&
+        ((TARSTEX_ESUCCESS != tarStrFlt_compile(&filter, filterMem, sizeof(filterMem), include, nInclude, exclude,
+                                                nExclude)) ||
+         (TARSTEX_ESUCCESS != tarStrEx_set_filter(seTar, tarStrFlt_match, &filter))))
+    {
+        fprintf(stderr, "Error in the patterns\n");
+        return EXIT_FAILURE;
+    }
+
+    res = TARSTEX_ESUCCESS;
+    if (0 != (flags & TARSTRDISK_F_SPLICE))
+    {
+        tarStrSpl_cfg_t splCfg = {
+            .inFd     = fd,
+            .outFd    = disk_outFd,
+            .outParam = &disk,
+            .buf      = readBuff,
+            .bufSz    = sizeof(readBuff),
+        };
+        res = tarStrSpl_run(seTar, &splCfg);
+    }
+    else
+    {
+        while ((TARSTEX_ESUCCESS == res) && !tarStrEx_complete(seTar) &&
+               ((bytes_read = read(fd, readBuff, sizeof(readBuff))) > 0))
+        {
+            res = tarStrEx_process_buffer(seTar, readBuff, bytes_read);
+        }
+    }
+    if (TARSTEX_ESUCCESS == res)
+    {
+        res = tarStrEx_finalize(seTar);
+    }
+    if ((TARSTEX_ESUCCESS != tarStrDisk_finalize(&disk)) || (TARSTEX_ESUCCESS != res))
+    {
+        fprintf(stderr, "Extraction failed (%d): %s\n", res, strerror(-tarStrDisk_error(&disk)));
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * This example indexes a tar archive and lists its members, one path per line as `tar tf` does. The archive is
+ * mapped in memory: headers are pushed one block at a time and member data is jumped over, so only headers are read.
+ * With -x the data of a member is then written to the standard output, through the random access reader.
+ */
+#include "tarStreamExtractor.h"
+#include "tarStreamIndex.h"
+#include "tarStreamReader.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define BLOCK_SZ    (512)
+#define ENTRIES_NUM (16 * 1024)
+#define SLOTS_NUM   (32 * 1024)
+
+static static_tarStrEx_t static_seTar;
+static tarStrIdx_entry_t entries[ENTRIES_NUM];
+static uint32_t          slots[SLOTS_NUM];
+
+/**
+ * @brief build the index of an archive available in memory
+ *
+ * @param idx index to be populated
+ * @param base first byte of the archive
+ * @param len length of the archive
+ * @return 0 on success, or a negative value representing fault
+ */
+static int index_archive(tarStrIdx_t *idx, const uint8_t *base, size_t len)
+{
+    tarStrEx_t *seTar;
+    size_t      off = 0;
+    uint64_t    n;
+    int         res;
+
+    res = tarStrIdx_attach(idx, &static_seTar, &seTar);
+    while ((TARSTEX_ESUCCESS == res) && (off < len) && !tarStrEx_complete(seTar))
+    {
+        n = tarStrEx_skippable(seTar);
+        if (0 != n)
+        {
+            /* data of a member: nothing to read */
+            n   = (n < len - off) ? n : len - off;
+            res = tarStrEx_skip(seTar, n);
+        }
+        else
+        {
+            n   = (BLOCK_SZ < len - off) ? BLOCK_SZ : len - off;
+            res = tarStrEx_process_buffer(seTar, base + off, (size_t)n);
+        }
+        off += (size_t)n;
+    }
+    if (TARSTEX_ESUCCESS == res)
+    {
+        res = tarStrEx_finalize(seTar);
+    }
+    return res;
+}
+
+int main(int argc, char *argv[])
+{
+    tarStrIdx_t    idx;
+    tarStrRd_t     rd;
+    const char    *member = NULL;
+    const uint8_t *base;
+    const uint8_t *data;
+    size_t         dataSz;
+    size_t         i;
+    struct stat    st;
+    int            opt, fd, res;
+
+    while ((opt = getopt(argc, argv, "x:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'x':
+            member = optarg;
+            break;
+        default:
+            optind = argc; /* print usage */
+            break;
+        }
+    }
+    if (optind + 1 != argc)
+    {
+        fprintf(stderr, "Use: %s [-x <member>] <tar_file>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    fd = open(argv[optind], O_RDONLY);
+    if ((fd < 0) || (0 != fstat(fd, &st)))
+    {
+        perror("Error opening file");
+        return EXIT_FAILURE;
+    }
+    base = (0 != st.st_size) ? mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    if (MAP_FAILED == base)
+    {
+        perror("Error mapping file");
+        return EXIT_FAILURE;
+    }
+
+    tarStrIdx_init(&idx, entries, ENTRIES_NUM);
+    res = index_archive(&idx, base, (size_t)st.st_size);
+    if (TARSTEX_ESUCCESS != res)
+    {
+        fprintf(stderr, "Indexing failed (%d)\n", res);
+        return EXIT_FAILURE;
+    }
+
+    if (NULL == member)
+    {
+        for (i = 0; i < idx.count; i++)
+        {
+            printf("%s%s\n", idx.entries[i].name,
+                   (0 != (idx.entries[i].flags & TARSTRIDX_F_TRUNCATED)) ? " (truncated)" : "");
+        }
+        return EXIT_SUCCESS;
+    }
+    if ((TARSTEX_ESUCCESS != tarStrRd_init(&rd, base, (size_t)st.st_size, &idx, slots, SLOTS_NUM)) ||
+        (TARSTEX_ESUCCESS != tarStrRd_lookup(&rd, member, &data, &dataSz)))
+    {
+        fprintf(stderr, "Member not found: %s\n", member);
+        return EXIT_FAILURE;
+    }
+    if (fwrite(data, 1, dataSz, stdout) != dataSz)
+    {
+        perror("Error writing data");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,169 @@
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * This program checks the digest algorithms of the engine (see tarStreamDigest.h), whatever instruction set they have
+ * been built for: known vectors first, then random data fed in chunks of awkward sizes, against OpenSSL for SHA-256
+ * and MD5 and against a bitwise implementation for CRC-32C.
+ */
+#include "tarStreamDigest.h"
+
+#include "digest2string.h"
+#include <openssl/evp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DATA_SZ (100000)
+
+typedef struct
+{
+    const tarStrEx_hash_t *hash;
+    const char            *data;
+    unsigned               repeat; /* times data is fed */
+    const char            *digest;
+} vector_t;
+
+static const vector_t vectors[] = {
+    {&tarStrDig_crc32c, "", 1, "00000000"},
+    {&tarStrDig_crc32c, "123456789", 1, "e3069283"},
+    {&tarStrDig_crc32c, "a", 1000000, "436fe240"},
+    {&tarStrDig_sha256, "", 1, "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"},
+    {&tarStrDig_sha256, "abc", 1, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"},
+    {&tarStrDig_sha256, "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 1,
+     "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"},
+    {&tarStrDig_sha256, "a", 1000000, "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"},
+    {&tarStrDig_md5, "", 1, "d41d8cd98f00b204e9800998ecf8427e"},
+    {&tarStrDig_md5, "abc", 1, "900150983cd24fb0d6963f7d28e17f72"},
+    {&tarStrDig_md5, "12345678901234567890123456789012345678901234567890123456789012345678901234567890", 1,
+     "57edf4a22be3c955ac49da2e2107b67a"},
+};
+
+/* chunk sizes around the block size of SHA-256 and MD5, and around the 8 bytes of the CRC instructions */
+static const size_t chunks[] = {1, 3, 7, 8, 9, 55, 56, 63, 64, 65, 127, 1000, DATA_SZ};
+
+static uint8_t data[DATA_SZ];
+
+/**
+ * @brief CRC-32C, one bit at a time
+ */
+static uint32_t crc32c_ref(const uint8_t *p, size_t len)
+{
+    uint32_t crc = ~0u;
+    unsigned i;
+
+    while (len-- > 0)
+    {
+        crc ^= *p++;
+        for (i = 0; i < 8; i++)
+        {
+            crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+/**
+ * @brief digest of data with OpenSSL, or the bitwise CRC-32C
+ */
+static void reference(const tarStrEx_hash_t *hash, const uint8_t *p, size_t len, char *digestStr)
+{
+    uint8_t  digest[TARSTRDIG_MAX_SZ];
+    unsigned digestSz;
+    uint32_t crc;
+
+    if (&tarStrDig_crc32c == hash)
+    {
+        crc       = crc32c_ref(p, len);
+        digest[0] = (uint8_t)(crc >> 24);
+        digest[1] = (uint8_t)(crc >> 16);
+        digest[2] = (uint8_t)(crc >> 8);
+        digest[3] = (uint8_t)crc;
+        digestSz  = 4;
+    }
+    else
+    {
+        EVP_Digest(p, len, digest, &digestSz, (&tarStrDig_sha256 == hash) ? EVP_sha256() : EVP_md5(), NULL);
+    }
+    digest2string(digest, digestSz, digestStr);
+}
+
+static const char *name(const tarStrEx_hash_t *hash)
+{
+    return (&tarStrDig_crc32c == hash) ? "crc32c" : (&tarStrDig_sha256 == hash) ? "sha256" : "md5";
+}
+
+int main(void)
+{
+    static const tarStrEx_hash_t *const hashes[] = {&tarStrDig_crc32c, &tarStrDig_sha256, &tarStrDig_md5};
+    char                                 want[TARSTRDIG_MAX_SZ * 2 + 1];
+    char                                 got[TARSTRDIG_MAX_SZ * 2 + 1];
+    tarStrDig_t                          dig;
+    unsigned                             i, j, k, failed = 0;
+    size_t                               off, len, sz;
+
+    for (i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++)
+    {
+        vectors[i].hash->init(&dig);
+        for (k = 0; k < vectors[i].repeat; k++)
+        {
+            vectors[i].hash->update(&dig, (const uint8_t *)vectors[i].data, strlen(vectors[i].data));
+        }
+        vectors[i].hash->final(&dig);
+        digest2string(dig.digest, dig.digestSz, got);
+        if (0 != strcmp(got, vectors[i].digest))
+        {
+            fprintf(stderr, "%s vector %u: %s instead of %s\n", name(vectors[i].hash), i, got, vectors[i].digest);
+            failed++;
+        }
+    }
+
+    srand(5612093);
+    for (off = 0; off < DATA_SZ; off++)
+    {
+        data[off] = (uint8_t)rand();
+    }
+    for (i = 0; i < sizeof(hashes) / sizeof(hashes[0]); i++)
+    {
+        /* an odd length and an odd start, so that the chunks are not aligned */
+        len = DATA_SZ - 3;
+        reference(hashes[i], &data[1], len, want);
+        for (j = 0; j <= sizeof(chunks) / sizeof(chunks[0]); j++)
+        {
+            hashes[i]->init(&dig);
+            for (off = 0; off < len; off += sz)
+            {
+                /* the last round uses random chunk sizes, empty ones included */
+                sz = (j < sizeof(chunks) / sizeof(chunks[0])) ? chunks[j] : (size_t)(rand() % 300);
+                sz = (sz > len - off) ? len - off : sz;
+                hashes[i]->update(&dig, &data[1 + off], sz);
+            }
+            hashes[i]->final(&dig);
+            digest2string(dig.digest, dig.digestSz, got);
+            if (0 != strcmp(got, want))
+            {
+                fprintf(stderr, "%s chunks %u: %s instead of %s\n", name(hashes[i]), j, got, want);
+                failed++;
+            }
+        }
+    }
+
+    if (0 != failed)
+    {
+        return EXIT_FAILURE;
+    }
+    printf("digests ok\n");
+    return EXIT_SUCCESS;
+}
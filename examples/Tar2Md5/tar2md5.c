@@ -17,20 +17,57 @@
  * This example calculates the MD5 digest of the files contained in the tar file.
  * The main function reads the file in blocks of variable (random) size to simulate an "irregular" stream. Each block is
  * pushed into the extraction engine.
+ * With the -j option the file is instead mapped in memory and the digests are computed by a pool of workers, each with
+ * its own user structure.
+ * With the -i option the digests are computed by the engine itself (see tarStreamDigest.h) instead of OpenSSL.
+ * With the -a option the SHA-256 of the whole archive is computed along the way and checked against the given one: the
+ * files are committed only if the archive is complete and the digest matches.
+ * With the -z option the archive can be compressed (gzip, or zstd when built with ZSTD=1, detected from the first
+ * bytes): the blocks go through the decompression stage first. With -p they go through the three-stage pipeline
+ * instead, the digests being computed by its callback thread.
+ * With the -r option a reader thread stores the blocks into a ring buffer, from which the main thread pushes them into
+ * the engine (see tarStreamRing.h).
+ * With the -v option the file is mapped in memory and pushed with tarStrEx_process_iov(), split into fragments of odd
+ * sizes (a single fragment when the seed is 0).
+ * Built with TARSTEX_STATS (tar2md5_stats), it checks the statistics of the engine against what the callbacks have
+ * received and prints the payload of the archive.
  */
+#include "tarStreamDecomp.h"
+#include "tarStreamDigest.h"
 #include "tarStreamExtractor.h"
+#include "tarStreamParallel.h"
+#include "tarStreamPipeline.h"
+#include "tarStreamRing.h"
 
 #include "digest2string.h"
+#include <inttypes.h>
 #include <openssl/evp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <strings.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
 
 typedef struct userTarStruct
 {
     EVP_MD_CTX *mdctx;
-    size_t      fsz;
+    uint64_t    fsz;
+    char        path[TARSTRPAR_NAME_SZ];
+    int         inlineDigest; /* digest computed by the engine into dig */
+    tarStrDig_t dig;
+    const char *archExpected; /* SHA-256 of the archive, in hex (-a) */
+    tarStrDig_t archDig;      /* digest of the archive, computed by the engine */
+    unsigned    nFiles;       /* files finalized, pending the commit */
+    int         inFailed;     /* the input could not be read or decompressed to its end: the files are discarded */
+    uint64_t    payload;      /* data received by recvData, all files */
+    uint64_t    recvCalls;    /* calls of recvData, all files */
 } userTarStruct_t;
 
 /* callbacks */
@@ -38,17 +75,364 @@ static int fileInit(userTarStruct_t *, const char *path);
 static int dirCreate(userTarStruct_t *, const char *path);
 static int recvData(userTarStruct_t *, const uint8_t *data, size_t dataSz);
 static int fileFinalize(userTarStruct_t *);
+static int linkCreate(userTarStruct_t *, const tarStrEx_entry_t *entry);
+static int archiveVerify(userTarStruct_t *);
+static int archiveCommit(userTarStruct_t *, int commit);
 
 static userTarStruct_t usrPar;
 
 static static_tarStrEx_t static_seTar;
 
+static userTarStruct_t workerPar[TARSTRPAR_MAX_WORKERS];
+
+#ifdef TARSTEX_WITH_ZSTD
+#define WORKMEM_SZ TARSTRDEC_ZSTD_WORKMEM_SZ
+#else
+#define WORKMEM_SZ TARSTRDEC_GZIP_WORKMEM_SZ
+#endif
+#define OUT_SZ    (64 * 1024)
+#define PIPE_BUFS (8)
+
+static uint8_t      workMem[WORKMEM_SZ] __attribute__((aligned(16)));
+static uint8_t      outMem[PIPE_BUFS * OUT_SZ];
+static tarStrDec_t  dec;
+static tarStrPipe_t pipeline;
+
+#define RING_SZ (4 * 1024)
+
+static uint8_t             ringMem[RING_SZ];
+static static_tarStrRing_t static_ring;
+
+/* reader thread of -r, the producer of the ring */
+typedef struct ringReader
+{
+    FILE         *file;
+    tarStrRing_t *ring;
+    atomic_int    eof;  /* all of the file is in the ring */
+    atomic_int    stop; /* the engine failed: stop reading */
+} ringReader_t;
+
+/**
+ * @brief recognize a compressed stream from its first bytes
+ *
+ * @param data first bytes of the stream
+ * @param dataSz number of bytes
+ * @return codec, or NULL if the stream is not compressed
+ */
+static const tarStrDec_codec_t *codec_detect(const uint8_t *data, size_t dataSz)
+{
+    if ((dataSz >= 2) && (0x1f == data[0]) && (0x8b == data[1]))
+    {
+        return &tarStrDec_gzip;
+    }
+#ifdef TARSTEX_WITH_ZSTD
+    if ((dataSz >= 4) && (0x28 == data[0]) && (0xb5 == data[1]) && (0x2f == data[2]) && (0xfd == data[3]))
+    {
+        return &tarStrDec_zstd;
+    }
+#endif
+    return NULL;
+}
+
+static int parallel_main(const char *file_name, unsigned nWorkers)
+{
+    void       *params[TARSTRPAR_MAX_WORKERS];
+    struct stat st;
+    uint8_t    *base;
+    unsigned    i;
+    int         res;
+
+    int fd = open(file_name, O_RDONLY);
+    if (fd < 0)
+    {
+        perror("Error opening file");
+        return EXIT_FAILURE;
+    }
+    if ((0 != fstat(fd, &st)) || (0 == st.st_size))
+    {
+        fprintf(stderr, "Error reading file size\n");
+        close(fd);
+        return EXIT_FAILURE;
+    }
+    base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (MAP_FAILED == base)
+    {
+        perror("Error mapping file");
+        return EXIT_FAILURE;
+    }
+
+    for (i = 0; i < nWorkers; i++)
+    {
+        params[i] = &workerPar[i];
+    }
+    tarStrPar_cfg_t cfg = {
+        .nWorkers     = nWorkers,
+        .workerParams = params,
+        .dirParam     = &usrPar,
+        .chunkSz      = 0,
+        .fileInit     = (cb_fileInit_t)fileInit,
+        .dirCreate    = (cb_dirCreate_t)dirCreate,
+        .recvData     = (cb_recvData_t)recvData,
+        .fileFinalize = (cb_fileFinalize_t)fileFinalize,
+    };
+    res = tarStrPar_extract(&cfg, base, st.st_size);
+    munmap(base, st.st_size);
+    return (TARSTEX_ESUCCESS == res) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#define IOV_NUM (7)
+
+/**
+ * @brief push an archive with tarStrEx_process_iov(), scattered over fragments of awkward sizes
+ * the fragments split headers, padding and data alike, some are empty, and the segments of one call end anywhere
+ *
+ * @param file archive
+ * @param seTar engine
+ * @param seed 0 for a single fragment, the whole archive
+ * @return 0 on success, or a negative value representing fault
+ */
+static int iov_main(FILE *file, tarStrEx_t *seTar, unsigned seed)
+{
+    static const size_t sizes[] = {0, 1, 3, 100, 511, 512, 513, 1000, 4097};
+    tarStrEx_iovec_t    iov[IOV_NUM];
+    struct stat         st;
+    uint8_t            *base;
+    size_t              off = 0;
+    size_t              n, sz;
+    int                 res = TARSTEX_ESUCCESS;
+
+    if ((0 != fstat(fileno(file), &st)) || (0 == st.st_size))
+    {
+        fprintf(stderr, "Error reading file size\n");
+        return TARSTEX_EFAILURE;
+    }
+    base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+    if (MAP_FAILED == base)
+    {
+        perror("Error mapping file");
+        return TARSTEX_EFAILURE;
+    }
+    while ((TARSTEX_ESUCCESS == res) && (off < (size_t)st.st_size))
+    {
+        for (n = 0; (n < IOV_NUM) && (off < (size_t)st.st_size); n++)
+        {
+            sz = (0 == seed) ? (size_t)st.st_size : sizes[rand() % (sizeof(sizes) / sizeof(sizes[0]))];
+            sz = (sz < (size_t)st.st_size - off) ? sz : (size_t)st.st_size - off;
+
+            iov[n].data   = base + off;
+            iov[n].dataSz = sz;
+            off += sz;
+        }
+        res = tarStrEx_process_iov(seTar, iov, n);
+    }
+    munmap(base, st.st_size);
+    return res;
+}
+
+/**
+ * @brief producer of the ring: read the file in blocks of random size, straight into the free space of the ring
+ *
+ * @param arg reader
+ * @return NULL
+ */
+static void *ring_read(void *arg)
+{
+    ringReader_t *rdr = (ringReader_t *)arg;
+    uint8_t      *ptr;
+    size_t        space;
+    size_t        bytes_read;
+
+    while (!feof(rdr->file) && !ferror(rdr->file) && !atomic_load(&rdr->stop))
+    {
+        space = tarStrRing_reserve(rdr->ring, &ptr);
+        if (0 == space)
+        {
+            sched_yield(); /* the ring is full: wait for the engine to catch up */
+            continue;
+        }
+        size_t block_size = 90 + rand() % (160 - 90 + 1);
+        bytes_read        = fread(ptr, 1, (block_size < space) ? block_size : space, rdr->file);
+        tarStrRing_commit(rdr->ring, bytes_read);
+    }
+    atomic_store(&rdr->eof, 1);
+    return NULL;
+}
+
+/**
+ * @brief consumer of the ring: push the bytes stored by the reader thread into the engine until the end of the file
+ *
+ * @param file archive
+ * @param seTar engine
+ * @return 0 on success, or a negative value representing fault
+ */
+static int ring_main(FILE *file, tarStrEx_t *seTar)
+{
+    ringReader_t rdr = {.file = file};
+    pthread_t    thread;
+    int          eof;
+    int          res;
+
+    res = tarStrRing_init(&static_ring, &rdr.ring, ringMem, sizeof(ringMem), seTar);
+    if (TARSTEX_ESUCCESS != res)
+    {
+        return res;
+    }
+    atomic_init(&rdr.eof, 0);
+    atomic_init(&rdr.stop, 0);
+    if (0 != pthread_create(&thread, NULL, ring_read, &rdr))
+    {
+        return TARSTEX_EFAILURE;
+    }
+    do
+    {
+        /* read before pumping: once the reader is done, a last pump takes whatever it stored */
+        eof = atomic_load(&rdr.eof);
+        if (0 == tarStrRing_level(rdr.ring))
+        {
+            sched_yield();
+        }
+        res = tarStrRing_pump(rdr.ring);
+    } while ((TARSTEX_ESUCCESS == res) && !eof);
+    atomic_store(&rdr.stop, 1); /* the reader may be waiting for space the engine will never free */
+    pthread_join(thread, NULL);
+    fprintf(stderr, "ring high-water %zu of %zu bytes\n", tarStrRing_highWater(rdr.ring), sizeof(ringMem));
+    return res;
+}
+
+#ifdef TARSTEX_STATS
+/**
+ * @brief clock timing the callbacks, in nanoseconds
+ */
+static uint64_t clock_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief check the statistics of the engine: the file data it has delivered, staged or not, is what recvData received,
+ * and every timed callback call falls in a bin of its histogram
+ */
+static int stats_check(tarStrEx_t *seTar)
+{
+    tarStrEx_stats_t stats;
+    uint64_t         total;
+    unsigned         i, j;
+    int              res = TARSTEX_ESUCCESS;
+
+    tarStrEx_stats(seTar, &stats, 0);
+    if ((stats.bytesStaged + stats.bytesDirect != usrPar.payload) ||
+        (stats.cbCalls[TARSTEX_STAT_RECVDATA] != usrPar.recvCalls))
+    {
+        fprintf(stderr, "Statistics: %" PRIu64 " + %" PRIu64 " bytes in %" PRIu64 " calls, %" PRIu64 " in %" PRIu64 "\n",
+                stats.bytesStaged, stats.bytesDirect, stats.cbCalls[TARSTEX_STAT_RECVDATA], usrPar.payload,
+                usrPar.recvCalls);
+        res = TARSTEX_EFAILURE;
+    }
+    for (i = 0; i < TARSTEX_STAT_CB_NUM; i++)
+    {
+        for (total = 0, j = 0; j < TARSTEX_STAT_HIST_BINS; j++)
+        {
+            total += stats.cbHist[i][j];
+        }
+        if (total != stats.cbCalls[i])
+        {
+            fprintf(stderr, "Statistics: callback %u called %" PRIu64 " times, %" PRIu64 " in its histogram\n", i,
+                    stats.cbCalls[i], total);
+            res = TARSTEX_EFAILURE;
+        }
+    }
+    printf("payload %" PRIu64 "\n", usrPar.payload);
+    return res;
+}
+#endif
+
+/**
+ * @brief set up the decompression stage (-z) or the pipeline (-p)
+ *
+ * @param decomp 1 for the decompression stage, 2 for the pipeline
+ * @param codec decompression algorithm, NULL if the archive is not compressed
+ * @param seTar engine fed by the decompression stage
+ * @return 0 on success, or a negative value representing fault
+ */
+static int stream_init(int decomp, const tarStrDec_codec_t *codec, tarStrEx_t *seTar)
+{
+    tarStrPipe_cfg_t cfg = {
+        .codec        = codec,
+        .workMem      = workMem,
+        .workMemSz    = sizeof(workMem),
+        .bufMem       = outMem,
+        .bufSz        = OUT_SZ,
+        .nBufs        = PIPE_BUFS,
+        .cbParam      = &usrPar,
+        .fileInit     = (cb_fileInit_t)fileInit,
+        .dirCreate    = (cb_dirCreate_t)dirCreate,
+        .recvData     = (cb_recvData_t)recvData,
+        .fileFinalize = (cb_fileFinalize_t)fileFinalize,
+    };
+
+    if (NULL != usrPar.archExpected)
+    {
+        cfg.archHash    = &tarStrDig_sha256;
+        cfg.archHashCtx = &usrPar.archDig;
+        cfg.verify      = (cb_verify_t)archiveVerify;
+        cfg.commit      = (cb_commit_t)archiveCommit;
+    }
+    if (2 == decomp)
+    {
+        return tarStrPipe_init(&pipeline, &cfg);
+    }
+    if (NULL != codec)
+    {
+        return tarStrDec_init(&dec, codec, workMem, sizeof(workMem), outMem, OUT_SZ, seTar);
+    }
+    return TARSTEX_ESUCCESS;
+}
+
 int main(int argc, char *argv[])
 {
     tarStrEx_t *seTar;
+    int         decomp   = 0; /* 1: -z, 2: -p, 3: -r, 4: -v */
+    int         detected = 0;
+    int         res      = TARSTEX_ESUCCESS;
+    if ((argc > 2) && (0 == strcmp(argv[1], "-a")))
+    {
+        usrPar.archExpected = argv[2];
+        argv += 2;
+        argc -= 2;
+    }
+    if ((argc > 1) && (0 == strcmp(argv[1], "-i")))
+    {
+        usrPar.inlineDigest = 1;
+        argv++;
+        argc--;
+    }
+    if ((argc > 1) && ((0 == strcmp(argv[1], "-z")) || (0 == strcmp(argv[1], "-p")) || (0 == strcmp(argv[1], "-r")) ||
+                       (0 == strcmp(argv[1], "-v"))))
+    {
+        decomp = ('z' == argv[1][1]) ? 1 : ('p' == argv[1][1]) ? 2 : ('r' == argv[1][1]) ? 3 : 4;
+        argv++;
+        argc--;
+    }
+    if ((argc > 2) && (0 == strcmp(argv[1], "-j")))
+    {
+        unsigned nWorkers = atoi(argv[2]);
+        if ((argc < 4) || (0 == nWorkers) || (nWorkers > TARSTRPAR_MAX_WORKERS))
+        {
+            fprintf(stderr, "Use: %s -j <n_workers> <nome_file>\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+        return parallel_main(argv[3], nWorkers);
+    }
     if (argc < 2)
     {
-        fprintf(stderr, "Use: %s <nome_file> [seed_random]\n", argv[0]);
+        fprintf(stderr,
+                "Use: %s [-a <sha256>] [-i] [-z|-p|-r|-v] <nome_file> [seed_random]\n"
+                "       %s -j <n_workers> <nome_file>\n",
+                argv[0], argv[0]);
         return EXIT_FAILURE;
     }
 
@@ -65,9 +449,44 @@ int main(int argc, char *argv[])
     /* init tar extractor */
     tarStrEx_init(&static_seTar, &seTar, &usrPar, (cb_fileInit_t)fileInit, (cb_dirCreate_t)dirCreate,
                   (cb_recvData_t)recvData, (cb_fileFinalize_t)fileFinalize);
+    tarStrEx_set_linkCallback(seTar, (cb_link_t)linkCreate);
+    if (usrPar.inlineDigest)
+    {
+        tarStrEx_set_hash(seTar, &tarStrDig_md5, &usrPar.dig);
+    }
+    if (NULL != usrPar.archExpected)
+    {
+        tarStrEx_set_archiveHash(seTar, &tarStrDig_sha256, &usrPar.archDig);
+        tarStrEx_set_commit(seTar, (cb_verify_t)archiveVerify, (cb_commit_t)archiveCommit);
+    }
+#ifdef TARSTEX_STATS
+    tarStrEx_set_clock(seTar, clock_ns);
+#endif
 
     srand(seed); /* Initializes the random number generator with the specified seed */
 
+    if ((3 == decomp) || (4 == decomp))
+    {
+        res = (3 == decomp) ? ring_main(file, seTar) : iov_main(file, seTar, seed);
+        fclose(file);
+        usrPar.inFailed = (TARSTEX_ESUCCESS != res);
+        if (TARSTEX_ESUCCESS == res)
+        {
+            res = tarStrEx_finalize(seTar);
+        }
+        else
+        {
+            tarStrEx_finalize(seTar); /* commits nothing */
+        }
+#ifdef TARSTEX_STATS
+        if (TARSTEX_ESUCCESS == res)
+        {
+            res = stats_check(seTar);
+        }
+#endif
+        return (TARSTEX_ESUCCESS == res) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     unsigned char buffer[160];
     size_t        bytes_read;
 
@@ -78,22 +497,80 @@ int main(int argc, char *argv[])
         size_t block_size = 90 + rand() % (160 - 90 + 1); /* Random size between 90 and 160 */
         bytes_read        = fread(buffer, 1, block_size, file);
 
+        if ((bytes_read > 0) && (0 != decomp) && !detected)
+        {
+            /* first block: the stream tells whether it is compressed */
+            detected = 1;
+            if (TARSTEX_ESUCCESS != stream_init(decomp, codec_detect(buffer, bytes_read), seTar))
+            {
+                fprintf(stderr, "Error initializing the decompression\n");
+                return EXIT_FAILURE;
+            }
+        }
         if (bytes_read > 0)
         {
-            tarStrEx_process_data(seTar, buffer, bytes_read);
+            if (0 != pipeline.threads)
+            {
+                res = tarStrPipe_process(&pipeline, buffer, bytes_read);
+            }
+            else if (NULL != dec.codec)
+            {
+                res = tarStrDec_process(&dec, buffer, bytes_read);
+            }
+            else
+            {
+                tarStrEx_process_data(seTar, buffer, bytes_read);
+            }
+        }
+        if (TARSTEX_ESUCCESS != res)
+        {
+            fprintf(stderr, "Error processing the archive (%d)\n", res);
+            break;
         }
     }
 
     fclose(file);
-    return EXIT_SUCCESS;
+    if (0 != pipeline.threads)
+    {
+        return ((TARSTEX_ESUCCESS == tarStrPipe_finalize(&pipeline)) && (TARSTEX_ESUCCESS == res)) ? EXIT_SUCCESS
+                                                                                                 : EXIT_FAILURE;
+    }
+    if ((NULL != dec.codec) && (TARSTEX_ESUCCESS != tarStrDec_finalize(&dec)) && (TARSTEX_ESUCCESS == res))
+    {
+        fprintf(stderr, "Truncated compressed stream\n");
+        res = TARSTEX_EFAILURE;
+    }
+    /* finalized anyway, so that in two-phase mode the files are discarded if the input failed */
+    usrPar.inFailed = (TARSTEX_ESUCCESS != res);
+    if (TARSTEX_ESUCCESS == res)
+    {
+        res = tarStrEx_finalize(seTar);
+    }
+    else
+    {
+        tarStrEx_finalize(seTar);
+    }
+#ifdef TARSTEX_STATS
+    if ((TARSTEX_ESUCCESS == res) && (TARSTEX_ESUCCESS != stats_check(seTar)))
+    {
+        return EXIT_FAILURE;
+    }
+#endif
+    return (((NULL == usrPar.archExpected) && (0 == decomp)) || (TARSTEX_ESUCCESS == res)) ? EXIT_SUCCESS
+                                                                                          : EXIT_FAILURE;
 }
 
 static int fileInit(userTarStruct_t *userParam, const char *path)
 {
-    printf("%s ", path);
+    /* the path is printed along with the digest, so that lines of concurrent workers do not mix */
+    snprintf(userParam->path, sizeof(userParam->path), "%s", path);
+    userParam->fsz = 0;
+    if (userParam->inlineDigest)
+    {
+        return 0;
+    }
     userParam->mdctx = EVP_MD_CTX_new();
     EVP_DigestInit_ex(userParam->mdctx, EVP_md5(), NULL);
-    userParam->fsz = 0;
     return 0;
 }
 
@@ -105,8 +582,13 @@ static int dirCreate(userTarStruct_t *userParam, const char *path)
 
 static int recvData(userTarStruct_t *userParam, const uint8_t *data, size_t dataSz)
 {
-    EVP_DigestUpdate(userParam->mdctx, data, dataSz);
+    if (!userParam->inlineDigest)
+    {
+        EVP_DigestUpdate(userParam->mdctx, data, dataSz);
+    }
     userParam->fsz += dataSz;
+    userParam->payload += dataSz;
+    userParam->recvCalls++;
     return 0;
 }
 
@@ -116,12 +598,47 @@ static int fileFinalize(userTarStruct_t *userParam)
     char     digestStr[md5_digest_len * 2 + 1];
     uint8_t *md5_digest;
 
+    if (userParam->inlineDigest)
+    {
+        digest2string(userParam->dig.digest, userParam->dig.digestSz, digestStr);
+        printf("%s %s (sz %" PRIu64 ")\n", userParam->path, digestStr, userParam->fsz);
+        userParam->nFiles++;
+        return 0;
+    }
     md5_digest = (uint8_t *)OPENSSL_malloc(md5_digest_len);
     EVP_DigestFinal_ex(userParam->mdctx, md5_digest, &md5_digest_len);
 
     digest2string(md5_digest, md5_digest_len, digestStr);
     EVP_MD_CTX_free(userParam->mdctx);
 
-    printf("%s (sz %zu)\n", digestStr, userParam->fsz);
+    printf("%s %s (sz %" PRIu64 ")\n", userParam->path, digestStr, userParam->fsz);
+    userParam->nFiles++;
+    return 0;
+}
+
+static int linkCreate(userTarStruct_t *userParam, const tarStrEx_entry_t *entry)
+{
+    printf("%s link %s -> %s\n", (TAR_TYPE_SYM == entry->type) ? "symbolic" : "hard", entry->name,
+           (NULL != entry->linkname) ? entry->linkname : "");
+    return 0;
+}
+
+static int archiveVerify(userTarStruct_t *userParam)
+{
+    char digestStr[TARSTRDIG_MAX_SZ * 2 + 1];
+
+    if (userParam->inFailed)
+    {
+        return -1; /* whatever the engine has seen, the archive was not read to its end */
+    }
+    digest2string(userParam->archDig.digest, userParam->archDig.digestSz, digestStr);
+    printf("archive sha256 %s\n", digestStr);
+    return strcasecmp(digestStr, userParam->archExpected);
+}
+
+static int archiveCommit(userTarStruct_t *userParam, int commit)
+{
+    /* a real updater would switch to the new files here, or wipe them */
+    printf("%s %u files\n", commit ? "committed" : "discarded", userParam->nFiles);
     return 0;
 }
@@ -0,0 +1,53 @@
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * This program prints the Adler-32 checksum (computed by zlib), the size and the path of the files given as arguments,
+ * in the format of tar2sum, as a reference for its check.
+ */
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <zlib.h>
+
+int main(int argc, char *argv[])
+{
+    static unsigned char buffer[64 * 1024];
+    FILE                *file;
+    uLong                sum;
+    uint64_t             size;
+    size_t               bytes_read;
+    int                  i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (NULL == (file = fopen(argv[i], "rb")))
+        {
+            fprintf(stderr, "Error opening file %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+        sum  = adler32(0L, Z_NULL, 0);
+        size = 0;
+        while ((bytes_read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        {
+            sum = adler32(sum, buffer, (uInt)bytes_read);
+            size += bytes_read;
+        }
+        fclose(file);
+        printf("%08lx %10" PRIu64 " %s\n", sum, size, argv[i]);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,152 @@
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * This example prints the Adler-32 checksum, the size and the path of the files contained in the tar file, read from
+ * the file given as argument (or from the standard input).
+ * It uses the C++ front end (tarStreamExtractor.hpp): the callbacks are the member functions of a handler class, and
+ * the checksum loop is inlined into the data path of tar.process(). Small files are received in batches, unless -n is
+ * given.
+ */
+#include "tarStreamExtractor.hpp"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/* files received in a single batch at most */
+#define BATCH_MAX 128
+
+class sumHandler
+{
+  public:
+    int fileInit(const char *path)
+    {
+        snprintf(name, sizeof(name), "%s", path);
+        a    = 1;
+        b    = 0;
+        size = 0;
+        return 0;
+    }
+
+    int dirCreate(const char *path)
+    {
+        (void)path;
+        return 0;
+    }
+
+    int recvData(const uint8_t *data, size_t dataSz)
+    {
+        adler(data, dataSz);
+        size += dataSz;
+        return 0;
+    }
+
+    int fileFinalize()
+    {
+        printf("%08" PRIx32 " %10" PRIu64 " %s\n", (b << 16) | a, size, name);
+        return 0;
+    }
+
+    int batch(const tarStrEx_member_t *members, size_t count)
+    {
+        size_t i;
+        for (i = 0; i < count; i++)
+        {
+            fileInit(members[i].entry.name);
+            recvData(members[i].data, members[i].entry.size);
+            fileFinalize();
+        }
+        return 0;
+    }
+
+  private:
+    void adler(const uint8_t *data, size_t dataSz)
+    {
+        size_t i, n;
+        while (dataSz > 0)
+        {
+            n = (dataSz < 5552) ? dataSz : 5552; /* the sums cannot overflow before being reduced */
+            for (i = 0; i < n; i++)
+            {
+                a += data[i];
+                b += a;
+            }
+            a %= 65521;
+            b %= 65521;
+            data += n;
+            dataSz -= n;
+        }
+    }
+
+    char     name[TARSTEX_PATH_MAX];
+    uint32_t a, b;
+    uint64_t size;
+};
+
+static uint8_t           buffer[64 * 1024];
+static tarStrEx_member_t batchMembers[BATCH_MAX];
+static char              batchNames[BATCH_MAX * 128];
+
+int main(int argc, char *argv[])
+{
+    sumHandler           handler;
+    tarStrEx<sumHandler> tar(handler);
+    FILE                *file = stdin;
+    size_t               bytes_read;
+    int                  res     = TARSTEX_ESUCCESS;
+    int                  batches = 1;
+
+    if ((argc > 1) && (0 == strcmp(argv[1], "-n")))
+    {
+        batches = 0;
+        argv++;
+        argc--;
+    }
+    if (argc > 2)
+    {
+        fprintf(stderr, "Use: %s [-n] [tar_file]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if ((argc == 2) && (NULL == (file = fopen(argv[1], "rb"))))
+    {
+        fprintf(stderr, "Error opening file %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    if (batches)
+    {
+        tar.enable_batch(batchMembers, BATCH_MAX, batchNames, sizeof(batchNames));
+    }
+
+    while ((TARSTEX_ESUCCESS == res) && ((bytes_read = fread(buffer, 1, sizeof(buffer), file)) > 0))
+    {
+        res = tar.process(buffer, bytes_read);
+    }
+    if (TARSTEX_ESUCCESS == res)
+    {
+        res = tar.finalize();
+    }
+    if (file != stdin)
+    {
+        fclose(file);
+    }
+    if (TARSTEX_ESUCCESS != res)
+    {
+        fprintf(stderr, "Extraction failed (%d) at offset %" PRIu64 "\n", res, tar.offset());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,555 @@
+
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Streaming tar creator. Members are described with the same tarStrEx_entry_t used by the extractor, and the
+ * archive is handed to the emit callback as it is produced: header blocks are built into the handle, file data is
+ * passed through straight from the caller's buffers, padding and the end-of-archive marker come from a constant
+ * block of zeros. Nothing is allocated and nothing is copied but headers.
+ *
+ * Archives are ustar, extended with PAX headers only when needed: paths that cannot be split into prefix and name,
+ * link targets longer than the linkname field, numbers too large for the octal fields (these are also stored in the
+ * GNU base-256 notation, for readers that ignore PAX headers).
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "tarStreamCreator.h"
+
+#define TAR_BLOCK_SIZE (512)
+
+/* name of the PAX extended headers, as used by other archivers */
+#define PAX_HEADER_NAME "././@PaxHeader"
+
+/**
+ * @brief tar header POSIX.1-1988 (ustar)
+ *
+ * @note type field follows the POSIX IEEE P1003.1 specs
+ *
+ */
+typedef struct
+{
+    char name[100];
+    char mode[8];
+    char owner[8];
+    char group[8];
+    char size[12];
+    char mtime[12];
+    char checksum[8];
+    char type;
+    char linkname[100];
+    char magic[6]; /* "ustar" NUL terminated */
+    char version[2];
+    char uname[32];
+    char gname[32];
+    char devmajor[8];
+    char devminor[8];
+    char prefix[155]; /* prepended to name, with a '/' in between */
+    char _padding[12];
+} tar_header_t;
+
+_Static_assert(TAR_BLOCK_SIZE == sizeof(tar_header_t), "sizes of tar header must be equal to block");
+
+/* items of a member that need a PAX record */
+enum
+{
+    PAX_PATH     = 0x01,
+    PAX_LINKPATH = 0x02,
+    PAX_SIZE     = 0x04,
+    PAX_MTIME    = 0x08,
+    PAX_UID      = 0x10,
+    PAX_GID      = 0x20,
+};
+
+typedef enum tarCrStatus
+{
+    cr_member,   /* ready for a new member */
+    cr_fileData, /* waiting for the data of a file */
+    cr_closed,   /* end-of-archive emitted */
+
+    cr_error,
+} tarCrStatus_t;
+
+struct tarStrCr_t
+{
+    uint8_t blockBuff[TAR_BLOCK_SIZE]; /* header being built */
+
+    uint64_t remaining_filedata; /* number of bytes of data still missing to complete the file */
+    uint64_t offset;             /* number of bytes emitted so far */
+
+    void     *cbParam; /* parameter to be passed to the callback */
+    cb_emit_t emit;
+
+    uint16_t padSz; /* padding that follows the data of the current file */
+    uint8_t  status;
+};
+
+/* 64-bit members make the private structure a few bytes shorter on the 32-bit ABIs that align them to 4 bytes only */
+_Static_assert(sizeof(struct tarStrCr_t) <= sizeof(static_tarStrCr_t),
+               "public structure must be large enough to hold the private one");
+_Static_assert(_Alignof(struct tarStrCr_t) <= _Alignof(static_tarStrCr_t),
+               "public structure must be aligned as the private one");
+
+static const uint8_t zeroBlock[TAR_BLOCK_SIZE];
+
+/**
+ * @brief hand some bytes to the emit callback
+ *
+ * @param cr pointer to creator handle
+ * @param data bytes to emit
+ * @param dataSz number of bytes
+ * @return 0 on success, or a negative value representing fault
+ */
+static int emit(tarStrCr_t *cr, const void *data, size_t dataSz)
+{
+    if (0 == dataSz)
+    {
+        return TARSTEX_ESUCCESS;
+    }
+    if (0 != cr->emit(cr->cbParam, (const uint8_t *)data, dataSz))
+    {
+        cr->status = cr_error;
+        return TARSTEX_EFAILURE;
+    }
+    cr->offset += dataSz;
+    return TARSTEX_ESUCCESS;
+}
+
+/**
+ * @brief whether a number fits an octal field, NUL terminator included
+ *
+ * @param val number
+ * @param len width of the field
+ * @return 1 if it fits, 0 otherwise
+ */
+static int octal_fits(uint64_t val, unsigned len)
+{
+    return (3 * (len - 1) >= 64) || (val < ((uint64_t)1 << (3 * (len - 1))));
+}
+
+/**
+ * @brief write a numeric field of the header
+ * in octal, NUL terminated, if the number fits; in the GNU base-256 notation otherwise
+ *
+ * @param[out] field numeric field as appear into tar archive
+ * @param len width of the field
+ * @param val number
+ */
+static void put_number(char *field, unsigned len, uint64_t val)
+{
+    unsigned i;
+
+    if (octal_fits(val, len))
+    {
+        field[len - 1] = '\0';
+        for (i = len - 1; i > 0; i--)
+        {
+            field[i - 1] = (char)('0' + (val & 7));
+            val >>= 3;
+        }
+    }
+    else
+    {
+        for (i = len - 1; i > 0; i--)
+        {
+            field[i] = (char)(val & 0xFF);
+            val >>= 8;
+        }
+        field[0] = (char)0x80;
+    }
+}
+
+/**
+ * @brief write the modification time
+ * as GNU tar does, a time before the epoch is written in base-256, as a two's complement number spanning the whole
+ * field
+ *
+ * @param[out] field numeric field as appear into tar archive
+ * @param len width of the field
+ * @param val seconds since the epoch
+ */
+static void put_time(char *field, unsigned len, int64_t val)
+{
+    uint64_t bits = (uint64_t)val;
+    unsigned i;
+
+    if (val >= 0)
+    {
+        put_number(field, len, bits);
+        return;
+    }
+    for (i = len; i > 0; i--)
+    {
+        field[i - 1] = (char)(bits & 0xFF);
+        bits         = (bits >> 8) | ((uint64_t)0xFF << 56); /* sign extension */
+    }
+}
+
+/**
+ * @brief write a number in decimal
+ *
+ * @param[out] buf destination, at least 20 bytes
+ * @param val number
+ * @return number of digits written (no NUL terminator)
+ */
+static size_t put_decimal(char *buf, uint64_t val)
+{
+    char   tmp[20];
+    size_t len = 0;
+    size_t i;
+
+    do
+    {
+        tmp[len++] = (char)('0' + val % 10);
+        val /= 10;
+    } while (0 != val);
+    for (i = 0; i < len; i++)
+    {
+        buf[i] = tmp[len - 1 - i];
+    }
+    return len;
+}
+
+/**
+ * @brief length of a PAX record "<len> <key>=<value>\n", its own length included
+ *
+ * @param keyLen length of the keyword
+ * @param valLen length of the value
+ * @return length of the record
+ */
+static size_t pax_len(size_t keyLen, size_t valLen)
+{
+    char   digits[20];
+    size_t n   = keyLen + valLen + 3; /* ' ', '=' and '\n' */
+    size_t len = n + 1;
+
+    /* the length counts its own digits: adding them may add a digit */
+    while (len != n + put_decimal(digits, len))
+    {
+        len = n + put_decimal(digits, len);
+    }
+    return len;
+}
+
+/**
+ * @brief emit a PAX record
+ *
+ * @param cr pointer to creator handle
+ * @param key keyword
+ * @param value value, not necessarily NUL terminated
+ * @param valLen length of the value
+ * @return 0 on success, or a negative value representing fault
+ */
+static int pax_record(tarStrCr_t *cr, const char *key, const char *value, size_t valLen)
+{
+    char   head[20 + 1 + 8 + 1]; /* "<len> <key>=", keywords are 8 characters at most */
+    size_t keyLen = strlen(key);
+    size_t n;
+    int    res;
+
+    n         = put_decimal(head, pax_len(keyLen, valLen));
+    head[n++] = ' ';
+    memcpy(&head[n], key, keyLen);
+    n += keyLen;
+    head[n++] = '=';
+    res       = emit(cr, head, n);
+    if (TARSTEX_ESUCCESS == res)
+    {
+        res = emit(cr, value, valLen); /* paths are emitted straight from the caller's entry */
+    }
+    if (TARSTEX_ESUCCESS == res)
+    {
+        res = emit(cr, "\n", 1);
+    }
+    return res;
+}
+
+/**
+ * @brief emit a PAX record with a numeric value
+ *
+ * @param cr pointer to creator handle
+ * @param key keyword
+ * @param val value
+ * @return 0 on success, or a negative value representing fault
+ */
+static int pax_number(tarStrCr_t *cr, const char *key, uint64_t val)
+{
+    char num[20];
+    return pax_record(cr, key, num, put_decimal(num, val));
+}
+
+/**
+ * @brief length of a PAX record with a numeric value
+ *
+ * @param key keyword
+ * @param val value
+ * @return length of the record
+ */
+static size_t pax_number_len(const char *key, uint64_t val)
+{
+    char num[20];
+    return pax_len(strlen(key), put_decimal(num, val));
+}
+
+/**
+ * @brief find where a path can be split into the ustar prefix and name fields
+ *
+ * @param path path of the member
+ * @param len length of the path
+ * @return index of the '/' separating prefix and name, 0 if the path cannot be split
+ */
+static size_t path_split(const char *path, size_t len)
+{
+    size_t i;
+    size_t maxPrefix = sizeof(((tar_header_t *)0)->prefix);
+    size_t maxName   = sizeof(((tar_header_t *)0)->name);
+
+    /* the longest prefix leaves the shortest name */
+    for (i = (len - 1 < maxPrefix) ? len - 1 : maxPrefix; (i > 0) && (len - i - 1 <= maxName); i--)
+    {
+        if (('/' == path[i]) && (i < len - 1))
+        {
+            return i;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief fill the block buffer with a header, checksum included
+ *
+ * @param cr pointer to creator handle
+ * @param entry description of the member, name and linkname excluded
+ * @param name name field (possibly truncated)
+ * @param nameLen length of the name field
+ * @param prefix prefix field, can be NULL
+ * @param prefixLen length of the prefix field
+ * @param size size field
+ * @param type type field
+ */
+static void header_build(tarStrCr_t *cr, const tarStrEx_entry_t *entry, const char *name, size_t nameLen,
+                         const char *prefix, size_t prefixLen, uint64_t size, char type)
+{
+    tar_header_t *rh  = (tar_header_t *)cr->blockBuff;
+    uint32_t      sum = 0;
+    size_t        linkLen;
+    unsigned      i;
+
+    memset(rh, 0, sizeof(*rh));
+    memcpy(rh->name, name, (nameLen < sizeof(rh->name)) ? nameLen : sizeof(rh->name));
+    if (NULL != prefix)
+    {
+        memcpy(rh->prefix, prefix, prefixLen);
+    }
+    if ((NULL != entry->linkname) && (TAR_TYPE_PAX != type))
+    {
+        linkLen = strlen(entry->linkname); /* truncated when it is in the PAX header */
+        memcpy(rh->linkname, entry->linkname, (linkLen < sizeof(rh->linkname)) ? linkLen : sizeof(rh->linkname));
+    }
+    put_number(rh->mode, sizeof(rh->mode), (TAR_TYPE_PAX != type) ? (entry->mode & 07777) : 0644);
+    put_number(rh->owner, sizeof(rh->owner), (TAR_TYPE_PAX != type) ? entry->owner : 0);
+    put_number(rh->group, sizeof(rh->group), (TAR_TYPE_PAX != type) ? entry->group : 0);
+    put_number(rh->size, sizeof(rh->size), size);
+    put_time(rh->mtime, sizeof(rh->mtime), entry->mtime);
+    rh->type = type;
+    memcpy(rh->magic, "ustar", sizeof(rh->magic)); /* NUL included */
+    memcpy(rh->version, "00", sizeof(rh->version));
+    put_number(rh->devmajor, sizeof(rh->devmajor), 0);
+    put_number(rh->devminor, sizeof(rh->devminor), 0);
+
+    /* the checksum is computed with its own field filled with spaces */
+    memset(rh->checksum, ' ', sizeof(rh->checksum));
+    for (i = 0; i < TAR_BLOCK_SIZE; i++)
+    {
+        sum += cr->blockBuff[i];
+    }
+    put_number(rh->checksum, sizeof(rh->checksum) - 1, sum); /* six digits, NUL and space */
+}
+
+int tarStrCr_init(static_tarStrCr_t *static_tarCr, tarStrCr_t **cr, void *cbParam, cb_emit_t emit)
+{
+    *cr                       = (tarStrCr_t *)static_tarCr;
+    (*cr)->cbParam            = cbParam;
+    (*cr)->emit               = emit;
+    (*cr)->remaining_filedata = 0;
+    (*cr)->offset             = 0;
+    (*cr)->padSz              = 0;
+    (*cr)->status             = cr_member;
+    return TARSTEX_ESUCCESS;
+}
+
+int tarStrCr_file_begin(tarStrCr_t *cr, const tarStrEx_entry_t *entry)
+{
+    size_t   nameLen = strlen(entry->name);
+    size_t   linkLen = (NULL != entry->linkname) ? strlen(entry->linkname) : 0;
+    size_t   split   = 0;
+    size_t   paxSz   = 0;
+    unsigned pax     = 0;
+    uint64_t size    = 0;
+    int      res     = TARSTEX_ESUCCESS;
+
+    if (cr_member != cr->status)
+    {
+        return TARSTEX_EFAILURE;
+    }
+    switch (entry->type)
+    {
+    case TAR_TYPE_PAX:
+    case TAR_TYPE_PAXGLOBAL:
+    case TAR_TYPE_LONGNAME:
+    case TAR_TYPE_LONGLINK:
+        return TARSTEX_EFAILURE; /* metadata members are produced by the creator itself */
+    case TAR_TYPE_REG:
+    case TAR_TYPE_CONTIG:
+        size = entry->size; /* only files have data */
+        break;
+    default:
+        break;
+    }
+    if ((0 == nameLen) || (nameLen >= TARSTEX_PATH_MAX) || (linkLen >= TARSTEX_PATH_MAX))
+    {
+        return (0 == nameLen) ? TARSTEX_EFAILURE : TARSTEX_ETOOLONG; /* the extractor could not read it back */
+    }
+
+    /* what does not fit the ustar header goes into a PAX extended header */
+    if (nameLen > sizeof(((tar_header_t *)0)->name))
+    {
+        split = path_split(entry->name, nameLen);
+        pax |= (0 == split) ? PAX_PATH : 0;
+    }
+    pax |= (linkLen > sizeof(((tar_header_t *)0)->linkname)) ? PAX_LINKPATH : 0;
+    pax |= octal_fits(size, sizeof(((tar_header_t *)0)->size)) ? 0 : PAX_SIZE;
+    if ((entry->mtime > 0) && !octal_fits((uint64_t)entry->mtime, sizeof(((tar_header_t *)0)->mtime)))
+    {
+        pax |= PAX_MTIME; /* a time before the epoch fits the base-256 notation anyway */
+    }
+    pax |= octal_fits(entry->owner, sizeof(((tar_header_t *)0)->owner)) ? 0 : PAX_UID;
+    pax |= octal_fits(entry->group, sizeof(((tar_header_t *)0)->group)) ? 0 : PAX_GID;
+    if (0 != pax)
+    {
+        paxSz += (0 != (pax & PAX_PATH)) ? pax_len(4, nameLen) : 0;
+        paxSz += (0 != (pax & PAX_LINKPATH)) ? pax_len(8, linkLen) : 0;
+        paxSz += (0 != (pax & PAX_SIZE)) ? pax_number_len("size", size) : 0;
+        paxSz += (0 != (pax & PAX_MTIME)) ? pax_number_len("mtime", (uint64_t)entry->mtime) : 0;
+        paxSz += (0 != (pax & PAX_UID)) ? pax_number_len("uid", entry->owner) : 0;
+        paxSz += (0 != (pax & PAX_GID)) ? pax_number_len("gid", entry->group) : 0;
+        header_build(cr, entry, PAX_HEADER_NAME, strlen(PAX_HEADER_NAME), NULL, 0, paxSz, TAR_TYPE_PAX);
+        res = emit(cr, cr->blockBuff, TAR_BLOCK_SIZE);
+        if ((TARSTEX_ESUCCESS == res) && (0 != (pax & PAX_PATH)))
+        {
+            res = pax_record(cr, "path", entry->name, nameLen);
+        }
+        if ((TARSTEX_ESUCCESS == res) && (0 != (pax & PAX_LINKPATH)))
+        {
+            res = pax_record(cr, "linkpath", entry->linkname, linkLen);
+        }
+        if ((TARSTEX_ESUCCESS == res) && (0 != (pax & PAX_SIZE)))
+        {
+            res = pax_number(cr, "size", size);
+        }
+        if ((TARSTEX_ESUCCESS == res) && (0 != (pax & PAX_MTIME)))
+        {
+            res = pax_number(cr, "mtime", (uint64_t)entry->mtime);
+        }
+        if ((TARSTEX_ESUCCESS == res) && (0 != (pax & PAX_UID)))
+        {
+            res = pax_number(cr, "uid", entry->owner);
+        }
+        if ((TARSTEX_ESUCCESS == res) && (0 != (pax & PAX_GID)))
+        {
+            res = pax_number(cr, "gid", entry->group);
+        }
+        if (TARSTEX_ESUCCESS == res)
+        {
+            res = emit(cr, zeroBlock, (TAR_BLOCK_SIZE - paxSz % TAR_BLOCK_SIZE) % TAR_BLOCK_SIZE);
+        }
+        if (TARSTEX_ESUCCESS != res)
+        {
+            return res;
+        }
+    }
+
+    /* the member header itself: the name is truncated when it is in the PAX header */
+    if (0 != split)
+    {
+        header_build(cr, entry, &entry->name[split + 1], nameLen - split - 1, entry->name, split, size, entry->type);
+    }
+    else
+    {
+        header_build(cr, entry, entry->name, nameLen, NULL, 0, size, entry->type);
+    }
+    res = emit(cr, cr->blockBuff, TAR_BLOCK_SIZE);
+    if ((TARSTEX_ESUCCESS == res) && ((TAR_TYPE_REG == entry->type) || (TAR_TYPE_CONTIG == entry->type)))
+    {
+        cr->remaining_filedata = size;
+        cr->padSz              = (uint16_t)((TAR_BLOCK_SIZE - size % TAR_BLOCK_SIZE) % TAR_BLOCK_SIZE);
+        cr->status             = cr_fileData;
+    }
+    return res;
+}
+
+int tarStrCr_file_data(tarStrCr_t *cr, const uint8_t *data, size_t dataSz)
+{
+    if ((cr_fileData != cr->status) || (dataSz > cr->remaining_filedata))
+    {
+        return TARSTEX_EFAILURE;
+    }
+    cr->remaining_filedata -= dataSz;
+    return emit(cr, data, dataSz); /* zero-copy: the caller's buffer goes straight to the callback */
+}
+
+int tarStrCr_file_end(tarStrCr_t *cr)
+{
+    int res;
+
+    if ((cr_fileData != cr->status) || (0 != cr->remaining_filedata))
+    {
+        return TARSTEX_EFAILURE;
+    }
+    res = emit(cr, zeroBlock, cr->padSz);
+    if (TARSTEX_ESUCCESS == res)
+    {
+        cr->status = cr_member;
+    }
+    return res;
+}
+
+int tarStrCr_finalize(tarStrCr_t *cr)
+{
+    int res;
+
+    if (cr_member != cr->status)
+    {
+        return TARSTEX_EFAILURE;
+    }
+    /* two blocks of zeros mark the end of the archive */
+    res = emit(cr, zeroBlock, TAR_BLOCK_SIZE);
+    if (TARSTEX_ESUCCESS == res)
+    {
+        res = emit(cr, zeroBlock, TAR_BLOCK_SIZE);
+    }
+    if (TARSTEX_ESUCCESS == res)
+    {
+        cr->status = cr_closed;
+    }
+    return res;
+}
+
+uint64_t tarStrCr_offset(const tarStrCr_t *cr)
+{
+    return cr->offset;
+}
@@ -0,0 +1,124 @@
+
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TARSTREAMCREATOR_H
+#define SRC_TARSTREAMCREATOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tarStreamExtractor.h"
+
+/* sed struct dimension depending on platform */
+#if UINTPTR_MAX == 0xFFFFFFFF
+#define STATIC_TARSTRCR_BUFF_SZ (544) /* for 32-bit platforms */
+#elif UINTPTR_MAX == 0xFFFFFFFFFFFFFFFF
+#define STATIC_TARSTRCR_BUFF_SZ (552) /* for 64-bit platforms */
+#else
+#error "Unknown platform"
+#endif
+
+typedef struct __attribute__((aligned(ALIGNMENT))) static_tarStrCr
+{
+    uint8_t dummy[STATIC_TARSTRCR_BUFF_SZ];
+} static_tarStrCr_t;
+
+typedef struct tarStrCr_t tarStrCr_t;
+
+/**
+ * @brief called for every run of bytes of the archive being created
+ * runs are header blocks, padding, or file data straight from the buffers passed to tarStrCr_file_data(). The data
+ * is valid only during the call
+ *
+ * @param param user parameter
+ * @param data bytes of the archive
+ * @param dataSz number of bytes
+ *
+ * @return 0 on success
+ */
+typedef int (*cb_emit_t)(void *param, const uint8_t *data, size_t dataSz);
+
+/**
+ * @brief initialization function
+ *
+ * @param static_tarCr pointer to struct buffer used to store actual handle structure
+ * @param[out] cr pointer to handle pointer do be populated
+ * @param cbParam parameter passed to the callback
+ * @param emit callback receiving the archive
+ * @return 0 on success, or a negative value representing fault
+ */
+int tarStrCr_init(static_tarStrCr_t *static_tarCr, tarStrCr_t **cr, void *cbParam, cb_emit_t emit);
+
+/**
+ * @brief start a new member
+ * the header is emitted at once. Names that do not fit the ustar name field are split into prefix and name when
+ * possible, and stored into a PAX extended header otherwise, as are link targets longer than 100 bytes and numbers
+ * too large for the octal fields. For regular files (TAR_TYPE_REG) entry->size bytes are to be passed with
+ * tarStrCr_file_data() before tarStrCr_file_end(); other members have no data. hdrOffset and dataOffset are ignored
+ *
+ * @param cr pointer to creator handle
+ * @param entry description of the member
+ * @return 0 on success, TARSTEX_ETOOLONG if a path is longer than TARSTEX_PATH_MAX - 1, or a negative value
+ * representing fault
+ */
+int tarStrCr_file_begin(tarStrCr_t *cr, const tarStrEx_entry_t *entry);
+
+/**
+ * @brief add data to the current file
+ * the data is handed to the emit callback straight from the caller's buffer, without copies. Can be called many
+ * times, with buffers of any size
+ *
+ * @param cr pointer to creator handle
+ * @param data file data
+ * @param dataSz number of bytes, no more than those still missing to the size given to tarStrCr_file_begin()
+ * @return 0 on success, or a negative value representing fault
+ */
+int tarStrCr_file_data(tarStrCr_t *cr, const uint8_t *data, size_t dataSz);
+
+/**
+ * @brief complete the current member, emitting the padding of its data
+ *
+ * @param cr pointer to creator handle
+ * @return 0 on success, or a negative value representing fault (e.g. the data is shorter than declared)
+ */
+int tarStrCr_file_end(tarStrCr_t *cr);
+
+/**
+ * @brief complete the archive, emitting the end-of-archive marker
+ * the handle cannot be used afterwards
+ *
+ * @param cr pointer to creator handle
+ * @return 0 on success, or a negative value representing fault
+ */
+int tarStrCr_finalize(tarStrCr_t *cr);
+
+/**
+ * @brief number of bytes of archive emitted so far
+ *
+ * @param cr pointer to creator handle
+ * @return archive size
+ */
+uint64_t tarStrCr_offset(const tarStrCr_t *cr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_TARSTREAMCREATOR_H */
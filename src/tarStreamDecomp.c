@@ -0,0 +1,287 @@
+
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Decompression stage: compressed bytes are decoded into the output window, which is then pushed into the
+ * extraction engine as is, so there's no intermediate copy. Codecs must be enabled at build time (TARSTEX_WITH_ZLIB,
+ * TARSTEX_WITH_ZSTD) and take all their memory from a caller-provided working memory.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "tarStreamDecomp.h"
+
+#ifdef TARSTEX_WITH_ZLIB
+#include <zlib.h>
+#endif
+#ifdef TARSTEX_WITH_ZSTD
+#define ZSTD_STATIC_LINKING_ONLY /* static contexts */
+#include <zstd.h>
+#endif
+
+#ifdef TARSTEX_WITH_ZLIB
+
+#define ARENA_ALIGN (16)
+
+/**
+ * @brief round a size up to the arena alignment
+ */
+static size_t arena_round(size_t sz)
+{
+    return (sz + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+typedef struct
+{
+    z_stream strm;
+    uint8_t *arena;     /* first free byte of the arena */
+    size_t   arenaFree; /* number of free bytes of the arena */
+    int      ended;     /* the last member met is complete */
+    int      padded;    /* zeros followed the last member: nothing else may come */
+} gzipState_t;
+
+/* zlib allocation functions: a bump allocator over the working memory. inflate allocates only at initialization
+ * (state) and at the first output (window), nothing is ever released before the end */
+static voidpf gzip_alloc(voidpf opaque, uInt items, uInt size)
+{
+    gzipState_t *st = (gzipState_t *)opaque;
+    size_t       sz = arena_round((size_t)items * size);
+    void        *p;
+
+    if (sz > st->arenaFree)
+    {
+        return Z_NULL;
+    }
+    p = st->arena;
+    st->arena += sz;
+    st->arenaFree -= sz;
+    return p;
+}
+
+static void gzip_free(voidpf opaque, voidpf address)
+{
+    (void)opaque;
+    (void)address;
+}
+
+static int gzip_init(uint8_t *workMem, size_t workMemSz, void **state)
+{
+    gzipState_t *st      = (gzipState_t *)workMem;
+    size_t       stateSz = arena_round(sizeof(*st));
+
+    if (workMemSz < stateSz)
+    {
+        return TARSTEX_EFAILURE;
+    }
+    memset(st, 0, sizeof(*st));
+    st->arena       = workMem + stateSz;
+    st->arenaFree   = workMemSz - stateSz;
+    st->strm.zalloc = gzip_alloc;
+    st->strm.zfree  = gzip_free;
+    st->strm.opaque = st;
+    /* 15 + 32: largest window, automatic detection of gzip and zlib headers */
+    if (Z_OK != inflateInit2(&st->strm, 15 + 32))
+    {
+        return TARSTEX_EFAILURE;
+    }
+    *state = st;
+    return TARSTEX_ESUCCESS;
+}
+
+static int gzip_run(void *state, const uint8_t *in, size_t *inSz, uint8_t *out, size_t *outSz)
+{
+    gzipState_t *st  = (gzipState_t *)state;
+    size_t       pad = 0;
+    int          res;
+
+    if (st->ended)
+    {
+        /* between members: the zeros added by tape (or dd) blocking are skipped, as gzip does */
+        while ((pad < *inSz) && (0 == in[pad]))
+        {
+            pad++;
+        }
+        st->padded = st->padded || (pad > 0);
+        if ((pad < *inSz) && st->padded)
+        {
+            return TARSTEX_EFAILURE; /* data after the padding */
+        }
+        if (pad == *inSz)
+        {
+            *outSz = 0;
+            return TARSTEX_ESUCCESS;
+        }
+        st->ended = 0; /* a new member begins */
+    }
+    st->strm.next_in   = (z_const Bytef *)in;
+    st->strm.avail_in  = (uInt)((*inSz > UINT32_MAX) ? UINT32_MAX : *inSz);
+    st->strm.next_out  = out;
+    st->strm.avail_out = (uInt)((*outSz > UINT32_MAX) ? UINT32_MAX : *outSz);
+    res                = inflate(&st->strm, Z_NO_FLUSH);
+    *inSz              = (size_t)(st->strm.next_in - in);
+    *outSz             = (size_t)(st->strm.next_out - out);
+    if (Z_STREAM_END == res)
+    {
+        /* another member may follow: the window is reused, no allocation takes place */
+        st->ended = 1;
+        return (Z_OK == inflateReset(&st->strm)) ? TARSTEX_ESUCCESS : TARSTEX_EFAILURE;
+    }
+    if ((Z_OK == res) || (Z_BUF_ERROR == res)) /* Z_BUF_ERROR: no progress possible, more input needed */
+    {
+        return TARSTEX_ESUCCESS;
+    }
+    return TARSTEX_EFAILURE;
+}
+
+static int gzip_end(void *state)
+{
+    gzipState_t *st = (gzipState_t *)state;
+
+    inflateEnd(&st->strm);
+    /* a member cut short lacks (part of) its data or its CRC/ISIZE trailer */
+    return st->ended ? TARSTEX_ESUCCESS : TARSTEX_EFAILURE;
+}
+
+const tarStrDec_codec_t tarStrDec_gzip = {
+    .init = gzip_init,
+    .run  = gzip_run,
+    .end  = gzip_end,
+};
+
+#endif /* TARSTEX_WITH_ZLIB */
+
+#ifdef TARSTEX_WITH_ZSTD
+
+typedef struct
+{
+    ZSTD_DStream *ds;
+    int           ended; /* the last frame met is complete and flushed */
+} zstdState_t;
+
+/* the state is followed by the context, which must be 8-byte aligned */
+#define ZSTD_STATE_SZ ((sizeof(zstdState_t) + 15) & ~(size_t)15)
+
+static int zstd_init(uint8_t *workMem, size_t workMemSz, void **state)
+{
+    zstdState_t *st = (zstdState_t *)workMem;
+
+    if (workMemSz < ZSTD_STATE_SZ)
+    {
+        return TARSTEX_EFAILURE;
+    }
+    st->ended = 0;
+    st->ds    = ZSTD_initStaticDStream(workMem + ZSTD_STATE_SZ, workMemSz - ZSTD_STATE_SZ);
+    if (NULL == st->ds)
+    {
+        return TARSTEX_EFAILURE;
+    }
+    if (ZSTD_isError(ZSTD_DCtx_setParameter(st->ds, ZSTD_d_windowLogMax, TARSTRDEC_ZSTD_WINDOWLOG)))
+    {
+        return TARSTEX_EFAILURE;
+    }
+    *state = st;
+    return TARSTEX_ESUCCESS;
+}
+
+static int zstd_run(void *state, const uint8_t *in, size_t *inSz, uint8_t *out, size_t *outSz)
+{
+    zstdState_t   *st     = (zstdState_t *)state;
+    ZSTD_inBuffer  inBuf  = {in, *inSz, 0};
+    ZSTD_outBuffer outBuf = {out, *outSz, 0};
+    size_t         res;
+
+    /* once a frame is complete, the context can decode the next one with no reset */
+    res    = ZSTD_decompressStream(st->ds, &outBuf, &inBuf);
+    *inSz  = inBuf.pos;
+    *outSz = outBuf.pos;
+    if (ZSTD_isError(res))
+    {
+        return TARSTEX_EFAILURE;
+    }
+    if ((inBuf.pos > 0) || (outBuf.pos > 0))
+    {
+        st->ended = (0 == res); /* 0: the frame is complete and flushed */
+    }
+    return TARSTEX_ESUCCESS;
+}
+
+static int zstd_end(void *state)
+{
+    /* static contexts are not freed */
+    return ((zstdState_t *)state)->ended ? TARSTEX_ESUCCESS : TARSTEX_EFAILURE;
+}
+
+const tarStrDec_codec_t tarStrDec_zstd = {
+    .init = zstd_init,
+    .run  = zstd_run,
+    .end  = zstd_end,
+};
+
+#endif /* TARSTEX_WITH_ZSTD */
+
+int tarStrDec_init(tarStrDec_t *dec, const tarStrDec_codec_t *codec, uint8_t *workMem, size_t workMemSz,
+                   uint8_t *out, size_t outSz, tarStrEx_t *tar)
+{
+    if ((NULL == codec) || (0 == outSz))
+    {
+        return TARSTEX_EFAILURE;
+    }
+    dec->codec = codec;
+    dec->out   = out;
+    dec->outSz = outSz;
+    dec->tar   = tar;
+    dec->state = NULL;
+    return codec->init(workMem, workMemSz, &dec->state);
+}
+
+int tarStrDec_process(tarStrDec_t *dec, const uint8_t *data, size_t dataSz)
+{
+    size_t inSz, outSz;
+    int    res;
+
+    /* go on while there is input to consume or the window got filled (the decoder may hold more output) */
+    do
+    {
+        inSz  = dataSz;
+        outSz = dec->outSz;
+        res   = dec->codec->run(dec->state, data, &inSz, dec->out, &outSz);
+        if (TARSTEX_ESUCCESS != res)
+        {
+            return res;
+        }
+        data += inSz;
+        dataSz -= inSz;
+        if (outSz > 0)
+        {
+            res = tarStrEx_process_buffer(dec->tar, dec->out, outSz);
+            if (TARSTEX_ESUCCESS != res)
+            {
+                return res;
+            }
+        }
+        else if (0 == inSz)
+        {
+            break; /* no progress at all: the decoder needs more input */
+        }
+    } while ((dataSz > 0) || (outSz == dec->outSz));
+    return TARSTEX_ESUCCESS;
+}
+
+int tarStrDec_finalize(tarStrDec_t *dec)
+{
+    return dec->codec->end(dec->state);
+}
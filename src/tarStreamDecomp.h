@@ -0,0 +1,135 @@
+
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TARSTREAMDECOMP_H
+#define SRC_TARSTREAMDECOMP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tarStreamExtractor.h"
+
+/* working memory needed by the gzip codec: inflate state plus a 32 KiB window */
+#ifndef TARSTRDEC_GZIP_WORKMEM_SZ
+#define TARSTRDEC_GZIP_WORKMEM_SZ (48 * 1024)
+#endif
+
+/* largest window accepted by the zstd codec (log2). The working memory must be large enough for it, see
+ * ZSTD_estimateDStreamSize() */
+#ifndef TARSTRDEC_ZSTD_WINDOWLOG
+#define TARSTRDEC_ZSTD_WINDOWLOG 23
+#endif
+
+/* working memory needed by the zstd codec: the window plus the decompression context, with some margin */
+#ifndef TARSTRDEC_ZSTD_WORKMEM_SZ
+#define TARSTRDEC_ZSTD_WORKMEM_SZ ((1u << TARSTRDEC_ZSTD_WINDOWLOG) + 256 * 1024)
+#endif
+
+/**
+ * @brief a decompression algorithm
+ * codecs get all their memory from the working memory given at initialization, they never call malloc
+ */
+typedef struct tarStrDec_codec
+{
+    /**
+     * @brief prepare the decoder
+     * @param workMem working memory, the codec state is stored at its beginning
+     * @param workMemSz size of working memory
+     * @param[out] state codec state
+     * @return 0 on success, or a negative value representing fault
+     */
+    int (*init)(uint8_t *workMem, size_t workMemSz, void **state);
+    /**
+     * @brief decompress as much as possible
+     * @param state codec state
+     * @param in compressed bytes
+     * @param[in,out] inSz number of compressed bytes available, updated with the number of bytes consumed
+     * @param out decompressed bytes
+     * @param[in,out] outSz room available in out, updated with the number of bytes produced
+     * @return 0 on success, or a negative value representing fault
+     */
+    int (*run)(void *state, const uint8_t *in, size_t *inSz, uint8_t *out, size_t *outSz);
+    /**
+     * @brief release the decoder
+     * @param state codec state
+     * @return 0 if the stream ended with a complete member (or frame), or a negative value if it was truncated
+     */
+    int (*end)(void *state);
+} tarStrDec_codec_t;
+
+#ifdef TARSTEX_WITH_ZLIB
+extern const tarStrDec_codec_t tarStrDec_gzip; /* gzip (or zlib) streams, concatenated members are supported, and so
+                                                  is the zero padding that blocking may add after the last one */
+#endif
+#ifdef TARSTEX_WITH_ZSTD
+extern const tarStrDec_codec_t tarStrDec_zstd; /* zstd streams, concatenated frames are supported */
+#endif
+
+/**
+ * @brief decompression stage in front of an extraction engine
+ */
+typedef struct tarStrDec
+{
+    const tarStrDec_codec_t *codec;
+    void                    *state; /* codec state, stored into the working memory */
+    uint8_t                 *out;   /* output window */
+    size_t                   outSz; /* size of output window */
+    tarStrEx_t              *tar;   /* engine fed with decompressed bytes */
+} tarStrDec_t;
+
+/**
+ * @brief initialization function
+ *
+ * @param dec stage to initialize
+ * @param codec decompression algorithm
+ * @param workMem working memory of the codec (e.g. TARSTRDEC_GZIP_WORKMEM_SZ bytes for gzip)
+ * @param workMemSz size of working memory
+ * @param out output window: decompressed bytes are pushed into the engine straight from here
+ * @param outSz size of output window
+ * @param tar engine fed with decompressed bytes
+ * @return 0 on success, or a negative value representing fault
+ */
+int tarStrDec_init(tarStrDec_t *dec, const tarStrDec_codec_t *codec, uint8_t *workMem, size_t workMemSz,
+                   uint8_t *out, size_t outSz, tarStrEx_t *tar);
+
+/**
+ * @brief collect compressed data, decompress it and push it into the extraction engine
+ * like tarStrEx_process_buffer(), is implemented to be called incrementally
+ *
+ * @param dec pointer to stage
+ * @param data compressed data
+ * @param dataSz array length of data
+ * @return 0 on success, or a negative value representing fault (of the codec or of the engine)
+ */
+int tarStrDec_process(tarStrDec_t *dec, const uint8_t *data, size_t dataSz);
+
+/**
+ * @brief finalization function, releases the codec
+ *
+ * @param dec pointer to stage
+ * @return 0 on success, or a negative value representing fault (e.g. the stream stopped within a member or frame)
+ */
+int tarStrDec_finalize(tarStrDec_t *dec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_TARSTREAMDECOMP_H */
@@ -0,0 +1,487 @@
+
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Digest algorithms for the extraction engine (see tarStrEx_set_hash()). File data is digested straight from the
+ * buffers pushed into the engine: whole blocks of the algorithm are processed in place, only the bytes of a partial
+ * block are kept in the context.
+ * Like the rest of the library, the instruction set is chosen at build time: SSE4.2 (-msse4.2) or ARMv8 CRC
+ * (-march=armv8-a+crc) for CRC-32C, x86 SHA extensions (-msha -msse4.1) for SHA-256. TARSTEX_NO_SIMD forces the
+ * portable code
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if (defined(__SSE4_2__) || (defined(__SHA__) && defined(__SSE4_1__))) && !defined(TARSTEX_NO_SIMD)
+#include <immintrin.h>
+#elif defined(__ARM_FEATURE_CRC32) && !defined(TARSTEX_NO_SIMD)
+#include <arm_acle.h>
+#endif
+
+#include "tarStreamDigest.h"
+
+#define DIG_BLOCK_SIZE (64) /* block size of MD5 and SHA-256 */
+
+typedef void (*dig_blocks_t)(uint32_t *state, const uint8_t *data, size_t nBlocks);
+
+/**
+ * @brief feed data to a block based algorithm
+ * a pending partial block is completed first, then whole blocks are processed straight from data
+ *
+ * @param dig digest context
+ * @param blocks compression function of the algorithm
+ * @param data bytes to digest
+ * @param dataSz number of bytes
+ */
+static void dig_update(tarStrDig_t *dig, dig_blocks_t blocks, const uint8_t *data, size_t dataSz)
+{
+    size_t used = dig->len % DIG_BLOCK_SIZE;
+    size_t n;
+
+    dig->len += dataSz;
+    if (0 != used)
+    {
+        n = DIG_BLOCK_SIZE - used;
+        if (dataSz < n)
+        {
+            memcpy(&dig->block[used], data, dataSz);
+            return;
+        }
+        memcpy(&dig->block[used], data, n);
+        blocks(dig->state, dig->block, 1);
+        data += n;
+        dataSz -= n;
+    }
+    n = dataSz / DIG_BLOCK_SIZE;
+    if (0 != n)
+    {
+        blocks(dig->state, data, n);
+    }
+    memcpy(dig->block, &data[n * DIG_BLOCK_SIZE], dataSz % DIG_BLOCK_SIZE);
+}
+
+/**
+ * @brief append the MD5/SHA-256 padding: a 1 bit, zeros, and the length in bits (64-bit, in the given byte order)
+ *
+ * @param dig digest context
+ * @param blocks compression function of the algorithm
+ * @param bigEndian non-zero to store the length big-endian (SHA-256), zero for little-endian (MD5)
+ */
+static void dig_pad(tarStrDig_t *dig, dig_blocks_t blocks, int bigEndian)
+{
+    uint64_t bits = dig->len * 8;
+    size_t   used = dig->len % DIG_BLOCK_SIZE;
+    unsigned i;
+
+    dig->block[used++] = 0x80;
+    if (used > DIG_BLOCK_SIZE - 8)
+    {
+        memset(&dig->block[used], 0, DIG_BLOCK_SIZE - used);
+        blocks(dig->state, dig->block, 1);
+        used = 0;
+    }
+    memset(&dig->block[used], 0, DIG_BLOCK_SIZE - 8 - used);
+    for (i = 0; i < 8; i++)
+    {
+        dig->block[DIG_BLOCK_SIZE - 8 + i] = (uint8_t)(bits >> (bigEndian ? (56 - 8 * i) : (8 * i)));
+    }
+    blocks(dig->state, dig->block, 1);
+}
+
+/*** CRC-32C ***/
+
+#if !((defined(__SSE4_2__) || defined(__ARM_FEATURE_CRC32)) && !defined(TARSTEX_NO_SIMD))
+/* reflected polynomial 0x82F63B78 */
+static const uint32_t crc32c_table[256] = {
+    0x00000000, 0xF26B8303, 0xE13B70F7, 0x1350F3F4, 0xC79A971F, 0x35F1141C,
+    0x26A1E7E8, 0xD4CA64EB, 0x8AD958CF, 0x78B2DBCC, 0x6BE22838, 0x9989AB3B,
+    0x4D43CFD0, 0xBF284CD3, 0xAC78BF27, 0x5E133C24, 0x105EC76F, 0xE235446C,
+    0xF165B798, 0x030E349B, 0xD7C45070, 0x25AFD373, 0x36FF2087, 0xC494A384,
+    0x9A879FA0, 0x68EC1CA3, 0x7BBCEF57, 0x89D76C54, 0x5D1D08BF, 0xAF768BBC,
+    0xBC267848, 0x4E4DFB4B, 0x20BD8EDE, 0xD2D60DDD, 0xC186FE29, 0x33ED7D2A,
+    0xE72719C1, 0x154C9AC2, 0x061C6936, 0xF477EA35, 0xAA64D611, 0x580F5512,
+    0x4B5FA6E6, 0xB93425E5, 0x6DFE410E, 0x9F95C20D, 0x8CC531F9, 0x7EAEB2FA,
+    0x30E349B1, 0xC288CAB2, 0xD1D83946, 0x23B3BA45, 0xF779DEAE, 0x05125DAD,
+    0x1642AE59, 0xE4292D5A, 0xBA3A117E, 0x4851927D, 0x5B016189, 0xA96AE28A,
+    0x7DA08661, 0x8FCB0562, 0x9C9BF696, 0x6EF07595, 0x417B1DBC, 0xB3109EBF,
+    0xA0406D4B, 0x522BEE48, 0x86E18AA3, 0x748A09A0, 0x67DAFA54, 0x95B17957,
+    0xCBA24573, 0x39C9C670, 0x2A993584, 0xD8F2B687, 0x0C38D26C, 0xFE53516F,
+    0xED03A29B, 0x1F682198, 0x5125DAD3, 0xA34E59D0, 0xB01EAA24, 0x42752927,
+    0x96BF4DCC, 0x64D4CECF, 0x77843D3B, 0x85EFBE38, 0xDBFC821C, 0x2997011F,
+    0x3AC7F2EB, 0xC8AC71E8, 0x1C661503, 0xEE0D9600, 0xFD5D65F4, 0x0F36E6F7,
+    0x61C69362, 0x93AD1061, 0x80FDE395, 0x72966096, 0xA65C047D, 0x5437877E,
+    0x4767748A, 0xB50CF789, 0xEB1FCBAD, 0x197448AE, 0x0A24BB5A, 0xF84F3859,
+    0x2C855CB2, 0xDEEEDFB1, 0xCDBE2C45, 0x3FD5AF46, 0x7198540D, 0x83F3D70E,
+    0x90A324FA, 0x62C8A7F9, 0xB602C312, 0x44694011, 0x5739B3E5, 0xA55230E6,
+    0xFB410CC2, 0x092A8FC1, 0x1A7A7C35, 0xE811FF36, 0x3CDB9BDD, 0xCEB018DE,
+    0xDDE0EB2A, 0x2F8B6829, 0x82F63B78, 0x709DB87B, 0x63CD4B8F, 0x91A6C88C,
+    0x456CAC67, 0xB7072F64, 0xA457DC90, 0x563C5F93, 0x082F63B7, 0xFA44E0B4,
+    0xE9141340, 0x1B7F9043, 0xCFB5F4A8, 0x3DDE77AB, 0x2E8E845F, 0xDCE5075C,
+    0x92A8FC17, 0x60C37F14, 0x73938CE0, 0x81F80FE3, 0x55326B08, 0xA759E80B,
+    0xB4091BFF, 0x466298FC, 0x1871A4D8, 0xEA1A27DB, 0xF94AD42F, 0x0B21572C,
+    0xDFEB33C7, 0x2D80B0C4, 0x3ED04330, 0xCCBBC033, 0xA24BB5A6, 0x502036A5,
+    0x4370C551, 0xB11B4652, 0x65D122B9, 0x97BAA1BA, 0x84EA524E, 0x7681D14D,
+    0x2892ED69, 0xDAF96E6A, 0xC9A99D9E, 0x3BC21E9D, 0xEF087A76, 0x1D63F975,
+    0x0E330A81, 0xFC588982, 0xB21572C9, 0x407EF1CA, 0x532E023E, 0xA145813D,
+    0x758FE5D6, 0x87E466D5, 0x94B49521, 0x66DF1622, 0x38CC2A06, 0xCAA7A905,
+    0xD9F75AF1, 0x2B9CD9F2, 0xFF56BD19, 0x0D3D3E1A, 0x1E6DCDEE, 0xEC064EED,
+    0xC38D26C4, 0x31E6A5C7, 0x22B65633, 0xD0DDD530, 0x0417B1DB, 0xF67C32D8,
+    0xE52CC12C, 0x1747422F, 0x49547E0B, 0xBB3FFD08, 0xA86F0EFC, 0x5A048DFF,
+    0x8ECEE914, 0x7CA56A17, 0x6FF599E3, 0x9D9E1AE0, 0xD3D3E1AB, 0x21B862A8,
+    0x32E8915C, 0xC083125F, 0x144976B4, 0xE622F5B7, 0xF5720643, 0x07198540,
+    0x590AB964, 0xAB613A67, 0xB831C993, 0x4A5A4A90, 0x9E902E7B, 0x6CFBAD78,
+    0x7FAB5E8C, 0x8DC0DD8F, 0xE330A81A, 0x115B2B19, 0x020BD8ED, 0xF0605BEE,
+    0x24AA3F05, 0xD6C1BC06, 0xC5914FF2, 0x37FACCF1, 0x69E9F0D5, 0x9B8273D6,
+    0x88D28022, 0x7AB90321, 0xAE7367CA, 0x5C18E4C9, 0x4F48173D, 0xBD23943E,
+    0xF36E6F75, 0x0105EC76, 0x12551F82, 0xE03E9C81, 0x34F4F86A, 0xC69F7B69,
+    0xD5CF889D, 0x27A40B9E, 0x79B737BA, 0x8BDCB4B9, 0x988C474D, 0x6AE7C44E,
+    0xBE2DA0A5, 0x4C4623A6, 0x5F16D052, 0xAD7D5351,
+};
+#endif
+
+static void crc32c_init(void *ctx)
+{
+    tarStrDig_t *dig = (tarStrDig_t *)ctx;
+
+    dig->state[0] = 0xFFFFFFFF;
+    dig->len      = 0;
+}
+
+static void crc32c_update(void *ctx, const uint8_t *data, size_t dataSz)
+{
+    tarStrDig_t *dig = (tarStrDig_t *)ctx;
+    uint32_t     crc = dig->state[0];
+
+    dig->len += dataSz;
+#if defined(__SSE4_2__) && !defined(TARSTEX_NO_SIMD)
+#if defined(__x86_64__)
+    uint64_t crc64 = crc;
+    for (; dataSz >= sizeof(uint64_t); dataSz -= sizeof(uint64_t), data += sizeof(uint64_t))
+    {
+        uint64_t w;
+        memcpy(&w, data, sizeof(w)); /* no alignment requirement */
+        crc64 = _mm_crc32_u64(crc64, w);
+    }
+    crc = (uint32_t)crc64;
+#else
+    for (; dataSz >= sizeof(uint32_t); dataSz -= sizeof(uint32_t), data += sizeof(uint32_t))
+    {
+        uint32_t w;
+        memcpy(&w, data, sizeof(w)); /* no alignment requirement */
+        crc = _mm_crc32_u32(crc, w);
+    }
+#endif
+    for (; dataSz > 0; dataSz--)
+    {
+        crc = _mm_crc32_u8(crc, *data++);
+    }
+#elif defined(__ARM_FEATURE_CRC32) && !defined(TARSTEX_NO_SIMD)
+    for (; dataSz >= sizeof(uint64_t); dataSz -= sizeof(uint64_t), data += sizeof(uint64_t))
+    {
+        uint64_t w;
+        memcpy(&w, data, sizeof(w)); /* no alignment requirement */
+        crc = __crc32cd(crc, w);
+    }
+    for (; dataSz > 0; dataSz--)
+    {
+        crc = __crc32cb(crc, *data++);
+    }
+#else
+    for (; dataSz > 0; dataSz--)
+    {
+        crc = crc32c_table[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+    }
+#endif
+    dig->state[0] = crc;
+}
+
+static void crc32c_final(void *ctx)
+{
+    tarStrDig_t *dig = (tarStrDig_t *)ctx;
+    uint32_t     crc = dig->state[0] ^ 0xFFFFFFFF;
+    unsigned     i;
+
+    for (i = 0; i < 4; i++)
+    {
+        dig->digest[i] = (uint8_t)(crc >> (24 - 8 * i));
+    }
+    dig->digestSz = 4;
+}
+
+const tarStrEx_hash_t tarStrDig_crc32c = {
+    .init   = crc32c_init,
+    .update = crc32c_update,
+    .final  = crc32c_final,
+};
+
+/*** SHA-256 ***/
+
+static const uint32_t sha256_k[64] = {
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
+};
+
+#if defined(__SHA__) && defined(__SSE4_1__) && !defined(TARSTEX_NO_SIMD)
+/**
+ * @brief SHA-256 compression function, x86 SHA extensions
+ * the state is kept in the ABEF/CDGH layout required by the sha256rnds2 instruction. Each group of 4 rounds
+ * computes the message words needed 4 groups later
+ */
+static void sha256_blocks(uint32_t *state, const uint8_t *data, size_t nBlocks)
+{
+    const __m128i bswap = _mm_set_epi64x(0x0C0D0E0F08090A0Bull, 0x0405060700010203ull);
+    __m128i       st0, st1, tmp, msg, w[4], abefSave, cdghSave;
+    unsigned      g;
+
+    tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[0]), 0xB1); /* CDAB */
+    st1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[4]), 0x1B); /* EFGH */
+    st0 = _mm_alignr_epi8(tmp, st1, 8);                                         /* ABEF */
+    st1 = _mm_blend_epi16(st1, tmp, 0xF0);                                      /* CDGH */
+
+    for (; nBlocks > 0; nBlocks--, data += DIG_BLOCK_SIZE)
+    {
+        abefSave = st0;
+        cdghSave = st1;
+        for (g = 0; g < 16; g++)
+        {
+            if (g < 4)
+            {
+                w[g] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&data[16 * g]), bswap);
+            }
+            else
+            {
+                /* W[t] = s1(W[t-2]) + W[t-7] + s0(W[t-15]) + W[t-16], for 4 words at a time */
+                tmp      = _mm_sha256msg1_epu32(w[g & 3], w[(g + 1) & 3]);
+                tmp      = _mm_add_epi32(tmp, _mm_alignr_epi8(w[(g + 3) & 3], w[(g + 2) & 3], 4));
+                w[g & 3] = _mm_sha256msg2_epu32(tmp, w[(g + 3) & 3]);
+            }
+            msg = _mm_add_epi32(w[g & 3], _mm_loadu_si128((const __m128i *)&sha256_k[4 * g]));
+            st1 = _mm_sha256rnds2_epu32(st1, st0, msg);
+            st0 = _mm_sha256rnds2_epu32(st0, st1, _mm_shuffle_epi32(msg, 0x0E));
+        }
+        st0 = _mm_add_epi32(st0, abefSave);
+        st1 = _mm_add_epi32(st1, cdghSave);
+    }
+
+    tmp = _mm_shuffle_epi32(st0, 0x1B);    /* FEBA */
+    st1 = _mm_shuffle_epi32(st1, 0xB1);    /* DCHG */
+    st0 = _mm_blend_epi16(tmp, st1, 0xF0); /* DCBA */
+    st1 = _mm_alignr_epi8(st1, tmp, 8);    /* HGFE */
+    _mm_storeu_si128((__m128i *)&state[0], st0);
+    _mm_storeu_si128((__m128i *)&state[4], st1);
+}
+#else
+#define ROTR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+/**
+ * @brief SHA-256 compression function, portable code
+ */
+static void sha256_blocks(uint32_t *state, const uint8_t *data, size_t nBlocks)
+{
+    uint32_t w[64];
+    uint32_t a, b, c, d, e, f, g, h, t1, t2;
+    unsigned i;
+
+    for (; nBlocks > 0; nBlocks--, data += DIG_BLOCK_SIZE)
+    {
+        for (i = 0; i < 16; i++)
+        {
+            w[i] = ((uint32_t)data[4 * i] << 24) | ((uint32_t)data[4 * i + 1] << 16) |
+                   ((uint32_t)data[4 * i + 2] << 8) | data[4 * i + 3];
+        }
+        for (; i < 64; i++)
+        {
+            uint32_t s0 = ROTR32(w[i - 15], 7) ^ ROTR32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = ROTR32(w[i - 2], 17) ^ ROTR32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i]        = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        a = state[0];
+        b = state[1];
+        c = state[2];
+        d = state[3];
+        e = state[4];
+        f = state[5];
+        g = state[6];
+        h = state[7];
+        for (i = 0; i < 64; i++)
+        {
+            t1 = h + (ROTR32(e, 6) ^ ROTR32(e, 11) ^ ROTR32(e, 25)) + ((e & f) ^ (~e & g)) + sha256_k[i] + w[i];
+            t2 = (ROTR32(a, 2) ^ ROTR32(a, 13) ^ ROTR32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h  = g;
+            g  = f;
+            f  = e;
+            e  = d + t1;
+            d  = c;
+            c  = b;
+            b  = a;
+            a  = t1 + t2;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+#endif
+
+static void sha256_init(void *ctx)
+{
+    static const uint32_t iv[8] = {0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+                                   0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19};
+    tarStrDig_t          *dig   = (tarStrDig_t *)ctx;
+
+    memcpy(dig->state, iv, sizeof(iv));
+    dig->len = 0;
+}
+
+static void sha256_update(void *ctx, const uint8_t *data, size_t dataSz)
+{
+    dig_update((tarStrDig_t *)ctx, sha256_blocks, data, dataSz);
+}
+
+static void sha256_final(void *ctx)
+{
+    tarStrDig_t *dig = (tarStrDig_t *)ctx;
+    unsigned     i;
+
+    dig_pad(dig, sha256_blocks, 1);
+    for (i = 0; i < 32; i++)
+    {
+        dig->digest[i] = (uint8_t)(dig->state[i / 4] >> (24 - 8 * (i % 4)));
+    }
+    dig->digestSz = 32;
+}
+
+const tarStrEx_hash_t tarStrDig_sha256 = {
+    .init   = sha256_init,
+    .update = sha256_update,
+    .final  = sha256_final,
+};
+
+/*** MD5 ***/
+
+#define ROTL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+/**
+ * @brief MD5 compression function, portable code
+ */
+static void md5_blocks(uint32_t *state, const uint8_t *data, size_t nBlocks)
+{
+    static const uint32_t k[64] = {
+        0xD76AA478, 0xE8C7B756, 0x242070DB, 0xC1BDCEEE, 0xF57C0FAF, 0x4787C62A, 0xA8304613, 0xFD469501,
+        0x698098D8, 0x8B44F7AF, 0xFFFF5BB1, 0x895CD7BE, 0x6B901122, 0xFD987193, 0xA679438E, 0x49B40821,
+        0xF61E2562, 0xC040B340, 0x265E5A51, 0xE9B6C7AA, 0xD62F105D, 0x02441453, 0xD8A1E681, 0xE7D3FBC8,
+        0x21E1CDE6, 0xC33707D6, 0xF4D50D87, 0x455A14ED, 0xA9E3E905, 0xFCEFA3F8, 0x676F02D9, 0x8D2A4C8A,
+        0xFFFA3942, 0x8771F681, 0x6D9D6122, 0xFDE5380C, 0xA4BEEA44, 0x4BDECFA9, 0xF6BB4B60, 0xBEBFBC70,
+        0x289B7EC6, 0xEAA127FA, 0xD4EF3085, 0x04881D05, 0xD9D4D039, 0xE6DB99E5, 0x1FA27CF8, 0xC4AC5665,
+        0xF4292244, 0x432AFF97, 0xAB9423A7, 0xFC93A039, 0x655B59C3, 0x8F0CCC92, 0xFFEFF47D, 0x85845DD1,
+        0x6FA87E4F, 0xFE2CE6E0, 0xA3014314, 0x4E0811A1, 0xF7537E82, 0xBD3AF235, 0x2AD7D2BB, 0xEB86D391,
+    };
+    static const uint8_t r[16] = {7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21};
+    uint32_t             m[16];
+    uint32_t             a, b, c, d, f, t;
+    unsigned             i, g;
+
+    for (; nBlocks > 0; nBlocks--, data += DIG_BLOCK_SIZE)
+    {
+        for (i = 0; i < 16; i++)
+        {
+            m[i] = data[4 * i] | ((uint32_t)data[4 * i + 1] << 8) | ((uint32_t)data[4 * i + 2] << 16) |
+                   ((uint32_t)data[4 * i + 3] << 24);
+        }
+        a = state[0];
+        b = state[1];
+        c = state[2];
+        d = state[3];
+        for (i = 0; i < 64; i++)
+        {
+            switch (i / 16)
+            {
+            case 0:
+                f = (b & c) | (~b & d);
+                g = i;
+                break;
+            case 1:
+                f = (d & b) | (~d & c);
+                g = (5 * i + 1) % 16;
+                break;
+            case 2:
+                f = b ^ c ^ d;
+                g = (3 * i + 5) % 16;
+                break;
+            default:
+                f = c ^ (b | ~d);
+                g = (7 * i) % 16;
+                break;
+            }
+            t = d;
+            d = c;
+            c = b;
+            b = b + ROTL32(a + f + k[i] + m[g], r[(i / 16) * 4 + i % 4]);
+            a = t;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+    }
+}
+
+static void md5_init(void *ctx)
+{
+    tarStrDig_t *dig = (tarStrDig_t *)ctx;
+
+    dig->state[0] = 0x67452301;
+    dig->state[1] = 0xEFCDAB89;
+    dig->state[2] = 0x98BADCFE;
+    dig->state[3] = 0x10325476;
+    dig->len      = 0;
+}
+
+static void md5_update(void *ctx, const uint8_t *data, size_t dataSz)
+{
+    dig_update((tarStrDig_t *)ctx, md5_blocks, data, dataSz);
+}
+
+static void md5_final(void *ctx)
+{
+    tarStrDig_t *dig = (tarStrDig_t *)ctx;
+    unsigned     i;
+
+    dig_pad(dig, md5_blocks, 0);
+    for (i = 0; i < 16; i++)
+    {
+        dig->digest[i] = (uint8_t)(dig->state[i / 4] >> (8 * (i % 4)));
+    }
+    dig->digestSz = 16;
+}
+
+const tarStrEx_hash_t tarStrDig_md5 = {
+    .init   = md5_init,
+    .update = md5_update,
+    .final  = md5_final,
+};
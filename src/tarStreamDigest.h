@@ -0,0 +1,56 @@
+
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TARSTREAMDIGEST_H
+#define SRC_TARSTREAMDIGEST_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tarStreamExtractor.h"
+
+/* size of the largest digest */
+#define TARSTRDIG_MAX_SZ 32
+
+/**
+ * @brief context of a digest, to be passed to tarStrEx_set_hash() along with one of the algorithms below
+ * the result is available in the fileFinalize callback. Contexts contain no pointers and need no cleanup
+ */
+typedef struct tarStrDig
+{
+    uint32_t state[8];                 /* chaining variables (or the crc) */
+    uint64_t len;                      /* number of bytes digested so far */
+    uint8_t  block[64];                /* bytes of a partial block */
+    uint8_t  digest[TARSTRDIG_MAX_SZ]; /* result, valid once the file is complete */
+    uint8_t  digestSz;                 /* number of bytes of the result */
+} tarStrDig_t;
+
+/* CRC-32C (Castagnoli), 4 bytes big-endian. Uses the SSE4.2 or ARMv8 CRC instructions when enabled */
+extern const tarStrEx_hash_t tarStrDig_crc32c;
+/* SHA-256, 32 bytes. Uses the x86 SHA extensions when enabled */
+extern const tarStrEx_hash_t tarStrDig_sha256;
+/* MD5, 16 bytes */
+extern const tarStrEx_hash_t tarStrDig_md5;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_TARSTREAMDIGEST_H */
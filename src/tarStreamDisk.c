@@ -0,0 +1,1322 @@
+
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Linux backend writing the members straight to disk. File data is collected into large aligned buffers, which are
+ * handed to the kernel either with one pwritev() every nBufs buffers, or with io_uring, keeping up to nBufs writes
+ * in flight while the engine fills the next buffer. With O_DIRECT the page cache is bypassed; the tail of each file
+ * is written padded to the alignment and the file is then truncated to its size.
+ * With workers, the full buffers are instead queued to a pool of threads, which write them and apply the metadata of
+ * the files, so that the syscalls of many files overlap; only directories and links are created by the calling
+ * thread. The metadata of directories is applied at the very end, deepest first, once nothing else gets into them.
+ * Paths are resolved by the kernel beneath the root directory (openat2() with RESOLVE_BENEATH, Linux 5.6 or later):
+ * symbolic links created by earlier members are followed only as long as they stay below the root, and the last
+ * component of a path is never followed, so that no chain of links can make the backend write outside the root.
+ */
+#define _GNU_SOURCE /* O_DIRECT, fallocate() */
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/openat2.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "tarStreamDisk.h"
+
+#define ALIGN_UP(x) (((x) + TARSTRDISK_ALIGN - 1) & ~(size_t)(TARSTRDISK_ALIGN - 1))
+
+/* no buffer is being filled */
+#define NO_BUF TARSTRDISK_MAX_BUFS
+
+/* number of file slots of the worker pool: every file has a buffer queued, except the one being received */
+#define FILE_SLOTS (TARSTRDISK_MAX_BUFS + 1)
+
+/**
+ * @brief record the first error met
+ *
+ * @param disk backend
+ * @param err error, as a positive errno
+ * @return -1, to be returned by the callbacks
+ */
+static int disk_fail(tarStrDisk_t *disk, int err)
+{
+    int none = 0;
+
+    /* workers may fail at the same time as the calling thread */
+    __atomic_compare_exchange_n(&disk->error, &none, -((0 != err) ? err : EIO), 0, __ATOMIC_RELAXED,
+                                __ATOMIC_RELAXED);
+    return -1;
+}
+
+/**
+ * @brief check whether an error has been met
+ *
+ * @param disk backend
+ * @return non-zero after an error
+ */
+static int disk_failed(const tarStrDisk_t *disk)
+{
+    return 0 != __atomic_load_n(&disk->error, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief make a member path relative to the root directory
+ * leading "./" are removed. Absolute paths and paths with ".." components are rejected; symbolic links met along the
+ * path are taken care of by dir_open()
+ *
+ * @param path path of the member
+ * @return relative path (possibly empty), or NULL if the path is not acceptable
+ */
+static const char *path_rel(const char *path)
+{
+    const char *p;
+
+    while (('.' == path[0]) && ('/' == path[1]))
+    {
+        path += 2;
+        while ('/' == *path)
+        {
+            path++;
+        }
+    }
+    if ('/' == path[0])
+    {
+        return NULL;
+    }
+    for (p = path; '\0' != *p;)
+    {
+        if (('.' == p[0]) && ('.' == p[1]) && (('/' == p[2]) || ('\0' == p[2])))
+        {
+            return NULL;
+        }
+        p += strcspn(p, "/");
+        p += strspn(p, "/");
+    }
+    return path;
+}
+
+/**
+ * @brief check that a symbolic link does not point outside the root directory
+ * the target is resolved lexically, starting from the directory holding the link. This keeps out links that are
+ * plainly escaping, but a link may still point out through other links: writes are kept inside the root by dir_open()
+ *
+ * @param rel relative path of the link
+ * @param target target of the link
+ * @return non-zero if the link is acceptable
+ */
+static int link_safe(const char *rel, const char *target)
+{
+    long        depth = 0;
+    const char *p;
+    size_t      len;
+
+    if ('/' == target[0])
+    {
+        return 0;
+    }
+    /* number of directories above the link */
+    for (p = rel; '\0' != *p;)
+    {
+        p += strcspn(p, "/");
+        if ('\0' != p[strspn(p, "/")])
+        {
+            depth++;
+        }
+        p += strspn(p, "/");
+    }
+    for (p = target; '\0' != *p;)
+    {
+        len = strcspn(p, "/");
+        if ((2 == len) && ('.' == p[0]) && ('.' == p[1]))
+        {
+            if (--depth < 0)
+            {
+                return 0;
+            }
+        }
+        else if ((0 != len) && !((1 == len) && ('.' == p[0])))
+        {
+            depth++;
+        }
+        p += len;
+        p += strspn(p, "/");
+    }
+    return 1;
+}
+
+/**
+ * @brief open the directory holding a path, without leaving the root directory
+ * the directories along the path are resolved by the kernel beneath the root: a symbolic link leading outside it,
+ * directly or through other links, makes the resolution fail with EXDEV. The last component is left to the caller,
+ * that must not follow it (O_NOFOLLOW, AT_SYMLINK_NOFOLLOW, or calls that never follow it)
+ *
+ * @param disk backend
+ * @param rel relative path, trailing slashes allowed
+ * @param[out] tmp buffer of TARSTEX_PATH_MAX bytes, receives the last component
+ * @param[out] base last component of the path, into tmp
+ * @return descriptor of the directory, to be closed, or -1 with errno set
+ */
+static int dir_open(const tarStrDisk_t *disk, const char *rel, char *tmp, const char **base)
+{
+    struct open_how how = {.flags = O_PATH | O_DIRECTORY | O_CLOEXEC, .resolve = RESOLVE_BENEATH};
+    size_t          len = strlen(rel);
+    char           *slash;
+    int             fd;
+
+    if (len >= TARSTEX_PATH_MAX)
+    {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memcpy(tmp, rel, len + 1);
+    while ((len > 1) && ('/' == tmp[len - 1]))
+    {
+        tmp[--len] = '\0';
+    }
+    slash = strrchr(tmp, '/');
+    if (NULL == slash)
+    {
+        *base = tmp;
+        fd    = (int)syscall(SYS_openat2, disk->cfg.rootFd, ".", &how, sizeof(how));
+    }
+    else
+    {
+        *slash = '\0';
+        *base  = slash + 1;
+        fd     = (int)syscall(SYS_openat2, disk->cfg.rootFd, tmp, &how, sizeof(how));
+    }
+    return fd;
+}
+
+/**
+ * @brief create a directory beneath the root directory
+ *
+ * @param disk backend
+ * @param rel relative path
+ * @return 0 on success, or -1 with errno set
+ */
+static int dir_make(const tarStrDisk_t *disk, const char *rel)
+{
+    char        tmp[TARSTEX_PATH_MAX];
+    const char *base;
+    int         dirFd = dir_open(disk, rel, tmp, &base);
+    int         res, err;
+
+    if (dirFd < 0)
+    {
+        return -1;
+    }
+    res = mkdirat(dirFd, base, 0755); /* never follows a link */
+    err = errno;
+    close(dirFd);
+    errno = err;
+    return res;
+}
+
+/**
+ * @brief create the missing parent directories of a path
+ *
+ * @param disk backend
+ * @param rel relative path
+ * @return 0 on success, or -1 with errno set
+ */
+static int make_parents(tarStrDisk_t *disk, const char *rel)
+{
+    char   tmp[TARSTEX_PATH_MAX];
+    size_t i, len = strlen(rel);
+
+    if (len >= sizeof(tmp))
+    {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memcpy(tmp, rel, len + 1);
+    for (i = 1; i < len; i++)
+    {
+        if (('/' == tmp[i]) && ('/' != tmp[i - 1]))
+        {
+            tmp[i] = '\0';
+            if ((0 != dir_make(disk, tmp)) && (EEXIST != errno))
+            {
+                return -1;
+            }
+            tmp[i] = '/';
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief write buffers with pwritev(), resuming after partial writes
+ *
+ * @param fd file
+ * @param iov buffers
+ * @param n number of buffers
+ * @param[in,out] off file offset, advanced past the bytes written
+ * @return 0 on success, or -1 with errno set
+ */
+static int write_all(int fd, struct iovec *iov, unsigned n, uint64_t *off)
+{
+    ssize_t res;
+
+    while (n > 0)
+    {
+        res = pwritev(fd, iov, (int)n, (off_t)*off);
+        if (res < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            return -1;
+        }
+        if (0 == res)
+        {
+            errno = EIO;
+            return -1;
+        }
+        *off += (uint64_t)res;
+        while ((n > 0) && ((size_t)res >= iov->iov_len))
+        {
+            res -= (ssize_t)iov->iov_len;
+            iov++;
+            n--;
+        }
+        if (n > 0)
+        {
+            iov->iov_base = (uint8_t *)iov->iov_base + res;
+            iov->iov_len -= (size_t)res;
+        }
+    }
+    return 0;
+}
+
+#ifdef TARSTEX_WITH_URING
+/**
+ * @brief submit again the part of a buffer left over by a short write
+ * with O_DIRECT the rest must still be aligned: if it is not, the write fails with EINVAL
+ *
+ * @param disk backend
+ * @param buf buffer
+ * @param done bytes of the buffer written so far
+ * @return 0 on success, or -1 with errno set
+ */
+static int uring_rewrite(tarStrDisk_t *disk, unsigned buf, size_t done)
+{
+    struct io_uring_sqe *sqe = io_uring_get_sqe(&disk->ring);
+    int                  res;
+
+    if (NULL == sqe)
+    {
+        errno = EBUSY;
+        return -1;
+    }
+    disk->iov[buf].iov_base = (uint8_t *)disk->iov[buf].iov_base + done;
+    disk->iov[buf].iov_len -= done;
+    disk->wOff[buf] += done;
+    io_uring_prep_write(sqe, disk->fd, disk->iov[buf].iov_base, (unsigned)disk->iov[buf].iov_len, disk->wOff[buf]);
+    io_uring_sqe_set_data(sqe, (void *)(uintptr_t)buf);
+    res = io_uring_submit(&disk->ring);
+    if (res < 0)
+    {
+        errno = -res;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief submit the prepared writes and reap completions until the condition is met
+ *
+ * @param disk backend
+ * @param buf wait until this buffer is released, or for all writes in flight if TARSTRDISK_MAX_BUFS
+ * @return 0 on success, or -1 with errno set
+ */
+static int uring_wait(tarStrDisk_t *disk, unsigned buf)
+{
+    struct io_uring_cqe *cqe = NULL;
+    unsigned             id;
+    int                  res;
+
+    if (0 != disk->queued)
+    {
+        res = io_uring_submit(&disk->ring);
+        if (res < 0)
+        {
+            errno = -res;
+            return -1;
+        }
+        disk->queued = 0;
+    }
+    while ((0 != disk->inFlight) && ((TARSTRDISK_MAX_BUFS == buf) || (0 != disk->busy[buf])))
+    {
+        res = io_uring_wait_cqe(&disk->ring, &cqe);
+        if (res < 0)
+        {
+            if (-EINTR == res)
+            {
+                continue;
+            }
+            errno = -res;
+            return -1;
+        }
+        id  = (unsigned)(uintptr_t)io_uring_cqe_get_data(cqe);
+        res = cqe->res;
+        io_uring_cqe_seen(&disk->ring, cqe);
+        if ((res > 0) && ((size_t)res < disk->iov[id].iov_len))
+        {
+            /* short write: the buffer stays busy until the rest is written */
+            if (0 != uring_rewrite(disk, id, (size_t)res))
+            {
+                return -1;
+            }
+            continue;
+        }
+        disk->busy[id] = 0;
+        disk->inFlight--;
+        if (res < 0)
+        {
+            errno = -res;
+            return -1;
+        }
+        if (0 == res)
+        {
+            errno = EIO;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief prepare the write of the current buffer. It is submitted along with the others when a buffer is needed
+ *
+ * @param disk backend
+ * @param len number of bytes to write
+ * @return 0 on success, or -1 with errno set
+ */
+static int uring_queue(tarStrDisk_t *disk, size_t len)
+{
+    struct io_uring_sqe *sqe = io_uring_get_sqe(&disk->ring);
+
+    if (NULL == sqe)
+    {
+        /* the submission queue is as large as the number of buffers, it can't be full */
+        errno = EBUSY;
+        return -1;
+    }
+    disk->iov[disk->cur].iov_base = disk->cfg.bufMem + disk->cur * disk->cfg.bufSz;
+    disk->iov[disk->cur].iov_len  = len;
+    disk->wOff[disk->cur]         = disk->off;
+    io_uring_prep_write(sqe, disk->fd, disk->iov[disk->cur].iov_base, (unsigned)len, disk->off);
+    io_uring_sqe_set_data(sqe, (void *)(uintptr_t)disk->cur);
+    disk->busy[disk->cur] = 1;
+    disk->inFlight++;
+    disk->queued++;
+    disk->off += len;
+    return 0;
+}
+#endif
+
+/**
+ * @brief hand the current buffer to the kernel and move to the next one
+ *
+ * @param disk backend
+ * @param len number of bytes to write
+ * @return 0 on success, or -1 with errno set
+ */
+static int buffer_done(tarStrDisk_t *disk, size_t len)
+{
+#ifdef TARSTEX_WITH_URING
+    if (0 != (disk->cfg.flags & TARSTRDISK_F_URING))
+    {
+        if (0 != uring_queue(disk, len))
+        {
+            return -1;
+        }
+        disk->cur  = (disk->cur + 1) % disk->cfg.nBufs;
+        disk->fill = 0;
+        return uring_wait(disk, disk->cur); /* the next buffer must be free */
+    }
+#endif
+    disk->iov[disk->pending].iov_base = disk->cfg.bufMem + disk->cur * disk->cfg.bufSz;
+    disk->iov[disk->pending].iov_len  = len;
+    disk->pending++;
+    disk->cur++;
+    disk->fill = 0;
+    if (disk->pending == disk->cfg.nBufs)
+    {
+        disk->cur     = 0;
+        disk->pending = 0;
+        return write_all(disk->fd, disk->iov, disk->cfg.nBufs, &disk->off);
+    }
+    return 0;
+}
+
+/**
+ * @brief write out the buffers not yet handed to the kernel, and wait for the writes in flight
+ *
+ * @param disk backend
+ * @return 0 on success, or -1 with errno set
+ */
+static int buffers_flush(tarStrDisk_t *disk)
+{
+    unsigned n = disk->pending;
+
+#ifdef TARSTEX_WITH_URING
+    if (0 != (disk->cfg.flags & TARSTRDISK_F_URING))
+    {
+        return uring_wait(disk, TARSTRDISK_MAX_BUFS);
+    }
+#endif
+    disk->cur     = 0;
+    disk->pending = 0;
+    return write_all(disk->fd, disk->iov, n, &disk->off);
+}
+
+/**
+ * @brief apply the metadata of a file whose data have all been written, and close it
+ *
+ * @param disk backend
+ * @param fd file
+ * @param size size of the file
+ * @param mtime modification time of the file
+ * @param mode permission bits of the file
+ * @param direct the file has been opened with O_DIRECT, its tail has to be cut away
+ * @return 0 on success, or -1 with errno set
+ */
+static int file_close(const tarStrDisk_t *disk, int fd, uint64_t size, int64_t mtime, uint32_t mode, int direct)
+{
+    int res = 0;
+    int err;
+
+    if (direct && (0 != (size % TARSTRDISK_ALIGN)))
+    {
+        res = ftruncate(fd, (off_t)size);
+    }
+    if ((0 == res) && (0 != (disk->cfg.flags & TARSTRDISK_F_MODES)) && (0 != (mode & 07777)))
+    {
+        res = fchmod(fd, mode & 07777);
+    }
+    if ((0 == res) && (0 != (disk->cfg.flags & TARSTRDISK_F_TIMES)))
+    {
+        struct timespec times[2] = {{.tv_nsec = UTIME_OMIT}, {.tv_sec = (time_t)mtime}};
+        res                      = futimens(fd, times);
+    }
+    if (0 != res)
+    {
+        err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    return close(fd);
+}
+
+/**
+ * @brief close a file slot of the worker pool once all its writes are complete, and release it
+ * after a failed write the file is only closed: it is neither trimmed to its size nor given its times and mode
+ *
+ * @param disk backend
+ * @param f file slot
+ */
+static void slot_close(tarStrDisk_t *disk, tarStrDisk_file_t *f)
+{
+    if (disk_failed(disk))
+    {
+        close(f->fd);
+    }
+    else if (0 != file_close(disk, f->fd, f->size, f->mtime, f->mode, f->direct))
+    {
+        disk_fail(disk, errno);
+    }
+    pthread_mutex_lock(&disk->lock);
+    f->fd = -1;
+    pthread_cond_broadcast(&disk->released);
+    pthread_mutex_unlock(&disk->lock);
+}
+
+/**
+ * @brief worker thread: writes the queued buffers, and closes the files whose writes are all complete
+ *
+ * @param arg backend
+ * @return NULL
+ */
+static void *worker_main(void *arg)
+{
+    tarStrDisk_t      *disk = (tarStrDisk_t *)arg;
+    tarStrDisk_file_t *f;
+    struct iovec       iov;
+    uint64_t           off;
+    unsigned           buf;
+    int                last, err;
+
+    pthread_mutex_lock(&disk->lock);
+    for (;;)
+    {
+        while ((0 == disk->readyCount) && !disk->stop)
+        {
+            pthread_cond_wait(&disk->work, &disk->lock);
+        }
+        if (0 == disk->readyCount)
+        {
+            break; /* stopped, and nothing left to write */
+        }
+        buf             = disk->ready[disk->readyHead];
+        disk->readyHead = (disk->readyHead + 1) % TARSTRDISK_MAX_BUFS;
+        disk->readyCount--;
+        f = &disk->files[disk->jobFile[buf]];
+        pthread_mutex_unlock(&disk->lock);
+
+        err = 0;
+        if (!disk_failed(disk))
+        {
+            iov.iov_base = disk->cfg.bufMem + buf * disk->cfg.bufSz;
+            iov.iov_len  = disk->jobLen[buf];
+            off          = disk->jobOff[buf];
+            err          = (0 != write_all(f->fd, &iov, 1, &off)) ? errno : 0;
+        }
+        if (0 != err)
+        {
+            disk_fail(disk, err);
+        }
+
+        pthread_mutex_lock(&disk->lock);
+        disk->bufFree[buf] = 1;
+        f->jobs--;
+        last = f->queued && (0 == f->jobs);
+        pthread_cond_broadcast(&disk->released);
+        if (last)
+        {
+            pthread_mutex_unlock(&disk->lock);
+            slot_close(disk, f);
+            pthread_mutex_lock(&disk->lock);
+        }
+    }
+    pthread_mutex_unlock(&disk->lock);
+    return NULL;
+}
+
+/**
+ * @brief get a free buffer to be filled, waiting for the workers if needed
+ *
+ * @param disk backend
+ */
+static void pool_get_buffer(tarStrDisk_t *disk)
+{
+    unsigned i;
+
+    pthread_mutex_lock(&disk->lock);
+    for (;;)
+    {
+        for (i = 0; (i < disk->cfg.nBufs) && !disk->bufFree[i]; i++)
+        {
+        }
+        if (i < disk->cfg.nBufs)
+        {
+            break;
+        }
+        pthread_cond_wait(&disk->released, &disk->lock);
+    }
+    disk->bufFree[i] = 0;
+    pthread_mutex_unlock(&disk->lock);
+    disk->cur  = i;
+    disk->fill = 0;
+}
+
+/**
+ * @brief queue the current buffer to the workers
+ *
+ * @param disk backend
+ * @param len number of bytes to write
+ */
+static void pool_queue(tarStrDisk_t *disk, size_t len)
+{
+    pthread_mutex_lock(&disk->lock);
+    disk->jobFile[disk->cur] = disk->file;
+    disk->jobOff[disk->cur]  = disk->off;
+    disk->jobLen[disk->cur]  = len;
+    disk->files[disk->file].jobs++;
+    disk->ready[(disk->readyHead + disk->readyCount) % TARSTRDISK_MAX_BUFS] = disk->cur;
+    disk->readyCount++;
+    pthread_cond_signal(&disk->work);
+    pthread_mutex_unlock(&disk->lock);
+    disk->off += len;
+    disk->cur  = NO_BUF;
+    disk->fill = 0;
+}
+
+/**
+ * @brief hand an open file to the worker pool, waiting for a free slot if needed
+ *
+ * @param disk backend
+ * @param fd file
+ * @param entry description of the file
+ * @param direct the file has been opened with O_DIRECT
+ */
+static void pool_file_begin(tarStrDisk_t *disk, int fd, const tarStrEx_entry_t *entry, int direct)
+{
+    unsigned i;
+
+    pthread_mutex_lock(&disk->lock);
+    for (;;)
+    {
+        for (i = 0; (i < FILE_SLOTS) && (disk->files[i].fd >= 0); i++)
+        {
+        }
+        if (i < FILE_SLOTS)
+        {
+            break;
+        }
+        pthread_cond_wait(&disk->released, &disk->lock);
+    }
+    disk->files[i] = (tarStrDisk_file_t){
+        .fd     = fd,
+        .direct = direct,
+        .size   = entry->size,
+        .mtime  = entry->mtime,
+        .mode   = entry->mode,
+        .jobs   = 0,
+        .queued = 0,
+    };
+    pthread_mutex_unlock(&disk->lock);
+    disk->file = i;
+    disk->off  = 0;
+    disk->cur  = NO_BUF;
+    disk->fill = 0;
+}
+
+/**
+ * @brief all the data of the file being received have been queued: the last write closes it
+ *
+ * @param disk backend
+ */
+static void pool_file_end(tarStrDisk_t *disk)
+{
+    tarStrDisk_file_t *f = &disk->files[disk->file];
+    int                last;
+
+    pthread_mutex_lock(&disk->lock);
+    f->queued = 1;
+    last      = (0 == f->jobs);
+    pthread_mutex_unlock(&disk->lock);
+    if (last)
+    {
+        slot_close(disk, f); /* no write is pending, e.g. an empty file */
+    }
+}
+
+/**
+ * @brief stop the workers once they have written all the queued buffers
+ *
+ * @param disk backend
+ */
+static void pool_stop(tarStrDisk_t *disk)
+{
+    unsigned i;
+
+    pthread_mutex_lock(&disk->lock);
+    disk->stop = 1;
+    pthread_cond_broadcast(&disk->work);
+    pthread_mutex_unlock(&disk->lock);
+    for (i = 0; i < disk->nThreads; i++)
+    {
+        pthread_join(disk->threads[i], NULL);
+    }
+    disk->nThreads = 0;
+    for (i = 0; i < FILE_SLOTS; i++)
+    {
+        if (disk->files[i].fd >= 0)
+        {
+            /* the engine has not finalized the file */
+            close(disk->files[i].fd);
+            disk->files[i].fd = -1;
+        }
+    }
+    pthread_cond_destroy(&disk->released);
+    pthread_cond_destroy(&disk->work);
+    pthread_mutex_destroy(&disk->lock);
+}
+
+/**
+ * @brief open a file, replacing an existing one
+ * with workers an existing file is unlinked rather than truncated, as writes of an earlier member with the same
+ * path may still be pending on it. A symbolic link in place of the file is replaced as well, never followed
+ *
+ * @param disk backend
+ * @param rel relative path
+ * @param flags open flags
+ * @param mode permission bits
+ * @return file descriptor, or -1 with errno set
+ */
+static int file_open(tarStrDisk_t *disk, const char *rel, int flags, mode_t mode)
+{
+    char        tmp[TARSTEX_PATH_MAX];
+    const char *base;
+    int         dirFd = dir_open(disk, rel, tmp, &base);
+    int         fd, err;
+
+    if (dirFd < 0)
+    {
+        return -1;
+    }
+    flags |= O_NOFOLLOW;
+    if (0 != disk->cfg.nWorkers)
+    {
+        flags = (flags & ~O_TRUNC) | O_EXCL;
+    }
+    fd = openat(dirFd, base, flags, mode);
+    if ((fd < 0) && ((EEXIST == errno) || (ELOOP == errno)) && (0 == unlinkat(dirFd, base, 0)))
+    {
+        fd = openat(dirFd, base, flags, mode);
+    }
+    err = errno;
+    close(dirFd);
+    errno = err;
+    return fd;
+}
+
+static int disk_entry(void *param, const tarStrEx_entry_t *entry)
+{
+    tarStrDisk_t *disk = (tarStrDisk_t *)param;
+
+    /* dirCreate receives the path only */
+    disk->entryMtime = entry->mtime;
+    disk->entryMode  = entry->mode;
+    return 0;
+}
+
+static int disk_fileInit(void *param, const tarStrEx_entry_t *entry)
+{
+    tarStrDisk_t *disk  = (tarStrDisk_t *)param;
+    const char   *rel   = path_rel(entry->name);
+    int           flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    mode_t        mode  = (0 != (entry->mode & 07777)) ? (entry->mode & 07777) : 0644;
+
+    if (disk_failed(disk))
+    {
+        return -1;
+    }
+    if ((NULL == rel) || ('\0' == rel[0]))
+    {
+        return disk_fail(disk, EPERM);
+    }
+    /* without a map the engine delivers the data as stored, through recvData, as for a regular file */
+    disk->sparse = (TAR_TYPE_SPARSE == entry->type) && (NULL != disk->cfg.sparseMap);
+    if ((0 != (disk->cfg.flags & TARSTRDISK_F_DIRECT)) && (0 == (disk->cfg.flags & TARSTRDISK_F_SPLICE)) &&
+        !disk->sparse)
+    {
+        flags |= O_DIRECT;
+    }
+    disk->fd = file_open(disk, rel, flags, mode);
+    if ((disk->fd < 0) && (ENOENT == errno) && (0 == make_parents(disk, rel)))
+    {
+        disk->fd = file_open(disk, rel, flags, mode);
+    }
+    if ((disk->fd < 0) && (EINVAL == errno) && (0 != (flags & O_DIRECT)))
+    {
+        /* the filesystem does not support O_DIRECT */
+        flags &= ~O_DIRECT;
+        disk->fd = file_open(disk, rel, flags, mode);
+    }
+    if (disk->fd < 0)
+    {
+        return disk_fail(disk, errno);
+    }
+    disk->direct = (0 != (flags & O_DIRECT));
+    if (disk->sparse)
+    {
+        /* written at random offsets straight from the engine, the holes must not be allocated */
+        disk->size  = entry->size;
+        disk->mtime = entry->mtime;
+        disk->mode  = entry->mode;
+        return 0;
+    }
+    if ((0 != (disk->cfg.flags & TARSTRDISK_F_PREALLOC)) && (0 != entry->size) &&
+        (0 != fallocate(disk->fd, 0, 0, (off_t)entry->size)) && (EOPNOTSUPP != errno) && (ENOSYS != errno))
+    {
+        int err = errno; /* e.g. ENOSPC: better to know it before writing */
+        close(disk->fd);
+        disk->fd = -1;
+        return disk_fail(disk, err);
+    }
+    if (0 != disk->cfg.nWorkers)
+    {
+        /* from now on the file belongs to the workers */
+        pool_file_begin(disk, disk->fd, entry, disk->direct);
+        disk->fd = -1;
+        return 0;
+    }
+    disk->size    = entry->size;
+    disk->mtime   = entry->mtime;
+    disk->mode    = entry->mode;
+    disk->off     = 0;
+    disk->cur     = 0;
+    disk->fill    = 0;
+    disk->pending = 0;
+    /* bytes pushed to recvData all precede those written by the caller, at the offsets the engine gives */
+    return (0 != (disk->cfg.flags & TARSTRDISK_F_SPLICE)) ? TARSTEX_CB_PASSTHROUGH : 0;
+}
+
+static int disk_recvData(void *param, const uint8_t *data, size_t dataSz)
+{
+    tarStrDisk_t *disk = (tarStrDisk_t *)param;
+    size_t        n;
+
+    while (dataSz > 0)
+    {
+        if (NO_BUF == disk->cur)
+        {
+            pool_get_buffer(disk);
+        }
+        n = disk->cfg.bufSz - disk->fill;
+        if (n > dataSz)
+        {
+            n = dataSz;
+        }
+        memcpy(disk->cfg.bufMem + disk->cur * disk->cfg.bufSz + disk->fill, data, n);
+        disk->fill += n;
+        data += n;
+        dataSz -= n;
+        if (disk->fill == disk->cfg.bufSz)
+        {
+            if (0 != disk->cfg.nWorkers)
+            {
+                pool_queue(disk, disk->cfg.bufSz);
+            }
+            else if (0 != buffer_done(disk, disk->cfg.bufSz))
+            {
+                return disk_fail(disk, errno);
+            }
+        }
+    }
+    return disk_failed(disk) ? -1 : 0;
+}
+
+static int disk_recvDataAt(void *param, uint64_t fileOffset, const uint8_t *data, size_t dataSz)
+{
+    tarStrDisk_t *disk = (tarStrDisk_t *)param;
+    ssize_t       n;
+
+    while (dataSz > 0)
+    {
+        n = pwrite(disk->fd, data, dataSz, (off_t)fileOffset);
+        if (n < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            return disk_fail(disk, errno);
+        }
+        data += n;
+        dataSz -= (size_t)n;
+        fileOffset += (uint64_t)n;
+    }
+    return disk_failed(disk) ? -1 : 0;
+}
+
+static int disk_fileFinalize(void *param)
+{
+    tarStrDisk_t *disk = (tarStrDisk_t *)param;
+    size_t        len  = disk->fill;
+    int           res  = 0;
+
+    if (disk->sparse)
+    {
+        /* a trailing hole is not written: the size is set explicitly */
+        disk->sparse = 0;
+        if (0 != ftruncate(disk->fd, (off_t)disk->size))
+        {
+            res = disk_fail(disk, errno);
+            close(disk->fd);
+        }
+        else if (0 != file_close(disk, disk->fd, disk->size, disk->mtime, disk->mode, 0))
+        {
+            res = disk_fail(disk, errno);
+        }
+        disk->fd = -1;
+        return (0 == res) ? 0 : -1;
+    }
+    if (0 != disk->cfg.nWorkers)
+    {
+        if (0 != len)
+        {
+            if (disk->files[disk->file].direct)
+            {
+                /* O_DIRECT needs whole aligned blocks: the padding is cut away afterwards */
+                len = ALIGN_UP(disk->fill);
+                memset(disk->cfg.bufMem + disk->cur * disk->cfg.bufSz + disk->fill, 0, len - disk->fill);
+            }
+            pool_queue(disk, len);
+        }
+        pool_file_end(disk);
+        return disk_failed(disk) ? -1 : 0;
+    }
+    if (0 != len)
+    {
+        if (disk->direct)
+        {
+            /* O_DIRECT needs whole aligned blocks: the padding is cut away afterwards */
+            len = ALIGN_UP(disk->fill);
+            memset(disk->cfg.bufMem + disk->cur * disk->cfg.bufSz + disk->fill, 0, len - disk->fill);
+        }
+        res = buffer_done(disk, len);
+    }
+    if (0 == res)
+    {
+        res = buffers_flush(disk);
+    }
+    if (0 != res)
+    {
+        disk_fail(disk, errno);
+        close(disk->fd);
+    }
+    else if (0 != file_close(disk, disk->fd, disk->size, disk->mtime, disk->mode, disk->direct))
+    {
+        res = disk_fail(disk, errno);
+    }
+    disk->fd = -1;
+    return (0 == res) ? 0 : -1;
+}
+
+/**
+ * @brief record a directory, whose metadata are applied at the end of the extraction
+ * directories are created writable, so that their members can be created whatever their mode is, and their mtime
+ * would be changed by every member created later on
+ *
+ * @param disk backend
+ * @param rel relative path of the directory
+ * @return 0 on success, -1 if the storage is full
+ */
+static int dir_record(tarStrDisk_t *disk, const char *rel)
+{
+    size_t len = strlen(rel) + 1;
+
+    if ((NULL == disk->cfg.dirs) || (0 == (disk->cfg.flags & (TARSTRDISK_F_MODES | TARSTRDISK_F_TIMES))))
+    {
+        return 0;
+    }
+    if ((disk->nDirs == disk->cfg.maxDirs) || (len > disk->cfg.dirNamesSz - disk->dirNamesIdx))
+    {
+        return disk_fail(disk, ENOBUFS);
+    }
+    memcpy(&disk->cfg.dirNames[disk->dirNamesIdx], rel, len);
+    disk->cfg.dirs[disk->nDirs] = (tarStrDisk_dir_t){
+        .mtime   = disk->entryMtime,
+        .mode    = disk->entryMode,
+        .nameIdx = (uint32_t)disk->dirNamesIdx,
+    };
+    disk->nDirs++;
+    disk->dirNamesIdx += len;
+    return 0;
+}
+
+/**
+ * @brief apply the metadata of the recorded directories, the last found first
+ * in an archive a directory comes before its members, so subdirectories are done before their parents
+ *
+ * @param disk backend
+ */
+static void dirs_apply(tarStrDisk_t *disk)
+{
+    const tarStrDisk_dir_t *dir;
+    char                    tmp[TARSTEX_PATH_MAX];
+    const char             *base;
+    unsigned                i;
+    int                     dirFd;
+
+    for (i = disk->nDirs; i-- > 0;)
+    {
+        dir   = &disk->cfg.dirs[i];
+        dirFd = dir_open(disk, &disk->cfg.dirNames[dir->nameIdx], tmp, &base);
+        if (dirFd < 0)
+        {
+            disk_fail(disk, errno);
+            continue;
+        }
+        /* the directory was created by mkdirat(), a link cannot have replaced it since */
+        if ((0 != (disk->cfg.flags & TARSTRDISK_F_MODES)) && (0 != (dir->mode & 07777)) &&
+            (0 != fchmodat(dirFd, base, dir->mode & 07777, 0)))
+        {
+            disk_fail(disk, errno);
+        }
+        if (0 != (disk->cfg.flags & TARSTRDISK_F_TIMES))
+        {
+            struct timespec times[2] = {{.tv_nsec = UTIME_OMIT}, {.tv_sec = (time_t)dir->mtime}};
+            if (0 != utimensat(dirFd, base, times, AT_SYMLINK_NOFOLLOW))
+            {
+                disk_fail(disk, errno);
+            }
+        }
+        close(dirFd);
+    }
+    disk->nDirs = 0;
+}
+
+static int disk_dirCreate(void *param, const char *path)
+{
+    tarStrDisk_t *disk = (tarStrDisk_t *)param;
+    const char   *rel  = path_rel(path);
+    int           res;
+
+    if (disk_failed(disk))
+    {
+        return -1;
+    }
+    if (NULL == rel)
+    {
+        return disk_fail(disk, EPERM);
+    }
+    if ('\0' == rel[0])
+    {
+        return 0; /* the root directory itself */
+    }
+    res = dir_make(disk, rel);
+    if ((0 != res) && (ENOENT == errno) && (0 == make_parents(disk, rel)))
+    {
+        res = dir_make(disk, rel);
+    }
+    if ((0 != res) && (EEXIST != errno))
+    {
+        return disk_fail(disk, errno);
+    }
+    return dir_record(disk, rel);
+}
+
+/**
+ * @brief create a hard or symbolic link beneath the root directory
+ * neither the link nor (for hard links) the target is followed if it is a symbolic link itself
+ *
+ * @param disk backend
+ * @param type TAR_TYPE_LNK or TAR_TYPE_SYM
+ * @param rel relative path of the link
+ * @param target relative path of the target (hard link), or contents of the link (symbolic link)
+ * @param replace unlink an existing member first
+ * @return 0 on success, or -1 with errno set
+ */
+static int link_make(const tarStrDisk_t *disk, char type, const char *rel, const char *target, int replace)
+{
+    char        tmp[TARSTEX_PATH_MAX];
+    char        tgtTmp[TARSTEX_PATH_MAX];
+    const char *base, *tgtBase;
+    int         dirFd = dir_open(disk, rel, tmp, &base);
+    int         tgtFd = -1;
+    int         res   = -1;
+    int         err;
+
+    if (dirFd < 0)
+    {
+        return -1;
+    }
+    if ((TAR_TYPE_LNK == type) && ((tgtFd = dir_open(disk, target, tgtTmp, &tgtBase)) < 0))
+    {
+        err = errno;
+        close(dirFd);
+        errno = err;
+        return -1;
+    }
+    if (!replace || (0 == unlinkat(dirFd, base, 0)))
+    {
+        res = (TAR_TYPE_LNK == type) ? linkat(tgtFd, tgtBase, dirFd, base, 0) : symlinkat(target, dirFd, base);
+    }
+    err = errno;
+    if (tgtFd >= 0)
+    {
+        close(tgtFd);
+    }
+    close(dirFd);
+    errno = err;
+    return res;
+}
+
+static int disk_link(void *param, const tarStrEx_entry_t *entry)
+{
+    tarStrDisk_t *disk    = (tarStrDisk_t *)param;
+    const char   *rel     = path_rel(entry->name);
+    const char   *target  = entry->linkname;
+    int           replace = 0;
+    int           retry, res = -1;
+
+    if (disk_failed(disk))
+    {
+        return -1;
+    }
+    if ((NULL == rel) || ('\0' == rel[0]) || (NULL == target))
+    {
+        return disk_fail(disk, EPERM);
+    }
+    if (TAR_TYPE_LNK == entry->type)
+    {
+        target = path_rel(target); /* hard links name another member of the archive */
+    }
+    else if (!link_safe(rel, target))
+    {
+        target = NULL;
+    }
+    if (NULL == target)
+    {
+        return disk_fail(disk, EPERM);
+    }
+    for (retry = 0; retry < 3; retry++)
+    {
+        res = link_make(disk, entry->type, rel, target, replace);
+        if ((0 == res) || ((EEXIST != errno) && (ENOENT != errno)))
+        {
+            break;
+        }
+        /* replace an existing member, or create the missing directories */
+        replace = (EEXIST == errno);
+        if ((ENOENT == errno) && (0 != make_parents(disk, rel)))
+        {
+            break;
+        }
+    }
+    return (0 == res) ? 0 : disk_fail(disk, errno);
+}
+
+/**
+ * @brief start the worker pool
+ *
+ * @param disk backend
+ * @return 0 on success, or a negative value representing fault
+ */
+static int pool_start(tarStrDisk_t *disk)
+{
+    unsigned i;
+
+    pthread_mutex_init(&disk->lock, NULL);
+    pthread_cond_init(&disk->work, NULL);
+    pthread_cond_init(&disk->released, NULL);
+    for (i = 0; i < TARSTRDISK_MAX_BUFS; i++)
+    {
+        disk->bufFree[i] = 1;
+    }
+    for (i = 0; i < FILE_SLOTS; i++)
+    {
+        disk->files[i].fd = -1;
+    }
+    disk->cur = NO_BUF;
+    for (disk->nThreads = 0; disk->nThreads < disk->cfg.nWorkers; disk->nThreads++)
+    {
+        if (0 != pthread_create(&disk->threads[disk->nThreads], NULL, worker_main, disk))
+        {
+            pool_stop(disk);
+            return TARSTEX_EFAILURE;
+        }
+    }
+    return TARSTEX_ESUCCESS;
+}
+
+int tarStrDisk_init(tarStrDisk_t *disk, const tarStrDisk_cfg_t *cfg)
+{
+    if ((NULL == cfg->bufMem) || (0 != ((uintptr_t)cfg->bufMem % TARSTRDISK_ALIGN)) || (0 == cfg->bufSz) ||
+        (0 != (cfg->bufSz % TARSTRDISK_ALIGN)) || (0 == cfg->nBufs) || (cfg->nBufs > TARSTRDISK_MAX_BUFS) ||
+        (cfg->nWorkers > TARSTRDISK_MAX_WORKERS) ||
+        ((0 != cfg->nWorkers) && (0 != (cfg->flags & (TARSTRDISK_F_URING | TARSTRDISK_F_SPLICE)))) ||
+        ((NULL != cfg->dirs) && ((0 == cfg->maxDirs) || (NULL == cfg->dirNames) || (0 == cfg->dirNamesSz))) ||
+        ((NULL != cfg->sparseMap) && (0 == cfg->maxExtents)))
+    {
+        return TARSTEX_EFAILURE;
+    }
+    memset(disk, 0, sizeof(*disk));
+    disk->cfg = *cfg;
+    disk->fd  = -1;
+    if ((0 != cfg->nWorkers) && (TARSTEX_ESUCCESS != pool_start(disk)))
+    {
+        return TARSTEX_EFAILURE;
+    }
+#ifdef TARSTEX_WITH_URING
+    if (0 != (cfg->flags & TARSTRDISK_F_URING))
+    {
+        if (0 != io_uring_queue_init(cfg->nBufs, &disk->ring, 0))
+        {
+            return TARSTEX_EFAILURE;
+        }
+        disk->ringInit = 1;
+    }
+#else
+    if (0 != (cfg->flags & TARSTRDISK_F_URING))
+    {
+        return TARSTEX_EFAILURE; /* not built in */
+    }
+#endif
+    return TARSTEX_ESUCCESS;
+}
+
+int tarStrDisk_attach(tarStrDisk_t *disk, static_tarStrEx_t *static_seTar, tarStrEx_t **tar)
+{
+    int res;
+
+    /* fileInit is never called: fileInitEx takes its place */
+    res = tarStrEx_init(static_seTar, tar, disk, NULL, disk_dirCreate, disk_recvData, disk_fileFinalize);
+    if (TARSTEX_ESUCCESS == res)
+    {
+        res = tarStrEx_set_fileInitEx(*tar, disk_fileInit);
+    }
+    if (TARSTEX_ESUCCESS == res)
+    {
+        res = tarStrEx_set_linkCallback(*tar, disk_link);
+    }
+    if (TARSTEX_ESUCCESS == res)
+    {
+        res = tarStrEx_set_entryCallback(*tar, disk_entry);
+    }
+    if ((TARSTEX_ESUCCESS == res) && (NULL != disk->cfg.sparseMap))
+    {
+        res = tarStrEx_set_sparse(*tar, disk_recvDataAt, disk->cfg.sparseMap, disk->cfg.maxExtents);
+    }
+    return res;
+}
+
+int tarStrDisk_error(const tarStrDisk_t *disk)
+{
+    return __atomic_load_n(&disk->error, __ATOMIC_RELAXED);
+}
+
+int tarStrDisk_fd(const tarStrDisk_t *disk)
+{
+    return disk->fd;
+}
+
+int tarStrDisk_finalize(tarStrDisk_t *disk)
+{
+    if (disk->nThreads > 0)
+    {
+        pool_stop(disk); /* all the files are written and closed */
+        disk->cfg.nWorkers = 0;
+    }
+    if (disk->fd >= 0)
+    {
+        /* the engine has not finalized the file */
+        close(disk->fd);
+        disk->fd = -1;
+    }
+#ifdef TARSTEX_WITH_URING
+    if (disk->ringInit)
+    {
+        io_uring_queue_exit(&disk->ring);
+        disk->ringInit = 0;
+    }
+#endif
+    dirs_apply(disk);
+    return (0 == disk->error) ? TARSTEX_ESUCCESS : TARSTEX_EFAILURE;
+}
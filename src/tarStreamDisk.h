@@ -0,0 +1,223 @@
+
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TARSTREAMDISK_H
+#define SRC_TARSTREAMDISK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+#ifdef TARSTEX_WITH_URING
+#include <liburing.h>
+#endif
+
+#include "tarStreamExtractor.h"
+
+/* maximum number of write buffers */
+#ifndef TARSTRDISK_MAX_BUFS
+#define TARSTRDISK_MAX_BUFS 16
+#endif
+
+/* maximum number of worker threads */
+#ifndef TARSTRDISK_MAX_WORKERS
+#define TARSTRDISK_MAX_WORKERS 16
+#endif
+
+/* alignment of write buffers, of their size and of file offsets, as required by O_DIRECT */
+#ifndef TARSTRDISK_ALIGN
+#define TARSTRDISK_ALIGN 4096
+#endif
+
+/* options of the backend */
+enum
+{
+    TARSTRDISK_F_DIRECT   = 0x01, /* open files with O_DIRECT, bypassing the page cache */
+    TARSTRDISK_F_PREALLOC = 0x02, /* reserve the whole file with fallocate() before writing it */
+    TARSTRDISK_F_URING    = 0x04, /* write with io_uring (needs TARSTEX_WITH_URING, off by default), pwritev()
+                                     otherwise */
+    TARSTRDISK_F_TIMES    = 0x08, /* restore the modification time of files */
+    TARSTRDISK_F_SPLICE   = 0x10, /* accept files with TARSTEX_CB_PASSTHROUGH, their data is written by the caller
+                                     into tarStrDisk_fd() (see tarStreamSplice.h). Data pushed to the engine must
+                                     all precede the data written by the caller, as tarStrSpl_run() does. Such files
+                                     are not opened with O_DIRECT */
+    TARSTRDISK_F_MODES    = 0x20, /* restore the permission bits of files and directories as they are, regardless of
+                                     the umask */
+};
+
+/**
+ * @brief a directory whose metadata is applied by tarStrDisk_finalize()
+ */
+typedef struct tarStrDisk_dir
+{
+    int64_t  mtime;   /* modification time */
+    uint32_t mode;    /* permission bits */
+    uint32_t nameIdx; /* path, within the buffer of the names */
+} tarStrDisk_dir_t;
+
+/**
+ * @brief configuration of the backend
+ */
+typedef struct tarStrDisk_cfg
+{
+    int      rootFd; /* directory the archive is extracted into (e.g. AT_FDCWD) */
+    uint8_t *bufMem; /* memory of the write buffers: nBufs * bufSz bytes, aligned to TARSTRDISK_ALIGN */
+    size_t   bufSz;  /* size of a write buffer, a multiple of TARSTRDISK_ALIGN */
+    unsigned nBufs;  /* number of write buffers, 1 to TARSTRDISK_MAX_BUFS */
+    unsigned flags;  /* TARSTRDISK_F_* */
+
+    /* threads writing the files, 0 to TARSTRDISK_MAX_WORKERS. With 0 files are written from the calling thread.
+     * Not compatible with TARSTRDISK_F_URING and TARSTRDISK_F_SPLICE */
+    unsigned nWorkers;
+
+    /* directories are created at once with permissive modes; their mode (TARSTRDISK_F_MODES) and mtime
+     * (TARSTRDISK_F_TIMES) are applied at the end, deepest first, from these storages. Set dirs to NULL not to
+     * restore them */
+    tarStrDisk_dir_t *dirs;       /* storage of the directories */
+    unsigned          maxDirs;    /* number of elements of dirs */
+    char             *dirNames;   /* storage of the paths of the directories */
+    size_t            dirNamesSz; /* size of dirNames, in bytes */
+
+    /* storage of the map of a sparse file: only the extents holding data are written, the holes are left
+     * unallocated. Sparse files are written from the calling thread, without O_DIRECT nor preallocation. Set
+     * sparseMap to NULL to extract them as they are stored */
+    tarStrEx_extent_t *sparseMap;
+    unsigned           maxExtents; /* number of elements of sparseMap */
+} tarStrDisk_cfg_t;
+
+/**
+ * @brief a file being written by the workers. Members are private
+ */
+typedef struct tarStrDisk_file
+{
+    int      fd;     /* -1 if the slot is free */
+    int      direct; /* the file has been opened with O_DIRECT */
+    uint64_t size;   /* size of the file, from its header */
+    int64_t  mtime;  /* modification time of the file */
+    uint32_t mode;   /* permission bits of the file */
+    unsigned jobs;   /* writes queued and not yet completed */
+    int      queued; /* all the data of the file have been queued */
+} tarStrDisk_file_t;
+
+/**
+ * @brief backend handle. Members are private
+ */
+typedef struct tarStrDisk
+{
+    tarStrDisk_cfg_t cfg;
+
+    int      fd;      /* file being written, -1 if none */
+    uint64_t size;    /* size of the file, from its header */
+    int64_t  mtime;   /* modification time of the file */
+    uint32_t mode;    /* permission bits of the file */
+    uint64_t off;     /* file offset of the first buffer not yet handed to the kernel */
+    unsigned cur;     /* buffer being filled */
+    size_t   fill;    /* bytes into the current buffer */
+    unsigned pending; /* filled buffers waiting for pwritev() */
+    int      direct;  /* the file has been opened with O_DIRECT */
+    int      sparse;  /* the file is sparse, its data are written at the offsets of its extents */
+    int      error;   /* first error met, as a negative errno */
+
+    int64_t  entryMtime; /* metadata of the member being processed, from the entry callback */
+    uint32_t entryMode;
+    unsigned nDirs;       /* directories recorded */
+    size_t   dirNamesIdx; /* bytes of the names buffer used */
+
+    /* worker pool: full buffers are queued to the workers, which write them and close the files */
+    pthread_t         threads[TARSTRDISK_MAX_WORKERS];
+    unsigned          nThreads; /* threads started */
+    pthread_mutex_t   lock;
+    pthread_cond_t    work;     /* a buffer has been queued, or the workers must stop */
+    pthread_cond_t    released; /* a buffer or a file slot has been released */
+    int               stop;     /* no more buffers will be queued */
+    unsigned          file;     /* slot of the file being received */
+    unsigned          ready[TARSTRDISK_MAX_BUFS]; /* circular queue of the buffers waiting to be written */
+    unsigned          readyHead;
+    unsigned          readyCount;
+    uint8_t           bufFree[TARSTRDISK_MAX_BUFS];
+    unsigned          jobFile[TARSTRDISK_MAX_BUFS]; /* slot of the file a queued buffer belongs to */
+    uint64_t          jobOff[TARSTRDISK_MAX_BUFS];  /* file offset of a queued buffer */
+    size_t            jobLen[TARSTRDISK_MAX_BUFS];  /* bytes of a queued buffer */
+    tarStrDisk_file_t files[TARSTRDISK_MAX_BUFS + 1];
+
+#ifdef TARSTEX_WITH_URING
+    struct io_uring ring;
+    int             ringInit;
+    unsigned        inFlight;                 /* writes submitted and not yet completed */
+    unsigned        queued;                   /* writes prepared and not yet submitted */
+    uint8_t         busy[TARSTRDISK_MAX_BUFS]; /* buffer owned by a write in flight */
+    uint64_t        wOff[TARSTRDISK_MAX_BUFS]; /* file offset of the write in flight of a buffer */
+#endif
+    struct iovec iov[TARSTRDISK_MAX_BUFS];
+} tarStrDisk_t;
+
+/**
+ * @brief initialization function
+ *
+ * @param disk backend to initialize
+ * @param cfg configuration, copied
+ * @return 0 on success, or a negative value representing fault
+ */
+int tarStrDisk_init(tarStrDisk_t *disk, const tarStrDisk_cfg_t *cfg);
+
+/**
+ * @brief initialize an extraction engine writing every member to disk, below the root directory
+ * files, directories, hard and symbolic links are created; other member types make the extraction fail. Paths
+ * that are absolute or contain ".." components are rejected
+ *
+ * @param disk backend
+ * @param static_seTar pointer to struct buffer used to store actual seTar handle structure
+ * @param[out] tar pointer to handle pointer do be populated
+ * @return 0 on success, or a negative value representing fault
+ */
+int tarStrDisk_attach(tarStrDisk_t *disk, static_tarStrEx_t *static_seTar, tarStrEx_t **tar);
+
+/**
+ * @brief first error met while writing, as a negative errno
+ *
+ * @param disk backend
+ * @return 0 if no error occurred
+ */
+int tarStrDisk_error(const tarStrDisk_t *disk);
+
+/**
+ * @brief file being extracted, to be written by the caller when TARSTRDISK_F_SPLICE is set
+ * data must be written at explicit offsets (e.g. with pwrite), as the engine supplies them
+ *
+ * @param disk backend
+ * @return file descriptor, or -1 if no file is being extracted
+ */
+int tarStrDisk_fd(const tarStrDisk_t *disk);
+
+/**
+ * @brief finalization function, to be called after tarStrEx_finalize(): waits for the workers to write all the files,
+ * applies the metadata of the directories and releases the backend resources
+ *
+ * @param disk backend
+ * @return 0 on success, or a negative value representing fault
+ */
+int tarStrDisk_finalize(tarStrDisk_t *disk);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_TARSTREAMDISK_H */
@@ -37,6 +37,12 @@
 #include <stdint.h>
 #include <string.h>
 
+#if defined(__SSE2__) && !defined(TARSTEX_NO_SIMD)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && !defined(TARSTEX_NO_SIMD)
+#include <arm_neon.h>
+#endif
+
 #include "tarStreamExtractor.h"
 
 #define min(a, b)                                                                                                      \
@@ -49,7 +55,9 @@
 #define TAR_BLOCK_SIZE (512)
 
 /**
- * @brief tar header Pre-POSIX.1-1988
+ * @brief tar header POSIX.1-1988 (ustar)
+ * pre-POSIX archives leave the ustar fields filled with zeros, GNU archives use the same magic area ("ustar  ") but
+ * store something else in place of the prefix
  *
  * @note type field follows the POSIX IEEE P1003.1 specs
  *
@@ -65,34 +73,129 @@ typedef struct
     char checksum[8];
     char type;
     char linkname[100];
-    char _padding[255];
+    char magic[6]; /* "ustar" NUL terminated */
+    char version[2];
+    char uname[32];
+    char gname[32];
+    char devmajor[8];
+    char devminor[8];
+    char prefix[155]; /* prepended to name, with a '/' in between */
+    char _padding[12];
 } tar_header_t;
 
 _Static_assert(TAR_BLOCK_SIZE == sizeof(tar_header_t), "sizes of tar header must be equal to block");
 
+typedef struct
+{
+    uint64_t size;
+    int64_t  mtime; /* modification time, seconds since the epoch */
+    uint32_t mode;  /* permissions */
+    uint32_t owner; /* user id */
+    uint32_t group; /* group id */
+    char     type;
+} tarStrEx_header_t;
+
+/* fields of the following member overridden by metadata members */
+enum
+{
+    PENDING_NAME   = 0x01,
+    PENDING_SIZE   = 0x02,
+    PENDING_LINK   = 0x04,
+    PENDING_MTIME  = 0x08,
+    PENDING_UID    = 0x10,
+    PENDING_GID    = 0x20,
+    PENDING_SPARSE = 0x40, /* the following member is a sparse file */
+    PENDING_STORED = 0x80, /* the following member is a PAX sparse file, extracted as stored */
+};
+
+/* formats of sparse files */
 enum
 {
-    TAR_TYPE_REG  = '0',
-    TAR_TYPE_LNK  = '1',
-    TAR_TYPE_SYM  = '2',
-    TAR_TYPE_CHR  = '3',
-    TAR_TYPE_BLK  = '4',
-    TAR_TYPE_DIR  = '5',
-    TAR_TYPE_FIFO = '6'
+    SPARSE_NONE,
+    SPARSE_GNU,  /* GNU sparse member: the map is in the header, continued into extension blocks */
+    SPARSE_PAX0, /* PAX 0.0 and 0.1: the map is in the PAX extended header */
+    SPARSE_PAX1, /* PAX 1.0: the map is a text at the beginning of the data, padded to a block */
+};
+
+/* GNU sparse member header: map entries (offset, size) and the real size of the file take the place of the ustar
+ * prefix */
+#define GNU_SPARSE_OFF      386 /* first entry of the map */
+#define GNU_SPARSE_ENTRIES  4   /* number of entries in the header */
+#define GNU_ISEXTENDED_OFF  482 /* the map continues into an extension block */
+#define GNU_REALSIZE_OFF    483
+#define GNU_EXT_ENTRIES     21  /* entries of an extension block, followed by its own isextended flag */
+#define GNU_SPARSE_ENTRY_SZ 24  /* 12 octal digits of offset, 12 of size */
+
+typedef enum paxStatus
+{
+    pax_len,   /* decimal length of the record */
+    pax_key,   /* keyword, up to '=' */
+    pax_value, /* value, up to the end of the record */
+} paxStatus_t;
+
+typedef enum paxKey
+{
+    pax_key_other, /* ignored */
+    pax_key_path,
+    pax_key_linkpath,
+    pax_key_size,
+    pax_key_mtime,
+    pax_key_uid,
+    pax_key_gid,
+    /* GNU sparse files, honoured only when sparse files are enabled */
+    pax_key_sparseName,
+    pax_key_sparseMajor,
+    pax_key_sparseSize, /* the real size of the file: GNU.sparse.realsize (1.0) or GNU.sparse.size (0.x) */
+    pax_key_sparseMap,
+    pax_key_sparseOffset,
+    pax_key_sparseNumbytes,
+} paxKey_t;
+
+/* PAX keywords honoured by the parser */
+static const struct
+{
+    const char *keyword;
+    uint8_t     key;
+} pax_keys[] = {
+    {"path", pax_key_path},
+    {"linkpath", pax_key_linkpath},
+    {"size", pax_key_size},
+    {"mtime", pax_key_mtime},
+    {"uid", pax_key_uid},
+    {"gid", pax_key_gid},
+    {"GNU.sparse.name", pax_key_sparseName},
+    {"GNU.sparse.major", pax_key_sparseMajor},
+    {"GNU.sparse.realsize", pax_key_sparseSize},
+    {"GNU.sparse.size", pax_key_sparseSize},
+    {"GNU.sparse.map", pax_key_sparseMap},
+    {"GNU.sparse.offset", pax_key_sparseOffset},
+    {"GNU.sparse.numbytes", pax_key_sparseNumbytes},
 };
 
+/* parser of the payload of a metadata member, fed incrementally */
 typedef struct
 {
-    char     name[100];
-    uint32_t size;
-    char     type;
-} tarStrEx_header_t;
+    uint64_t num;    /* numeric value being parsed */
+    uint32_t recLen; /* declared length of the PAX record */
+    uint32_t recPos; /* bytes of the PAX record consumed so far */
+    uint32_t valLen; /* bytes of the path stored into the name (or link name) buffer */
+    uint8_t  status; /* paxStatus_t */
+    uint8_t  key;    /* paxKey_t */
+    uint8_t  keyLen; /* length of the keyword, saturated at sizeof(keyBuf) + 1 */
+    uint8_t  frac;   /* the fractional part of a time is being skipped */
+    uint8_t  neg;    /* the time being parsed is negative */
+    char     keyBuf[20]; /* long enough for the longest keyword honoured */
+} tarStrEx_ext_t;
 
 typedef enum tarStatus
 {
     tar_header,
     tar_fileData,
     tar_filePad,
+    tar_fileSkip,
+    tar_extHeader,
+    tar_sparseMap,
+    tar_end,
 
     tar_error,
 } tarStatus_t;
@@ -101,16 +204,30 @@ struct tarStrEx_t
 {
     uint8_t blockBuff[TAR_BLOCK_SIZE]; /* buffer memory for aa block */
 
+    uint64_t remaining_filedata;  /* number of byte remaining to consider the file
+                                     complete */
+    uint64_t offset;              /* number of bytes of the stream consumed so far */
     uint16_t buffIdx;             /* index within the block buffer */
     uint16_t remaining_buffBytes; /* number of byte empty in block buff. */
-    size_t   remaining_filedata;  /* number of byte remaining to consider the file
-                                     complete */
 
     tarStatus_t status;
 
     tarStrEx_header_t hdr; /* converted header. Is populated once the header block
                               has been received completely */
 
+    tarStrEx_ext_t    ext;     /* metadata member parser */
+    tarStrEx_header_t pax;     /* fields of the following member, from a PAX header */
+    uint8_t           pending;     /* PENDING_* flags */
+    uint8_t           passthrough; /* the data of the current file are moved by the caller (TARSTEX_CB_PASSTHROUGH) */
+    uint8_t           sparse;      /* SPARSE_* format of the current file */
+    uint8_t           sparsePax;   /* SPARSE_* format of the following member, from a PAX header */
+    uint8_t           sparseOdd;   /* the next number of the map is the size of an extent */
+    uint8_t           sparseSkip;  /* the sparse file is skipped, without fileInit: its map is only walked */
+    uint8_t           sparseExt;   /* the map of the GNU sparse file continues into extension blocks */
+    uint8_t           sparsePlain; /* no recvDataAt: the data of the sparse file are delivered as stored */
+    uint8_t           nullRun;     /* blocks of zeros in a row where a header was expected, up to 2 */
+    uint8_t           finFailed;   /* a fileFinalize failed, the archive is not committed */
+
     void *cbParam; /* parameter to be passed to the callbacks */
 
     /* callbacks */
@@ -118,31 +235,305 @@ struct tarStrEx_t
     cb_dirCreate_t    dirCreate;
     cb_recvData_t     recvData;
     cb_fileFinalize_t fileFinalize;
+    cb_entry_t        entry;      /* optional */
+    cb_fileInitEx_t   fileInitEx; /* optional, replaces fileInit */
+    cb_link_t         link;       /* optional */
+
+    tarStrEx_filter_t filter;    /* optional selection of the members */
+    const void       *filterCtx; /* context of the filter */
+
+    const tarStrEx_hash_t *hash;    /* optional digest of file data */
+    void                  *hashCtx; /* context of the digest */
+
+    const tarStrEx_hash_t *archHash;    /* optional digest of the whole stream */
+    void                  *archHashCtx; /* context of the stream digest */
+    cb_verify_t            verify;      /* optional, authenticates the archive before the commit */
+    cb_commit_t            commit;      /* optional, enables the two-phase mode */
+
+    cb_recvDataAt_t    recvDataAt; /* optional, enables sparse files */
+    tarStrEx_extent_t *sparseMap;  /* map of the current sparse file */
+    uint32_t           sparseMax;  /* number of elements of sparseMap */
+    uint32_t           sparseCnt;  /* extents in the map */
+    uint32_t           sparseIdx;  /* extent being delivered */
+    uint64_t           sparseDone; /* bytes of the extent delivered */
+    uint64_t           sparseSize; /* size of the sparse file, holes included */
+
+    cb_batch_t         batch;        /* optional */
+    tarStrEx_member_t *batchMembers; /* storage of a batch */
+    size_t             batchMax;     /* number of elements of batchMembers */
+    char              *batchNames;   /* storage of the paths of a batch */
+    size_t             batchNamesSz; /* size of batchNames */
+
+    char name[TARSTEX_PATH_MAX];     /* NUL terminated path of the current member */
+    char linkname[TARSTEX_PATH_MAX]; /* NUL terminated link target of the current member */
+
+#ifdef TARSTEX_STATS
+    tarStrEx_stats_t stats;
+    tarStrEx_clock_t clock; /* optional, times the callbacks */
+#endif
 };
 
-_Static_assert(sizeof(struct tarStrEx_t) == sizeof(static_tarStrEx_t),
-               "sizes of public and private structures must match");
+_Static_assert((TARSTEX_PATH_MAX % 8 == 0) && (TARSTEX_PATH_MAX > 155 + 1 + 100),
+               "path buffer must be a multiple of 8 and hold a ustar prefix + name");
+
+/* 64-bit members make the private structure a few bytes shorter on the 32-bit ABIs that align them to 4 bytes only */
+_Static_assert(sizeof(struct tarStrEx_t) <= sizeof(static_tarStrEx_t),
+               "public structure must be large enough to hold the private one");
+_Static_assert(_Alignof(struct tarStrEx_t) <= _Alignof(static_tarStrEx_t),
+               "public structure must be aligned as the private one");
+
+#ifdef TARSTEX_STATS
+/**
+ * @brief account for a callback invocation
+ *
+ * @param tar pointer to tar handle
+ * @param id callback (TARSTEX_STAT_*)
+ * @param t0 clock reading taken before the call
+ */
+static void stat_callback(tarStrEx_t *tar, unsigned id, uint64_t t0)
+{
+    uint64_t ticks = (NULL != tar->clock) ? tar->clock() - t0 : 0;
+    unsigned bin   = 0;
+
+    tar->stats.cbCalls[id]++;
+    tar->stats.cbTicks[id] += ticks;
+    if (ticks > tar->stats.cbMaxTicks[id])
+    {
+        tar->stats.cbMaxTicks[id] = ticks;
+    }
+    while ((0 != (ticks >>= 1)) && (bin < TARSTEX_STAT_HIST_BINS - 1))
+    {
+        bin++;
+    }
+    tar->stats.cbHist[id][bin]++;
+}
+
+#define STAT_ADD(tar, field, n) ((tar)->stats.field += (n))
+/* call a callback, timing it */
+#define CB_CALL(tar, id, call)                                                                                         \
+    ({                                                                                                                 \
+        uint64_t _t0  = (NULL != (tar)->clock) ? (tar)->clock() : 0;                                                   \
+        int      _res = (call);                                                                                        \
+        stat_callback((tar), (id), _t0);                                                                               \
+        _res;                                                                                                          \
+    })
+#else
+/* statistics compiled out: no cost at all */
+#define STAT_ADD(tar, field, n) ((void)0)
+#define CB_CALL(tar, id, call)  (call)
+#endif
+
+/**
+ * @brief sum all the bytes of a block and, in the same pass, check whether they are all zeros
+ * vector instructions are used when available (AVX2, SSE2, NEON, unless TARSTEX_NO_SIMD is defined), otherwise
+ * the block is processed a machine word at a time
+ *
+ * @param blk block, with no alignment requirement
+ * @param[out] isZero set to 1 if all bytes are zeros, 0 otherwise
+ * @return sum of all bytes
+ */
+static uint32_t block_sum(const uint8_t *blk, int *isZero)
+{
+#if defined(__AVX2__) && !defined(TARSTEX_NO_SIMD)
+    unsigned i;
+    __m256i  acc = _mm256_setzero_si256();
+    __m256i  any = _mm256_setzero_si256();
+    __m128i  acc128;
+    for (i = 0; i < TAR_BLOCK_SIZE; i += sizeof(__m256i))
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)&blk[i]);
+        acc       = _mm256_add_epi64(acc, _mm256_sad_epu8(v, _mm256_setzero_si256())); /* 4 partial sums */
+        any       = _mm256_or_si256(any, v);
+    }
+    *isZero = _mm256_testz_si256(any, any);
+    acc128  = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    return (uint32_t)(_mm_cvtsi128_si32(acc128) + _mm_extract_epi16(acc128, 4));
+#elif defined(__SSE2__) && !defined(TARSTEX_NO_SIMD)
+    unsigned i;
+    __m128i  acc = _mm_setzero_si128();
+    __m128i  any = _mm_setzero_si128();
+    for (i = 0; i < TAR_BLOCK_SIZE; i += sizeof(__m128i))
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)&blk[i]);
+        acc       = _mm_add_epi64(acc, _mm_sad_epu8(v, _mm_setzero_si128())); /* 2 partial sums */
+        any       = _mm_or_si128(any, v);
+    }
+    *isZero = (0xFFFF == _mm_movemask_epi8(_mm_cmpeq_epi8(any, _mm_setzero_si128())));
+    return (uint32_t)(_mm_cvtsi128_si32(acc) + _mm_extract_epi16(acc, 4));
+#elif defined(__ARM_NEON) && !defined(TARSTEX_NO_SIMD)
+    unsigned   i;
+    uint16x8_t acc = vdupq_n_u16(0); /* each lane adds 2 bytes per step: 32 steps can't overflow */
+    uint8x16_t any = vdupq_n_u8(0);
+    uint64x2_t acc64, any64;
+    for (i = 0; i < TAR_BLOCK_SIZE; i += sizeof(uint8x16_t))
+    {
+        uint8x16_t v = vld1q_u8(&blk[i]);
+        acc          = vpadalq_u8(acc, v);
+        any          = vorrq_u8(any, v);
+    }
+    acc64   = vpaddlq_u32(vpaddlq_u16(acc));
+    any64   = vreinterpretq_u64_u8(any);
+    *isZero = (0 == (vgetq_lane_u64(any64, 0) | vgetq_lane_u64(any64, 1)));
+    return (uint32_t)(vgetq_lane_u64(acc64, 0) + vgetq_lane_u64(acc64, 1));
+#else
+    /* SWAR: bytes in even and odd positions are added into 16-bit lanes. Each lane adds 2 bytes per word, at most
+     * 128 words per block, thus it can't overflow */
+#if UINTPTR_MAX == 0xFFFFFFFF
+    typedef uint32_t word_t;
+    const word_t     lowBytes = 0x00FF00FFu;
+#else
+    typedef uint64_t word_t;
+    const word_t     lowBytes = 0x00FF00FF00FF00FFu;
+#endif
+    unsigned i;
+    word_t   w, acc = 0, any = 0;
+    uint32_t res = 0;
+    for (i = 0; i < TAR_BLOCK_SIZE; i += sizeof(word_t))
+    {
+        memcpy(&w, &blk[i], sizeof(w)); /* no alignment requirement, compilers turn it into a plain load */
+        acc += (w & lowBytes) + ((w >> 8) & lowBytes);
+        any |= w;
+    }
+    for (i = 0; i < sizeof(word_t); i += 2)
+    {
+        res += (acc >> (i * 8)) & 0xFFFF;
+    }
+    *isZero = (0 == any);
+    return res;
+#endif
+}
 
 /**
  * @brief compute checkhsum of the header
+ * the checksum field itself is considered as filled with spaces
  *
+ * @param blkSum sum of all bytes of the header block
  * @param rh header as appear into tar archive
  * @return checksum
  */
-static uint32_t checksum(const tar_header_t *rh)
+static uint32_t checksum(uint32_t blkSum, const tar_header_t *rh)
+{
+    unsigned i;
+    uint32_t res = blkSum + sizeof(rh->checksum) * ' ';
+    for (i = 0; i < sizeof(rh->checksum); i++)
+    {
+        res -= (uint8_t)rh->checksum[i];
+    }
+    return res;
+}
+
+/**
+ * @brief parse a numeric field of the header
+ * fields have a fixed width and are not guaranteed to be NUL terminated, so the parser never reads past the end of
+ * the field. Octal numbers may be preceded by spaces and must be followed by a space or a NUL, unless they fill the
+ * whole field. Besides the classic octal notation, the GNU base-256 notation is supported: if the most significant
+ * bit of the first byte is set, the remaining bits are a big-endian binary number. This is how sizes of 8 GiB or
+ * more are stored
+ *
+ * @param[out] val parsed value
+ * @param[in] field numeric field as appear into tar archive
+ * @param len width of the field
+ * @return 0 on success, or a negative value representing fault
+ */
+static int parse_number(uint64_t *val, const char *field, unsigned len)
 {
-    unsigned       i;
-    unsigned char *p   = (unsigned char *)rh;
-    uint32_t       res = 256;
-    for (i = 0; i < offsetof(tar_header_t, checksum); i++)
+    unsigned i   = 0;
+    uint64_t res = 0;
+
+    if (0 != ((uint8_t)field[0] & 0x80))
     {
-        res += p[i];
+        if (0 != ((uint8_t)field[0] & 0x40))
+        {
+            return TARSTEX_EBADFIELD; /* negative number */
+        }
+        res = (uint8_t)field[0] & 0x3f;
+        for (i = 1; i < len; i++)
+        {
+            if (res > (UINT64_MAX >> 8))
+            {
+                return TARSTEX_EBADFIELD; /* does not fit in 64 bits */
+            }
+            res = (res << 8) | (uint8_t)field[i];
+        }
+        *val = res;
+        return TARSTEX_ESUCCESS;
     }
-    for (i = offsetof(tar_header_t, type); i < sizeof(*rh); i++)
+
+    while ((i < len) && (' ' == field[i]))
     {
-        res += p[i];
+        i++;
     }
-    return res;
+    /* at most 12 octal digits: 36 bits, no overflow is possible */
+    for (; i < len; i++)
+    {
+        unsigned digit = (uint8_t)field[i] - '0';
+        if (digit > 7)
+        {
+            break;
+        }
+        res = (res << 3) | digit;
+    }
+    if ((i < len) && (' ' != field[i]) && ('\0' != field[i]))
+    {
+        return TARSTEX_EBADFIELD; /* garbage after the number */
+    }
+    *val = res;
+    return TARSTEX_ESUCCESS;
+}
+
+/**
+ * @brief parse a numeric field of the header that must fit in 32 bits
+ *
+ * @param[out] val parsed value
+ * @param[in] field numeric field as appear into tar archive
+ * @param len width of the field
+ * @return 0 on success, or a negative value representing fault
+ */
+static int parse_number32(uint32_t *val, const char *field, unsigned len)
+{
+    uint64_t res;
+
+    if ((TARSTEX_ESUCCESS != parse_number(&res, field, len)) || (res > UINT32_MAX))
+    {
+        return TARSTEX_EBADFIELD;
+    }
+    *val = (uint32_t)res;
+    return TARSTEX_ESUCCESS;
+}
+
+/**
+ * @brief parse the modification time of the header
+ * times before the epoch are stored by GNU tar in base-256, as a two's complement number spanning the whole field.
+ * Unlike the size, the time does not affect the parsing of the archive: a time that does not fit in 64 bits is
+ * clamped, and a malformed one reads as 0, rather than rejecting the member
+ *
+ * @param[in] field numeric field as appear into tar archive
+ * @param len width of the field
+ * @return seconds since the epoch
+ */
+static int64_t parse_time(const char *field, unsigned len)
+{
+    unsigned i;
+    uint64_t res;
+
+    if (0xC0 == ((uint8_t)field[0] & 0xC0))
+    {
+        res = UINT64_MAX; /* sign extension */
+        for (i = 0; i < len; i++)
+        {
+            if ((res >> 55) != 0x1FF)
+            {
+                return INT64_MIN; /* the number would not stay negative */
+            }
+            res = (res << 8) | (uint8_t)field[i];
+        }
+        return (int64_t)res;
+    }
+    if (TARSTEX_ESUCCESS != parse_number(&res, field, len))
+    {
+        return (0 != ((uint8_t)field[0] & 0x80)) ? INT64_MAX : 0;
+    }
+    return (res > INT64_MAX) ? INT64_MAX : (int64_t)res;
 }
 
 /**
@@ -155,31 +546,82 @@ static uint32_t checksum(const tar_header_t *rh)
  */
 static int raw_to_header(tarStrEx_header_t *h, const tar_header_t *rh)
 {
-    uint32_t chksum1, chksum2;
+    uint32_t chksum1, chksum2, blkSum;
+    int      isZero;
 
-    /* If the checksum starts with a null byte we assume the record is NULL */
-    if (*rh->checksum == '\0')
+    blkSum = block_sum((const uint8_t *)rh, &isZero);
+    /* a record entirely filled with zeros is a NULL record */
+    if (isZero)
     {
         return TARSTEX_ENULLRECORD;
     }
 
     /* Build and compare checksum */
-    chksum1 = checksum(rh);
-    chksum2 = strtoul(rh->checksum, NULL, 8);
-
-    if (chksum1 != chksum2)
+    chksum1 = checksum(blkSum, rh);
+    if ((TARSTEX_ESUCCESS != parse_number32(&chksum2, rh->checksum, sizeof(rh->checksum))) || (chksum1 != chksum2))
     {
         return TARSTEX_EBADCHKSUM;
     }
 
-    /* Load raw header into header */
-    h->size = strtoul(rh->size, NULL, 8);
+    /* Load raw header into header: only the size is needed to walk the archive, a malformed mode, owner or group
+     * reads as 0 instead of rejecting the member */
+    if (TARSTEX_ESUCCESS != parse_number(&h->size, rh->size, sizeof(rh->size)))
+    {
+        return TARSTEX_EBADFIELD;
+    }
+    h->mtime = parse_time(rh->mtime, sizeof(rh->mtime));
+    if (TARSTEX_ESUCCESS != parse_number32(&h->mode, rh->mode, sizeof(rh->mode)))
+    {
+        h->mode = 0;
+    }
+    if (TARSTEX_ESUCCESS != parse_number32(&h->owner, rh->owner, sizeof(rh->owner)))
+    {
+        h->owner = 0;
+    }
+    if (TARSTEX_ESUCCESS != parse_number32(&h->group, rh->group, sizeof(rh->group)))
+    {
+        h->group = 0;
+    }
     h->type = rh->type;
-    strcpy(h->name, rh->name);
 
     return TARSTEX_ESUCCESS;
 }
 
+/**
+ * @brief length of a text field of the header, that is NUL terminated unless it fills the whole field
+ *
+ * @param[in] field text field as appear into tar archive
+ * @param len width of the field
+ * @return length of the text
+ */
+static size_t field_len(const char *field, size_t len)
+{
+    const char *end = memchr(field, '\0', len);
+    return (NULL == end) ? len : (size_t)(end - field);
+}
+
+/**
+ * @brief build the path of the member from the name field and (ustar archives only) the prefix field
+ * fields are not guaranteed to be NUL terminated when completely filled
+ *
+ * @param[out] name path buffer, at least TARSTEX_PATH_MAX bytes
+ * @param[in] rh header as appear into tar archive
+ */
+static void header_name(char *name, const tar_header_t *rh)
+{
+    size_t len     = 0;
+    size_t nameLen = field_len(rh->name, sizeof(rh->name));
+
+    if ((0 == memcmp(rh->magic, "ustar", sizeof(rh->magic))) && ('\0' != rh->prefix[0]))
+    {
+        len = field_len(rh->prefix, sizeof(rh->prefix));
+        memcpy(name, rh->prefix, len);
+        name[len++] = '/';
+    }
+    memcpy(&name[len], rh->name, nameLen);
+    name[len + nameLen] = '\0';
+}
+
 int tarStrEx_init(static_tarStrEx_t *static_seTar, tarStrEx_t **tar, void *cbParam, cb_fileInit_t fileInit,
                   cb_dirCreate_t dirCreate, cb_recvData_t recvData, cb_fileFinalize_t fileFinalize)
 {
@@ -189,180 +631,1953 @@ int tarStrEx_init(static_tarStrEx_t *static_seTar, tarStrEx_t **tar, void *cbPar
     (*tar)->recvData     = recvData;
     (*tar)->fileFinalize = fileFinalize;
     (*tar)->cbParam      = cbParam;
+    (*tar)->entry        = NULL;
+    (*tar)->fileInitEx   = NULL;
+    (*tar)->link         = NULL;
+    (*tar)->filter       = NULL;
+    (*tar)->hash         = NULL;
+    (*tar)->archHash     = NULL;
+    (*tar)->commit       = NULL;
+    (*tar)->batch        = NULL;
+    (*tar)->recvDataAt   = NULL;
 
+#ifdef TARSTEX_STATS
+    memset(&(*tar)->stats, 0, sizeof((*tar)->stats));
+    (*tar)->clock = NULL;
+#endif
+
+    (*tar)->pending             = 0;
+    (*tar)->passthrough         = 0;
+    (*tar)->sparse              = SPARSE_NONE;
+    (*tar)->sparseExt           = 0;
+    (*tar)->sparsePlain         = 0;
+    (*tar)->sparseSkip          = 0;
+    (*tar)->nullRun             = 0;
+    (*tar)->finFailed           = 0;
     (*tar)->status              = tar_header;
     (*tar)->remaining_filedata  = 0;
+    (*tar)->offset              = 0;
     (*tar)->remaining_buffBytes = TAR_BLOCK_SIZE;
     (*tar)->buffIdx             = 0;
     return TARSTEX_ESUCCESS;
 }
 
+/**
+ * @brief tell whether the data of the current file are digested by the engine
+ * files whose data are moved by the caller, and sparse files, are not
+ *
+ * @param tar pointer to tar handle
+ * @return non-zero if the file is digested
+ */
+static int hashed(const tarStrEx_t *tar)
+{
+    return (NULL != tar->hash) && !tar->passthrough && (SPARSE_NONE == tar->sparse);
+}
+
+/**
+ * @brief complete the digest of the file (if any) and call the finalize callback
+ *
+ * @param tar pointer to tar handle
+ * @return result of the callback
+ */
+static int file_finalize(tarStrEx_t *tar)
+{
+    int res;
+
+    if (hashed(tar))
+    {
+        tar->hash->final(tar->hashCtx);
+    }
+    res = CB_CALL(tar, TARSTEX_STAT_FILEFINALIZE, tar->fileFinalize(tar->cbParam));
+    if (0 != res)
+    {
+        tar->finFailed = 1; /* staged: reported by tarStrEx_finalize(), and the archive is not committed */
+    }
+    return res;
+}
+
 int tarStrEx_finalize(tarStrEx_t *tar)
 {
-    if (tar_fileData == tar->status)
+    int res = TARSTEX_ESUCCESS;
+    int ok;
+
+    if ((tar_fileData == tar->status) || ((tar_sparseMap == tar->status) && !tar->sparseSkip))
     {
         /* only call finalization callback if I am sure that fileInit has been
-         * called. This is why I chack the state tar_fileData */
-        int res;
-        res = tar->fileFinalize(tar->cbParam);
-        if (0 != res)
+         * called. This is why I chack the state tar_fileData (or the map of a sparse file being accepted) */
+        if (0 != file_finalize(tar))
         {
-            return TARSTEX_EFAILURE;
+            res = TARSTEX_EFAILURE;
         }
     }
-    return TARSTEX_ESUCCESS;
+    if (0 != tar->finFailed)
+    {
+        res = TARSTEX_EFAILURE;
+    }
+    if (NULL != tar->archHash)
+    {
+        tar->archHash->final(tar->archHashCtx);
+    }
+    if (NULL != tar->commit)
+    {
+        /* two-phase mode: a truncated archive stops within a member, or before the end-of-archive blocks */
+        ok = (tar_end == tar->status) && !tar->finFailed;
+        ok = ok && ((NULL == tar->verify) || (0 == tar->verify(tar->cbParam)));
+        if ((0 != tar->commit(tar->cbParam, ok)) || !ok)
+        {
+            res = TARSTEX_EFAILURE;
+        }
+    }
+    return res;
 }
 
-/*
- * a simplified diagram of teh state machine is depicted:
+/**
+ * @brief account for a block of zeros where a header was expected: two in a row mark the end of the archive
  *
- *             block filled
- *   ┌─────────────────────────────────────────────┐
- *   ∨                                             │
- * ┌─────────┐  file   ┌──────┐  file complete   ┌─────┐
- * │ header  │ ──────> │ data │ ───────────────> │ pad │
- * └─────────┘         └──────┘                  └─────┘
- *   ∧ dir │             ∧  │
- *   └─────┘             └──┘
+ * @param tar pointer to tar handle
+ */
+static void null_record(tarStrEx_t *tar)
+{
+    STAT_ADD(tar, nullRecords, 1);
+    if (++tar->nullRun == 2)
+    {
+        tar->status = tar_end; /* whatever follows is ignored */
+    }
+}
+
+/**
+ * @brief rewind the block buffer, ready to collect a new block
  *
- * there is an additional 'error' state that is reached from any other state in
- * the presence of unrecoverable errors. From the error state you cannot get out
+ * @param tar pointer to tar handle
  */
-int tarStrEx_process_data(tarStrEx_t *tar, const uint8_t *data, uint16_t dataSz)
+static void block_reset(tarStrEx_t *tar)
 {
-    uint16_t chunkSz;
-    uint16_t dataIdx = 0;
-    int      res;
-    while (dataSz > 0) /* all byte ub data has to be processed */
+    tar->remaining_buffBytes = TAR_BLOCK_SIZE;
+    tar->buffIdx             = 0;
+}
+
+/**
+ * @brief called once all data bytes of a member have been consumed. Moves to the padding (if any)
+ *
+ * @param tar pointer to tar handle
+ */
+static void data_complete(tarStrEx_t *tar)
+{
+    uint16_t padSz = (TAR_BLOCK_SIZE - tar->hdr.size % TAR_BLOCK_SIZE) % TAR_BLOCK_SIZE;
+
+    block_reset(tar);
+    tar->sparse = SPARSE_NONE;
+    if (0 == padSz)
+    {
+        tar->status = tar_header; /* no need to walk through tar_filePad state */
+    }
+    else
+    {
+        /* in tar_filePad state remaining_buffBytes counts the padding bytes still to be discarded */
+        tar->remaining_buffBytes = padSz;
+        tar->status              = tar_filePad;
+    }
+}
+
+/**
+ * @brief called once all bytes of a file have been delivered. Finalizes the file and moves to the padding (if any)
+ *
+ * @param tar pointer to tar handle
+ */
+static void file_complete(tarStrEx_t *tar)
+{
+    file_finalize(tar); /* call the finalize callback because the file is complete */
+    data_complete(tar);
+}
+
+/**
+ * @brief start delivering the data of a file to recvData as they are stored, once fileInit accepted it
+ * sparse files are delivered this way without a recvDataAt callback
+ *
+ * @param tar pointer to tar handle
+ */
+static void data_start(tarStrEx_t *tar)
+{
+    tar->sparse = SPARSE_NONE;
+    if (hashed(tar))
+    {
+        tar->hash->init(tar->hashCtx);
+    }
+    tar->remaining_filedata = tar->hdr.size;
+    if (0 == tar->remaining_filedata)
+    {
+        /* empty file: there are neither data nor padding blocks, the next block is again a header */
+        file_complete(tar);
+    }
+    else
+    {
+        tar->status = tar_fileData; /* status change */
+    }
+}
+
+/**
+ * @brief start consuming the payload of a metadata member (PAX extended header or GNU long name/link name)
+ *
+ * @param tar pointer to tar handle
+ * @return 0 on success, or a negative value representing fault
+ */
+static int ext_start(tarStrEx_t *tar)
+{
+    if ((TAR_TYPE_PAX != tar->hdr.type) && (tar->hdr.size > TARSTEX_PATH_MAX))
+    {
+        tar->status = tar_error;
+        return TARSTEX_ETOOLONG;
+    }
+    memset(&tar->ext, 0, sizeof(tar->ext));
+    if (0 == (tar->pending & PENDING_SPARSE))
+    {
+        /* the map of a sparse file may come from this metadata member */
+        tar->sparseCnt  = 0;
+        tar->sparseOdd  = 0;
+        tar->sparseSkip = 0;
+        tar->sparsePax  = SPARSE_NONE;
+    }
+    tar->remaining_filedata = tar->hdr.size;
+    if (0 == tar->remaining_filedata)
+    {
+        return TARSTEX_ESUCCESS; /* nothing to parse, the next block is again a header */
+    }
+    tar->status = tar_extHeader;
+    return TARSTEX_ESUCCESS;
+}
+
+/**
+ * @brief add a number to the map of the sparse file: offsets and sizes of the extents alternate
+ *
+ * @param tar pointer to tar handle
+ * @param val offset or size
+ * @return 0 on success, or a negative value representing fault
+ */
+static int sparse_add(tarStrEx_t *tar, uint64_t val)
+{
+    if (tar->sparseSkip || tar->sparsePlain)
     {
-        if (tar_error == tar->status)
+        return TARSTEX_ESUCCESS; /* the map is not needed */
+    }
+    if (!tar->sparseOdd)
+    {
+        if (tar->sparseCnt == tar->sparseMax)
         {
-            /* do nothing */
-            return TARSTEX_EFAILURE;
+            return TARSTEX_ETOOLONG;
         }
-        /* I write into the block buffer as many bytes as possible */
-        chunkSz = min(dataSz, tar->remaining_buffBytes);
-        memcpy(&tar->blockBuff[tar->buffIdx], &data[dataIdx], chunkSz);
-        /* update indexes, ect. */
-        tar->buffIdx += chunkSz;
-        tar->remaining_buffBytes -= chunkSz;
-        dataSz -= chunkSz;
-        dataIdx += chunkSz;
-        switch (tar->status)
-        {
-        case tar_header:
-            if (0 == tar->remaining_buffBytes) /* header fully received */
-            {
-                /* convert the header */
-                res = raw_to_header(&tar->hdr, (const tar_header_t *)tar->blockBuff);
-                if (TARSTEX_ENULLRECORD == res)
-                {
-                    /* At the end of the tar archive there are two 512-byte blocks filled with binary zeros as an
-                     * end-of-file marker.
-                     * We simply ignore those zeros-populated header and go ahead
-                     */
-                    /* update indexes, etc. No need to change status */
-                    tar->remaining_buffBytes = TAR_BLOCK_SIZE;
-                    tar->buffIdx             = 0;
-                    break;
-                }
-                else if (TARSTEX_ESUCCESS != res)
-                {
-                    tar->status = tar_error;
-                    return res;
-                }
-                switch (tar->hdr.type)
-                {
-                case TAR_TYPE_REG:                                    /* regular file */
-                    res = tar->fileInit(tar->cbParam, tar->hdr.name); /* call the callback */
-                    if (0 != res)
-                    {
-                        tar->status = tar_error;
-                        return TARSTEX_EFAILURE;
-                    }
-                    tar->status = tar_fileData; /* status change */
-                    /* update indexes, etc. */
-                    tar->remaining_filedata  = tar->hdr.size;
-                    tar->remaining_buffBytes = TAR_BLOCK_SIZE;
-                    tar->buffIdx             = 0;
-                    break;
-                case TAR_TYPE_DIR:                                     /* directory */
-                    res = tar->dirCreate(tar->cbParam, tar->hdr.name); /* call the callback */
-                    if (0 != res)
-                    {
-                        tar->status = tar_error;
-                        return TARSTEX_EFAILURE;
-                    }
-                    /* update indexes, etc. No need to change status */
-                    tar->remaining_buffBytes = TAR_BLOCK_SIZE;
-                    tar->buffIdx             = 0;
-                    break;
-                default: /* unsupported type */
-                    tar->status = tar_error;
-                    return TARSTEX_EFAILURE;
-                    break;
-                }
-            }
-            break;
-        case tar_fileData:
+        tar->sparseMap[tar->sparseCnt].offset = val;
+    }
+    else
+    {
+        tar->sparseMap[tar->sparseCnt++].size = val;
+    }
+    tar->sparseOdd = !tar->sparseOdd;
+    return TARSTEX_ESUCCESS;
+}
+
+/**
+ * @brief store a completely parsed PAX record
+ *
+ * @param tar pointer to tar handle
+ * @return 0 on success, or a negative value representing fault
+ */
+static int pax_record(tarStrEx_t *tar)
+{
+    tarStrEx_ext_t *x = &tar->ext;
+
+    switch (x->key)
+    {
+    case pax_key_path:
+    case pax_key_sparseName:
+        tar->name[x->valLen] = '\0';
+        tar->pending |= PENDING_NAME;
+        break;
+    case pax_key_linkpath:
+        tar->linkname[x->valLen] = '\0';
+        tar->pending |= PENDING_LINK;
+        break;
+    case pax_key_size:
+        tar->pax.size = x->num;
+        tar->pending |= PENDING_SIZE;
+        break;
+    case pax_key_mtime:
+        if (x->num > INT64_MAX)
+        {
+            x->num = INT64_MAX; /* clamped, as a time does not affect the parsing of the archive */
+        }
+        tar->pax.mtime = x->neg ? -(int64_t)x->num : (int64_t)x->num;
+        tar->pending |= PENDING_MTIME;
+        break;
+    case pax_key_uid:
+    case pax_key_gid:
+        if (x->num > UINT32_MAX)
+        {
+            return TARSTEX_EBADFIELD;
+        }
+        if (pax_key_uid == x->key)
+        {
+            tar->pax.owner = (uint32_t)x->num;
+            tar->pending |= PENDING_UID;
+        }
+        else
+        {
+            tar->pax.group = (uint32_t)x->num;
+            tar->pending |= PENDING_GID;
+        }
+        break;
+    case pax_key_sparseMajor:
+        if (x->num > 1)
+        {
+            return TARSTEX_EBADFIELD; /* unknown format */
+        }
+        tar->sparsePax = (1 == x->num) ? SPARSE_PAX1 : SPARSE_PAX0;
+        break;
+    case pax_key_sparseSize:
+        tar->sparseSize = x->num;
+        break;
+    case pax_key_sparseMap:
+        return sparse_add(tar, x->num); /* the last number of the list */
+    case pax_key_sparseOffset:
+    case pax_key_sparseNumbytes:
+        if ((pax_key_sparseNumbytes == x->key) != tar->sparseOdd)
+        {
+            return TARSTEX_EBADFIELD; /* offsets and sizes must alternate */
+        }
+        return sparse_add(tar, x->num);
+    default:
+        break; /* ignored */
+    }
+    return TARSTEX_ESUCCESS;
+}
+
+/**
+ * @brief feed one byte to the PAX extended header parser
+ * records have the form "<length> <keyword>=<value>\n", where length counts the whole record. Only the keywords
+ * listed in pax_keys are honoured, the others are ignored
+ *
+ * @param tar pointer to tar handle
+ * @param c byte of the payload
+ * @return 0 on success, or a negative value representing fault
+ */
+static int pax_byte(tarStrEx_t *tar, char c)
+{
+    tarStrEx_ext_t *x     = &tar->ext;
+    unsigned        digit = (uint8_t)c - '0';
+    unsigned        i;
+
+    x->recPos++;
+    switch (x->status)
+    {
+    case pax_len:
+        if ((' ' == c) && (x->recPos > 1))
+        {
+            x->status = pax_key;
+            x->keyLen = 0;
+        }
+        else if ((digit > 9) || (x->recLen > UINT32_MAX / 10 - 1))
+        {
+            return TARSTEX_EBADFIELD;
+        }
+        else
+        {
+            x->recLen = x->recLen * 10 + digit;
+        }
+        break;
+    case pax_key:
+        if (x->recPos >= x->recLen)
+        {
+            return TARSTEX_EBADFIELD; /* the record ends within the keyword */
+        }
+        if ('=' == c)
         {
-            uint16_t fileChunk;
-            fileChunk =
-                min(tar->remaining_filedata, chunkSz); /* I consider as many bytes as I can to complete the file */
-            tar->remaining_filedata -= fileChunk;
-            if (0 == tar->remaining_filedata)
+            x->key = pax_key_other;
+            for (i = 0; i < sizeof(pax_keys) / sizeof(pax_keys[0]); i++)
             {
-                res = tar->recvData(tar->cbParam, tar->blockBuff,
-                                    tar->buffIdx - (chunkSz - fileChunk)); /* call the callback */
-                tar->fileFinalize(tar->cbParam);                           /* call the finalize callback because
-                                                                              the file is complete */
-                if (0 != res)
+                if ((strlen(pax_keys[i].keyword) == x->keyLen) &&
+                    (0 == memcmp(x->keyBuf, pax_keys[i].keyword, x->keyLen)))
                 {
-                    tar->status = tar_error;
-                    return TARSTEX_EFAILURE;
+                    x->key = pax_keys[i].key;
+                    break;
                 }
-                if (0 == tar->remaining_buffBytes) /* also block buffer is comlete */
+            }
+            if (x->key >= pax_key_sparseName)
+            {
+                if (NULL == tar->recvDataAt)
                 {
-                    /* update indexes, etc */
-                    tar->remaining_buffBytes = TAR_BLOCK_SIZE;
-                    tar->buffIdx             = 0;
-                    tar->status              = tar_header; /* no need to walk through tar_filePad state */
+                    x->key = pax_key_other; /* without sparse files, they are extracted as stored */
+                    tar->pending |= PENDING_STORED;
                 }
                 else
                 {
-                    tar->status = tar_filePad;
+                    tar->pending |= PENDING_SPARSE; /* from now on the map is being built */
+                    if (SPARSE_NONE == tar->sparsePax)
+                    {
+                        tar->sparsePax = SPARSE_PAX0; /* unless a major number states otherwise */
+                    }
                 }
             }
-            else if (0 == tar->remaining_buffBytes) /* completed the block buffer
-                                                       (but not the file) */
+            x->num    = 0;
+            x->valLen = 0;
+            x->frac   = 0;
+            x->neg    = 0;
+            x->status = pax_value;
+        }
+        else if (x->keyLen < sizeof(x->keyBuf))
+        {
+            x->keyBuf[x->keyLen++] = c;
+        }
+        else
+        {
+            x->keyLen = sizeof(x->keyBuf) + 1; /* too long to be a known keyword */
+        }
+        break;
+    case pax_value:
+        if (x->recPos == x->recLen)
+        {
+            /* last byte of the record */
+            if ('\n' != c)
+            {
+                return TARSTEX_EBADFIELD;
+            }
+            x->recLen = 0;
+            x->recPos = 0;
+            x->status = pax_len;
+            return pax_record(tar);
+        }
+        switch (x->key)
+        {
+        case pax_key_path:
+        case pax_key_linkpath:
+        case pax_key_sparseName:
+            if (x->valLen >= TARSTEX_PATH_MAX - 1)
+            {
+                return TARSTEX_ETOOLONG;
+            }
+            ((pax_key_linkpath == x->key) ? tar->linkname : tar->name)[x->valLen++] = c;
+            break;
+        case pax_key_mtime:
+            if (('-' == c) && (0 == x->valLen) && (0 == x->neg))
+            {
+                x->neg = 1; /* before the epoch */
+                break;
+            }
+            x->valLen = 1; /* the sign may only come first */
+            if (('.' == c) || (0 != x->frac))
             {
-                res = tar->recvData(tar->cbParam, tar->blockBuff, TAR_BLOCK_SIZE); /* call the callback */
-                if (0 != res)
+                x->frac = 1; /* sub-second resolution is not kept */
+                break;
+            }
+            /* fall through */
+        case pax_key_sparseMap:
+            if ((pax_key_sparseMap == x->key) && (',' == c))
+            {
+                /* a comma separated list of offsets and sizes */
+                i      = (unsigned)sparse_add(tar, x->num);
+                x->num = 0;
+                if (TARSTEX_ESUCCESS != (int)i)
                 {
-                    tar->status = tar_error;
-                    return TARSTEX_EFAILURE;
+                    return (int)i;
                 }
-                /* update indexes, etc */
-                tar->remaining_buffBytes = TAR_BLOCK_SIZE;
-                tar->buffIdx             = 0;
+                break;
+            }
+            /* fall through */
+        case pax_key_size:
+        case pax_key_uid:
+        case pax_key_gid:
+        case pax_key_sparseMajor:
+        case pax_key_sparseSize:
+        case pax_key_sparseOffset:
+        case pax_key_sparseNumbytes:
+            if ((digit > 9) || (x->num > (UINT64_MAX - 9) / 10))
+            {
+                return TARSTEX_EBADFIELD;
             }
+            x->num = x->num * 10 + digit;
+            break;
+        default:
+            break; /* ignored */
         }
         break;
-        case tar_filePad:
-            /* I only need to collect bytes to complete a block */
-            if (0 == tar->remaining_buffBytes)
+    default:
+        return TARSTEX_EFAILURE;
+    }
+    return TARSTEX_ESUCCESS;
+}
+
+/**
+ * @brief consume a chunk of the payload of a metadata member
+ * the chunk is read straight from the caller's buffer, only the parsed values are stored
+ *
+ * @param tar pointer to tar handle
+ * @param data payload bytes
+ * @param dataSz number of payload bytes, no more than the remaining ones
+ * @return 0 on success, or a negative value representing fault
+ */
+static int ext_data(tarStrEx_t *tar, const uint8_t *data, size_t dataSz)
+{
+    tarStrEx_ext_t *x   = &tar->ext;
+    char           *dst = (TAR_TYPE_LONGNAME == tar->hdr.type) ? tar->name : tar->linkname;
+    size_t          i;
+    int             res;
+
+    if (TAR_TYPE_PAX != tar->hdr.type)
+    {
+        /* the size has already been checked against the buffer */
+        memcpy(&dst[x->valLen], data, dataSz);
+        x->valLen += dataSz;
+    }
+    else
+    {
+        for (i = 0; i < dataSz; i++)
+        {
+            res = pax_byte(tar, (char)data[i]);
+            if (TARSTEX_ESUCCESS != res)
             {
-                /* update indexes, etc */
-                tar->remaining_buffBytes = TAR_BLOCK_SIZE;
-                tar->buffIdx             = 0;
-                tar->status              = tar_header;
+                return res;
             }
-            break;
-        case tar_error:
-            /* do nothing */
-            /* This case is handled at the beginning of while loop. I was forced to
-             * add it also here to avoid compiler warning */
-            break;
+        }
+    }
+    tar->remaining_filedata -= dataSz;
+    if (0 != tar->remaining_filedata)
+    {
+        return TARSTEX_ESUCCESS;
+    }
+
+    /* payload complete */
+    if (TAR_TYPE_PAX != tar->hdr.type)
+    {
+        /* the name is usually NUL terminated within the payload, but it is not mandatory */
+        if ((x->valLen == TARSTEX_PATH_MAX) && ('\0' != dst[TARSTEX_PATH_MAX - 1]))
+        {
+            return TARSTEX_ETOOLONG;
+        }
+        dst[min(x->valLen, (uint32_t)(TARSTEX_PATH_MAX - 1))] = '\0';
+        tar->pending |= (TAR_TYPE_LONGNAME == tar->hdr.type) ? PENDING_NAME : PENDING_LINK;
+    }
+    else if ((pax_len != x->status) || (0 != x->recPos))
+    {
+        return TARSTEX_EBADFIELD; /* truncated record */
+    }
+    data_complete(tar);
+    return TARSTEX_ESUCCESS;
+}
+
+/**
+ * @brief ignore the member whose header has just been processed: its data and padding will be only counted
+ *
+ * @param tar pointer to tar handle
+ */
+static void member_skip(tarStrEx_t *tar)
+{
+    if (tar->sparseExt)
+    {
+        /* the extension blocks of a GNU sparse map precede the data, and are not counted in the size */
+        tar->sparseSkip  = 1;
+        tar->sparsePlain = 0;
+        tar->status      = tar_sparseMap;
+        return;
+    }
+    tar->sparse             = SPARSE_NONE;
+    tar->remaining_filedata = (tar->hdr.size + TAR_BLOCK_SIZE - 1) & ~(uint64_t)(TAR_BLOCK_SIZE - 1);
+    if (0 != tar->remaining_filedata)
+    {
+        tar->status = tar_fileSkip;
+    }
+}
+
+/**
+ * @brief complete the header of a member with what the metadata members preceding it stated
+ *
+ * @param tar pointer to tar handle
+ * @param rh header as appear into tar archive
+ */
+static void header_apply_pending(tarStrEx_t *tar, const tar_header_t *rh)
+{
+    size_t len;
+
+    if (0 == (tar->pending & PENDING_NAME))
+    {
+        header_name(tar->name, rh);
+    }
+    if (0 == (tar->pending & PENDING_LINK))
+    {
+        len = field_len(rh->linkname, sizeof(rh->linkname));
+        memcpy(tar->linkname, rh->linkname, len);
+        tar->linkname[len] = '\0';
+    }
+    if (0 != (tar->pending & PENDING_SIZE))
+    {
+        tar->hdr.size = tar->pax.size;
+    }
+    if (0 != (tar->pending & PENDING_MTIME))
+    {
+        tar->hdr.mtime = tar->pax.mtime;
+    }
+    if (0 != (tar->pending & PENDING_UID))
+    {
+        tar->hdr.owner = tar->pax.owner;
+    }
+    if (0 != (tar->pending & PENDING_GID))
+    {
+        tar->hdr.group = tar->pax.group;
+    }
+
+    /* pre-POSIX archives mark regular files with a NUL type, and directories with a trailing '/' */
+    if (('\0' == tar->hdr.type) || (TAR_TYPE_CONTIG == tar->hdr.type))
+    {
+        len           = strlen(tar->name);
+        tar->hdr.type = ((len > 0) && ('/' == tar->name[len - 1])) ? TAR_TYPE_DIR : TAR_TYPE_REG;
+    }
+
+    tar->sparse     = SPARSE_NONE;
+    tar->sparseExt  = 0;
+    tar->sparseSkip = 0;
+    if ((0 != (tar->pending & PENDING_SPARSE)) && (TAR_TYPE_REG == tar->hdr.type))
+    {
+        /* PAX sparse file: the header describes the data stored, the PAX header the file they make up */
+        tar->hdr.type = TAR_TYPE_SPARSE;
+        tar->sparse   = tar->sparsePax;
+    }
+    else if ((0 != (tar->pending & PENDING_STORED)) && (TAR_TYPE_REG == tar->hdr.type))
+    {
+        /* as GNU sparse members, it keeps its type to tell that the data are not the content of the file */
+        tar->hdr.type = TAR_TYPE_SPARSE;
+    }
+    tar->pending = 0;
+}
+
+/**
+ * @brief add to the map the extents found in a GNU sparse header or extension block
+ *
+ * @param tar pointer to tar handle
+ * @param field first entry (offset and size, 12 octal digits each)
+ * @param count number of entries
+ * @return 0 on success, or a negative value representing fault
+ */
+static int sparse_gnu_entries(tarStrEx_t *tar, const uint8_t *field, unsigned count)
+{
+    uint64_t val;
+    unsigned i;
+    int      res;
+
+    for (i = 0; (i < 2 * count) && ('\0' != field[0]); i++, field += GNU_SPARSE_ENTRY_SZ / 2)
+    {
+        if (TARSTEX_ESUCCESS != parse_number(&val, (const char *)field, GNU_SPARSE_ENTRY_SZ / 2))
+        {
+            return TARSTEX_EBADFIELD;
+        }
+        res = sparse_add(tar, val);
+        if (TARSTEX_ESUCCESS != res)
+        {
+            return res;
+        }
+    }
+    return TARSTEX_ESUCCESS;
+}
+
+/**
+ * @brief check the map of a sparse file against its data, then start delivering them
+ *
+ * @param tar pointer to tar handle
+ * @return 0 on success, or a negative value representing fault
+ */
+static int sparse_data_start(tarStrEx_t *tar)
+{
+    uint64_t total = 0;
+    uint64_t end   = 0;
+    uint32_t i;
+
+    if (tar->sparseOdd)
+    {
+        return TARSTEX_EBADFIELD; /* an offset without its size */
+    }
+    for (i = 0; i < tar->sparseCnt; i++)
+    {
+        /* extents are sorted, do not overlap and lie within the file */
+        if ((tar->sparseMap[i].offset < end) || (tar->sparseMap[i].size > tar->sparseSize) ||
+            (tar->sparseMap[i].offset > tar->sparseSize - tar->sparseMap[i].size))
+        {
+            return TARSTEX_EBADFIELD;
+        }
+        end = tar->sparseMap[i].offset + tar->sparseMap[i].size;
+        total += tar->sparseMap[i].size;
+    }
+    if (total != tar->remaining_filedata)
+    {
+        return TARSTEX_EBADFIELD; /* the data stored do not fill the extents */
+    }
+    tar->sparseIdx  = 0;
+    tar->sparseDone = 0;
+    if (0 == tar->remaining_filedata)
+    {
+        file_complete(tar); /* only holes */
+    }
+    else
+    {
+        tar->status = tar_fileData;
+    }
+    return TARSTEX_ESUCCESS;
+}
+
+/**
+ * @brief start a sparse file, once it has been accepted: its map is either complete or in front of the data
+ *
+ * @param tar pointer to tar handle
+ * @return 0 on success, or a negative value representing fault
+ */
+static int sparse_start(tarStrEx_t *tar)
+{
+    switch (tar->sparse)
+    {
+    case SPARSE_PAX1:
+        /* the map is text at the beginning of the data, parsed with the metadata parser */
+        memset(&tar->ext, 0, sizeof(tar->ext));
+        tar->sparseCnt = 0;
+        tar->sparseOdd = 0;
+        tar->status    = tar_sparseMap;
+        return (0 != tar->remaining_filedata) ? TARSTEX_ESUCCESS : TARSTEX_EBADFIELD;
+    case SPARSE_GNU:
+        if (tar->sparseExt)
+        {
+            tar->status = tar_sparseMap; /* the extension blocks are collected into the block buffer */
+            return TARSTEX_ESUCCESS;
+        }
+        /* fall through */
+    default:
+        return sparse_data_start(tar);
+    }
+}
+
+/**
+ * @brief process an extension block of a GNU sparse map, once it has been fully collected into the block buffer
+ *
+ * @param tar pointer to tar handle
+ * @return 0 on success, or a negative value representing fault
+ */
+static int sparse_gnu_block(tarStrEx_t *tar)
+{
+    int res;
+
+    res            = sparse_gnu_entries(tar, tar->blockBuff, GNU_EXT_ENTRIES);
+    tar->sparseExt = (0 != tar->blockBuff[GNU_EXT_ENTRIES * GNU_SPARSE_ENTRY_SZ]);
+    block_reset(tar);
+    if ((TARSTEX_ESUCCESS != res) || tar->sparseExt)
+    {
+        return res;
+    }
+    if (tar->sparseSkip || tar->sparsePlain)
+    {
+        tar->sparseSkip = 0;
+        tar->status     = tar_header;
+        if (tar->sparsePlain)
+        {
+            data_start(tar);
+        }
+        else
+        {
+            member_skip(tar);
+        }
+        return TARSTEX_ESUCCESS;
+    }
+    return sparse_data_start(tar);
+}
+
+/**
+ * @brief parse the map of a PAX 1.0 sparse file, at the beginning of its data
+ * the map is a sequence of decimal numbers, each ended by a newline: the number of extents, then the offset and the
+ * size of each of them. It is padded to a block boundary
+ *
+ * @param tar pointer to tar handle
+ * @param data pointer to data buffer
+ * @param[in,out] dataSz bytes available (no more than the data of the file), on return the bytes consumed
+ * @return 0 on success, or a negative value representing fault
+ */
+static int sparse_pax_map(tarStrEx_t *tar, const uint8_t *data, size_t *dataSz)
+{
+    tarStrEx_ext_t *x = &tar->ext;
+    size_t          i;
+    size_t          pad;
+    unsigned        digit;
+    int             res;
+
+    /* status: 0 number of extents, 1 extents, 2 padding. recLen counts the numbers left, valLen the bytes parsed */
+    for (i = 0; (i < *dataSz) && (2 != x->status); i++)
+    {
+        digit = (unsigned)(data[i] - '0');
+        if ('\n' == data[i])
+        {
+            if (0 == x->keyLen)
+            {
+                return TARSTEX_EBADFIELD; /* empty number */
+            }
+            if (0 == x->status)
+            {
+                if (x->num > tar->sparseMax)
+                {
+                    return TARSTEX_ETOOLONG;
+                }
+                x->recLen = 2 * (uint32_t)x->num;
+                x->status = 1;
+            }
+            else
+            {
+                res = sparse_add(tar, x->num);
+                if (TARSTEX_ESUCCESS != res)
+                {
+                    return res;
+                }
+                x->recLen--;
+            }
+            x->num    = 0;
+            x->keyLen = 0;
+            if (0 == x->recLen)
+            {
+                x->status = 2;
+            }
+        }
+        else if ((digit > 9) || (x->num > (UINT64_MAX - 9) / 10))
+        {
+            return TARSTEX_EBADFIELD;
+        }
+        else
+        {
+            x->num    = x->num * 10 + digit;
+            x->keyLen = 1;
+        }
+    }
+    x->valLen += (uint32_t)i;
+    pad = 0;
+    if (2 == x->status)
+    {
+        pad = (TAR_BLOCK_SIZE - x->valLen % TAR_BLOCK_SIZE) % TAR_BLOCK_SIZE;
+        pad = min(pad, *dataSz - i);
+        x->valLen += (uint32_t)pad;
+    }
+    *dataSz = i + pad;
+    tar->remaining_filedata -= *dataSz;
+    if ((2 == x->status) && (0 == x->valLen % TAR_BLOCK_SIZE))
+    {
+        return sparse_data_start(tar);
+    }
+    return (0 != tar->remaining_filedata) ? TARSTEX_ESUCCESS : TARSTEX_EBADFIELD; /* the map must precede data */
+}
+
+/**
+ * @brief process a header block once it has been fully collected into the block buffer
+ *
+ * @param tar pointer to tar handle
+ * @param hdrOffset offset of the header block within the stream
+ * @return 0 on success, or a negative value representing fault
+ */
+static int header_complete(tarStrEx_t *tar, uint64_t hdrOffset)
+{
+    tarStrEx_entry_t entry;
+    int              keep;
+    int              res;
+
+    /* convert the header */
+    res = raw_to_header(&tar->hdr, (const tar_header_t *)tar->blockBuff);
+    block_reset(tar); /* whatever happens the header block has been consumed */
+    if (TARSTEX_ENULLRECORD == res)
+    {
+        null_record(tar);
+        /* At the end of the tar archive there are two 512-byte blocks filled with binary zeros as an end-of-file
+         * marker. A single one is simply ignored, the second one ends the archive
+         */
+        return TARSTEX_ESUCCESS;
+    }
+    else if (TARSTEX_ESUCCESS != res)
+    {
+        tar->status = tar_error;
+        return res;
+    }
+    STAT_ADD(tar, headers, 1);
+    tar->nullRun = 0;
+    switch (tar->hdr.type)
+    {
+    case TAR_TYPE_PAX:      /* extended attributes of the following member */
+    case TAR_TYPE_LONGNAME: /* path of the following member */
+    case TAR_TYPE_LONGLINK: /* link target of the following member */
+        STAT_ADD(tar, extHeaders, 1);
+        return ext_start(tar);
+    case TAR_TYPE_PAXGLOBAL: /* global attributes, not supported: ignored */
+        member_skip(tar);
+        return TARSTEX_ESUCCESS;
+    default:
+        break;
+    }
+
+    /* a regular member: the block buffer still holds its raw header */
+    header_apply_pending(tar, (const tar_header_t *)tar->blockBuff);
+    keep = (NULL == tar->filter) || tar->filter(tar->filterCtx, tar->name);
+    if ((TAR_TYPE_SPARSE == ((const tar_header_t *)tar->blockBuff)->type) && (SPARSE_NONE == tar->sparse))
+    {
+        /* old GNU sparse file: the first entries of the map and the size of the file are in the header. The
+         * extension blocks of the map follow the header whether the map is wanted or not, so they are always
+         * walked through */
+        tar->sparse      = SPARSE_GNU;
+        tar->sparseCnt   = 0;
+        tar->sparseOdd   = 0;
+        tar->sparseSkip  = !keep;
+        tar->sparsePlain = (NULL == tar->recvDataAt); /* extracted as stored: fileInit is called, the map unused */
+        tar->sparseExt   = (0 != tar->blockBuff[GNU_ISEXTENDED_OFF]);
+        res              = sparse_gnu_entries(tar, &tar->blockBuff[GNU_SPARSE_OFF], GNU_SPARSE_ENTRIES);
+        if ((TARSTEX_ESUCCESS != res) ||
+            (TARSTEX_ESUCCESS != parse_number(&tar->sparseSize, (const char *)&tar->blockBuff[GNU_REALSIZE_OFF], 12)))
+        {
+            tar->status = tar_error;
+            return TARSTEX_EBADFIELD;
+        }
+    }
+    tar->sparsePlain = (SPARSE_NONE != tar->sparse) && (NULL == tar->recvDataAt);
+    if (!keep)
+    {
+        STAT_ADD(tar, filtered, 1);
+        member_skip(tar);
+        return TARSTEX_ESUCCESS;
+    }
+    entry = (tarStrEx_entry_t){
+        .name       = tar->name,
+        .linkname   = ('\0' != tar->linkname[0]) ? tar->linkname : NULL,
+        .size       = ((SPARSE_NONE != tar->sparse) && !tar->sparsePlain) ? tar->sparseSize : tar->hdr.size,
+        .mtime      = tar->hdr.mtime,
+        .hdrOffset  = hdrOffset,
+        .dataOffset = hdrOffset + TAR_BLOCK_SIZE,
+        .mode       = tar->hdr.mode,
+        .owner      = tar->hdr.owner,
+        .group      = tar->hdr.group,
+        .type       = tar->hdr.type,
+    };
+    if (NULL != tar->entry)
+    {
+        res = CB_CALL(tar, TARSTEX_STAT_ENTRY, tar->entry(tar->cbParam, &entry)); /* call the callback */
+        if (TARSTEX_CB_SKIP == res)
+        {
+            member_skip(tar);
+            return TARSTEX_ESUCCESS;
+        }
+        else if (0 != res)
+        {
+            tar->status = tar_error;
+            return TARSTEX_EFAILURE;
+        }
+    }
+    switch (tar->hdr.type)
+    {
+    case TAR_TYPE_SPARSE: /* sparse file, expanded only with a recvDataAt callback */
+    case TAR_TYPE_REG:    /* regular file */
+        /* call the callback */
+        res = CB_CALL(tar, TARSTEX_STAT_FILEINIT,
+                      (NULL != tar->fileInitEx) ? tar->fileInitEx(tar->cbParam, &entry)
+                                                : tar->fileInit(tar->cbParam, tar->name));
+        tar->passthrough = (TARSTEX_CB_PASSTHROUGH == res);
+        if (TARSTEX_CB_SKIP == res)
+        {
+            /* the user is not interested in this file */
+            member_skip(tar);
+            break;
+        }
+        else if (((0 != res) && !tar->passthrough) || (tar->passthrough && (SPARSE_NONE != tar->sparse)))
+        {
+            tar->status = tar_error;
+            return TARSTEX_EFAILURE;
+        }
+        if (tar->sparsePlain && tar->sparseExt)
+        {
+            tar->status = tar_sparseMap; /* the extension blocks of the map precede the data */
+        }
+        else if (tar->sparsePlain || (SPARSE_NONE == tar->sparse))
+        {
+            data_start(tar);
+        }
+        else
+        {
+            if (hashed(tar))
+            {
+                tar->hash->init(tar->hashCtx);
+            }
+            tar->remaining_filedata = tar->hdr.size;
+            res                     = sparse_start(tar);
+            if (TARSTEX_ESUCCESS != res)
+            {
+                tar->status = tar_error;
+                return res;
+            }
+        }
+        break;
+    case TAR_TYPE_DIR:                                 /* directory */
+        res = CB_CALL(tar, TARSTEX_STAT_DIRCREATE, tar->dirCreate(tar->cbParam, tar->name)); /* call the callback */
+        if (0 != res)
+        {
+            tar->status = tar_error;
+            return TARSTEX_EFAILURE;
+        }
+        /* No need to change status */
+        break;
+    case TAR_TYPE_LNK: /* hard link */
+    case TAR_TYPE_SYM: /* symbolic link */
+        if (NULL != tar->link)
+        {
+            res = CB_CALL(tar, TARSTEX_STAT_LINK, tar->link(tar->cbParam, &entry)); /* call the callback */
+            if (0 != res)
+            {
+                tar->status = tar_error;
+                return TARSTEX_EFAILURE;
+            }
+        }
+        member_skip(tar); /* links have no data, but some archivers store a size for hard links */
+        break;
+    default: /* unsupported type */
+        tar->status = tar_error;
+        return TARSTEX_EFAILURE;
+        break;
+    }
+    return TARSTEX_ESUCCESS;
+}
+
+/**
+ * @brief hand a batch of files to the batch callback
+ *
+ * @param tar pointer to tar handle
+ * @param count number of files in the batch
+ * @return 0 on success, or a negative value representing fault
+ */
+static int batch_flush(tarStrEx_t *tar, size_t count)
+{
+    if ((0 != count) && (0 != CB_CALL(tar, TARSTEX_STAT_BATCH, tar->batch(tar->cbParam, tar->batchMembers, count))))
+    {
+        tar->status = tar_error;
+        return TARSTEX_EFAILURE;
+    }
+    return TARSTEX_ESUCCESS;
+}
+
+/**
+ * @brief collect into batches the regular files whose header, data and padding are all found in the caller's buffer
+ * the scan starts at a header boundary and stops at the first member that is not a regular file, or is not complete
+ * within the buffer: that's left to the state machine. Null records are consumed as well. All the batches are
+ * delivered before returning
+ *
+ * @param tar pointer to tar handle
+ * @param data caller's buffer, starting with a header block
+ * @param dataSz number of bytes in the buffer
+ * @param[out] consumed number of bytes occupied by the members delivered (or skipped)
+ * @return 0 on success, or a negative value representing fault
+ */
+static int batch_scan(tarStrEx_t *tar, const uint8_t *data, size_t dataSz, size_t *consumed)
+{
+    const tar_header_t *rh;
+    tarStrEx_member_t  *member;
+    size_t              idx      = 0;
+    size_t              count    = 0;
+    size_t              namesIdx = 0;
+    size_t              nameLen;
+    size_t              padded;
+    int                 res;
+
+    *consumed = 0;
+    while (dataSz - idx >= TAR_BLOCK_SIZE)
+    {
+        rh  = (const tar_header_t *)&data[idx];
+        res = raw_to_header(&tar->hdr, rh);
+        if (TARSTEX_ENULLRECORD == res)
+        {
+            null_record(tar);
+            idx += TAR_BLOCK_SIZE;
+            if (tar_end == tar->status)
+            {
+                break;
+            }
+            continue;
+        }
+        if ((TARSTEX_ESUCCESS != res) ||
+            ((TAR_TYPE_REG != tar->hdr.type) && (TAR_TYPE_CONTIG != tar->hdr.type) && ('\0' != tar->hdr.type)))
+        {
+            break; /* faults and other types are handled by the state machine */
+        }
+        tar->nullRun = 0;
+        header_apply_pending(tar, rh);
+        padded = (tar->hdr.size + TAR_BLOCK_SIZE - 1) & ~(uint64_t)(TAR_BLOCK_SIZE - 1);
+        if ((TAR_TYPE_REG != tar->hdr.type) || (tar->hdr.size > dataSz - idx - TAR_BLOCK_SIZE) ||
+            (padded > dataSz - idx - TAR_BLOCK_SIZE))
+        {
+            break; /* a pre-POSIX directory, or a file straddling the buffers */
+        }
+        if ((NULL != tar->filter) && !tar->filter(tar->filterCtx, tar->name))
+        {
+            STAT_ADD(tar, headers, 1);
+            STAT_ADD(tar, filtered, 1);
+            STAT_ADD(tar, bytesSkipped, padded);
+            idx += TAR_BLOCK_SIZE + padded;
+            continue;
+        }
+        nameLen = strlen(tar->name) + 1;
+        if ((count == tar->batchMax) || (nameLen > tar->batchNamesSz - namesIdx))
+        {
+            if (0 == count)
+            {
+                break; /* the path does not fit the storage at all */
+            }
+            /* storage full: deliver the batch and parse the header again */
+            res = batch_flush(tar, count);
+            if (TARSTEX_ESUCCESS != res)
+            {
+                return res;
+            }
+            count    = 0;
+            namesIdx = 0;
+            continue;
+        }
+        member  = &tar->batchMembers[count];
+        *member = (tarStrEx_member_t){
+            .entry =
+                {
+                    .name       = &tar->batchNames[namesIdx],
+                    .linkname   = NULL,
+                    .size       = tar->hdr.size,
+                    .mtime      = tar->hdr.mtime,
+                    .hdrOffset  = tar->offset + idx,
+                    .dataOffset = tar->offset + idx + TAR_BLOCK_SIZE,
+                    .mode       = tar->hdr.mode,
+                    .owner      = tar->hdr.owner,
+                    .group      = tar->hdr.group,
+                    .type       = tar->hdr.type,
+                },
+            .data = &data[idx + TAR_BLOCK_SIZE],
+        };
+        STAT_ADD(tar, headers, 1);
+        if (NULL != tar->entry)
+        {
+            member->entry.name = tar->name;
+            res                = CB_CALL(tar, TARSTEX_STAT_ENTRY, tar->entry(tar->cbParam, &member->entry));
+            member->entry.name = &tar->batchNames[namesIdx];
+            if (TARSTEX_CB_SKIP == res)
+            {
+                STAT_ADD(tar, bytesSkipped, padded);
+                idx += TAR_BLOCK_SIZE + padded;
+                continue;
+            }
+            else if (0 != res)
+            {
+                tar->status = tar_error;
+                return TARSTEX_EFAILURE;
+            }
+        }
+        memcpy(&tar->batchNames[namesIdx], tar->name, nameLen);
+        STAT_ADD(tar, bytesDirect, tar->hdr.size);
+        namesIdx += nameLen;
+        count++;
+        idx += TAR_BLOCK_SIZE + padded;
+    }
+    *consumed = idx;
+    return batch_flush(tar, count);
+}
+
+/*
+ * a simplified diagram of teh state machine is depicted:
+ *
+ *             block filled
+ *   ┌─────────────────────────────────────────────┐
+ *   ∨                                             │
+ * ┌─────────┐  file   ┌──────┐  file complete   ┌─────┐
+ * │ header  │ ──────> │ data │ ───────────────> │ pad │
+ * └─────────┘         └──────┘                  └─────┘
+ *   ∧ dir │             ∧  │
+ *   └─────┘             └──┘
+ *
+ * there is an additional 'error' state that is reached from any other state in
+ * the presence of unrecoverable errors. From the error state you cannot get out.
+ * When fileInit asks to skip the file, data and padding are counted down in the 'skip' state, that leads back to
+ * 'header'
+ * The payload of metadata members (PAX extended headers, GNU long names) is parsed in the 'extHeader' state,
+ * straight from the caller's buffer, then its padding is discarded in the 'pad' state as for files. What it states
+ * (path, size) is kept aside until the header of the member it refers to is processed
+ *
+ * Only headers need to be collected into the block buffer. File data is passed to the recvData callback straight
+ * from the caller's buffer whenever the block buffer is empty and the caller's buffer holds at least a whole block
+ * (or the whole file tail): in that case a single callback covers the largest run of whole blocks available. Only
+ * the trailing partial block is staged into the block buffer, so recvData always receives a multiple of
+ * TAR_BLOCK_SIZE bytes, except for the last call of each file. Padding is simply discarded, without copying it.
+ * There is no upper bound on the length of a run other than the size of the caller's buffer.
+ * The data of a file accepted with TARSTEX_CB_PASSTHROUGH are never staged: whatever the caller pushes is delivered
+ * at once, and the rest can be moved by the caller itself (tarStrEx_payload_pending/tarStrEx_payload_consumed)
+ * With a batch callback, the regular files found whole in the caller's buffer at a header boundary are consumed at
+ * once by batch_scan, without going through the states
+ * The map of a sparse file is completed in the 'sparseMap' state before its data: the extension blocks of a GNU
+ * sparse header are collected into the block buffer, the text map of the PAX 1.0 format is parsed at the beginning
+ * of the data. The data are then split over the extents and delivered to recvDataAt
+ * Two blocks of zeros in a row in place of a header lead to the 'end' state, that consumes whatever follows without
+ * looking at it. From the end state you cannot get out either
+ * Each state has its own handler in state_fn: the process functions just dispatch each chunk of the caller's buffer
+ * to the handler of the current state, and put the engine in error if it fails
+ */
+/**
+ * @brief hand file data to the user: a sparse file gets them split over its extents, with their offsets
+ *
+ * @param tar pointer to tar handle
+ * @param data pointer to data buffer
+ * @param dataSz number of bytes, no more than the data of the file left
+ * @return result of the callbacks
+ */
+static int file_data(tarStrEx_t *tar, const uint8_t *data, size_t dataSz)
+{
+    const tarStrEx_extent_t *ext;
+    size_t                   chunkSz;
+    int                      res;
+
+    if (SPARSE_NONE == tar->sparse)
+    {
+        return CB_CALL(tar, TARSTEX_STAT_RECVDATA, tar->recvData(tar->cbParam, data, dataSz));
+    }
+    while (dataSz > 0)
+    {
+        ext = &tar->sparseMap[tar->sparseIdx];
+        if (tar->sparseDone == ext->size)
+        {
+            tar->sparseIdx++; /* the data stored fill the extents exactly, so there is always a next one */
+            tar->sparseDone = 0;
+            continue;
+        }
+        chunkSz = (size_t)min((uint64_t)dataSz, ext->size - tar->sparseDone);
+        res     = CB_CALL(tar, TARSTEX_STAT_RECVDATA,
+                          tar->recvDataAt(tar->cbParam, ext->offset + tar->sparseDone, data, chunkSz));
+        if (0 != res)
+        {
+            return res;
+        }
+        tar->sparseDone += chunkSz;
+        data += chunkSz;
+        dataSz -= chunkSz;
+    }
+    return TARSTEX_ESUCCESS;
+}
+
+/**
+ * @brief handler of a state: consumes the first bytes of the caller's buffer
+ *
+ * @param tar pointer to tar handle
+ * @param data pointer to data buffer
+ * @param dataSz number of bytes available, never 0
+ * @param[out] chunkSz number of bytes consumed
+ * @return 0 on success, or a negative value representing fault (the engine is then put in error)
+ */
+typedef int (*state_fn_t)(tarStrEx_t *tar, const uint8_t *data, size_t dataSz, size_t *chunkSz);
+
+static int state_header(tarStrEx_t *tar, const uint8_t *data, size_t dataSz, size_t *chunkSz)
+{
+    int res;
+
+    if ((NULL != tar->batch) && (0 == tar->buffIdx) && (0 == tar->pending) && (NULL == tar->hash))
+    {
+        /* the files found whole in the caller's buffer are delivered in batches */
+        res = batch_scan(tar, data, dataSz, chunkSz);
+        if ((TARSTEX_ESUCCESS != res) || (*chunkSz > 0))
+        {
+            return res;
+        }
+    }
+    /* I write into the block buffer as many bytes as possible */
+    *chunkSz = min(dataSz, tar->remaining_buffBytes);
+    memcpy(&tar->blockBuff[tar->buffIdx], data, *chunkSz);
+    /* update indexes, ect. */
+    tar->buffIdx += *chunkSz;
+    tar->remaining_buffBytes -= *chunkSz;
+    if (0 == tar->remaining_buffBytes) /* header fully received */
+    {
+        /* the header block ends with this chunk */
+        return header_complete(tar, tar->offset + *chunkSz - TAR_BLOCK_SIZE);
+    }
+    return TARSTEX_ESUCCESS;
+}
+
+static int state_fileData(tarStrEx_t *tar, const uint8_t *data, size_t dataSz, size_t *chunkSz)
+{
+    int res;
+
+    if (tar->passthrough ||
+        ((0 == tar->buffIdx) && ((dataSz >= TAR_BLOCK_SIZE) || (dataSz >= tar->remaining_filedata))))
+    {
+        /* zero-copy path: pass the caller's buffer directly. I consider as many bytes as I can to complete
+         * the file, rounded down to whole blocks unless they complete the file. Passthrough files are never
+         * staged: the caller may move the next bytes by itself, so the engine must not hold any of them */
+        *chunkSz = min(tar->remaining_filedata, dataSz);
+        if ((*chunkSz < tar->remaining_filedata) && !tar->passthrough)
+        {
+            *chunkSz -= *chunkSz % TAR_BLOCK_SIZE;
+        }
+        if (hashed(tar))
+        {
+            tar->hash->update(tar->hashCtx, data, *chunkSz);
+        }
+        res = file_data(tar, data, *chunkSz);
+        STAT_ADD(tar, bytesDirect, *chunkSz);
+        tar->remaining_filedata -= *chunkSz;
+    }
+    else
+    {
+        /* staging path: collect the bytes of a partial block into the block buffer */
+        *chunkSz = min(dataSz, min(tar->remaining_filedata, tar->remaining_buffBytes));
+        memcpy(&tar->blockBuff[tar->buffIdx], data, *chunkSz);
+        if (hashed(tar))
+        {
+            /* digested from the caller's buffer while staging, the block buffer is never read again */
+            tar->hash->update(tar->hashCtx, data, *chunkSz);
+        }
+        tar->buffIdx += *chunkSz;
+        tar->remaining_buffBytes -= *chunkSz;
+        tar->remaining_filedata -= *chunkSz;
+        STAT_ADD(tar, bytesStaged, *chunkSz);
+        res = TARSTEX_ESUCCESS;
+        if (0 == tar->remaining_filedata)
+        {
+            res = file_data(tar, tar->blockBuff, tar->buffIdx);
+        }
+        else if (0 == tar->remaining_buffBytes) /* completed the block buffer (but not the file) */
+        {
+            res = file_data(tar, tar->blockBuff, TAR_BLOCK_SIZE);
+            block_reset(tar);
+        }
+    }
+    if (0 != res)
+    {
+        return TARSTEX_EFAILURE; /* the file is not finalized: it has not been received correctly */
+    }
+    if (0 == tar->remaining_filedata)
+    {
+        file_complete(tar);
+    }
+    return TARSTEX_ESUCCESS;
+}
+
+static int state_filePad(tarStrEx_t *tar, const uint8_t *data, size_t dataSz, size_t *chunkSz)
+{
+    (void)data;
+    /* I only need to discard bytes to complete a block */
+    *chunkSz = min(dataSz, tar->remaining_buffBytes);
+    tar->remaining_buffBytes -= *chunkSz;
+    if (0 == tar->remaining_buffBytes)
+    {
+        /* update indexes, etc */
+        block_reset(tar);
+        tar->status = tar_header;
+    }
+    return TARSTEX_ESUCCESS;
+}
+
+static int state_fileSkip(tarStrEx_t *tar, const uint8_t *data, size_t dataSz, size_t *chunkSz)
+{
+    (void)data;
+    /* data and padding of a skipped file: nothing to copy, nothing to deliver */
+    *chunkSz = min(tar->remaining_filedata, dataSz);
+    tar->remaining_filedata -= *chunkSz;
+    STAT_ADD(tar, bytesSkipped, *chunkSz);
+    if (0 == tar->remaining_filedata)
+    {
+        tar->status = tar_header;
+    }
+    return TARSTEX_ESUCCESS;
+}
+
+static int state_extHeader(tarStrEx_t *tar, const uint8_t *data, size_t dataSz, size_t *chunkSz)
+{
+    /* payload of a metadata member: parsed on the fly */
+    *chunkSz = min(tar->remaining_filedata, dataSz);
+    return ext_data(tar, data, *chunkSz);
+}
+
+static int state_sparseMap(tarStrEx_t *tar, const uint8_t *data, size_t dataSz, size_t *chunkSz)
+{
+    if (SPARSE_GNU == tar->sparse)
+    {
+        /* extension blocks of the map: collected like headers */
+        *chunkSz = min(dataSz, tar->remaining_buffBytes);
+        memcpy(&tar->blockBuff[tar->buffIdx], data, *chunkSz);
+        tar->buffIdx += *chunkSz;
+        tar->remaining_buffBytes -= *chunkSz;
+        return (0 == tar->remaining_buffBytes) ? sparse_gnu_block(tar) : TARSTEX_ESUCCESS;
+    }
+    /* text map at the beginning of the data: parsed on the fly */
+    *chunkSz = min(tar->remaining_filedata, dataSz);
+    return sparse_pax_map(tar, data, chunkSz);
+}
+
+static int state_end(tarStrEx_t *tar, const uint8_t *data, size_t dataSz, size_t *chunkSz)
+{
+    (void)tar;
+    (void)data;
+    /* past the end-of-archive blocks: the rest of the record (or whatever follows) is of no interest */
+    *chunkSz = dataSz;
+    return TARSTEX_ESUCCESS;
+}
+
+static int state_error(tarStrEx_t *tar, const uint8_t *data, size_t dataSz, size_t *chunkSz)
+{
+    (void)tar;
+    (void)data;
+    (void)dataSz;
+    /* do nothing */
+    *chunkSz = 0;
+    return TARSTEX_EFAILURE;
+}
+
+/* handlers of the states, indexed by tarStatus_t */
+static const state_fn_t state_fn[] = {
+    [tar_header]    = state_header,
+    [tar_fileData]  = state_fileData,
+    [tar_filePad]   = state_filePad,
+    [tar_fileSkip]  = state_fileSkip,
+    [tar_extHeader] = state_extHeader,
+    [tar_sparseMap] = state_sparseMap,
+    [tar_end]       = state_end,
+    [tar_error]     = state_error,
+};
+
+_Static_assert(sizeof(state_fn) / sizeof(state_fn[0]) == tar_error + 1, "every state must have a handler");
+
+int tarStrEx_process_buffer(tarStrEx_t *tar, const uint8_t *data, size_t dataSz)
+{
+    size_t chunkSz;
+    size_t dataIdx = 0;
+    int    res;
+
+    if ((NULL != tar->archHash) && (tar_error != tar->status))
+    {
+        tar->archHash->update(tar->archHashCtx, data, dataSz);
+    }
+    while (dataSz > 0) /* all byte ub data has to be processed */
+    {
+        res = state_fn[tar->status](tar, &data[dataIdx], dataSz, &chunkSz);
+        if (TARSTEX_ESUCCESS != res)
+        {
+            tar->status = tar_error;
+            return res;
+        }
+        /* update indexes, ect. */
+        dataSz -= chunkSz;
+        dataIdx += chunkSz;
+        tar->offset += chunkSz;
+    }
+    return TARSTEX_ESUCCESS;
+}
+
+int tarStrEx_process_data(tarStrEx_t *tar, const uint8_t *data, uint16_t dataSz)
+{
+    return tarStrEx_process_buffer(tar, data, dataSz);
+}
+
+int tarStrEx_process_iov(tarStrEx_t *tar, const tarStrEx_iovec_t *iov, size_t iovCnt)
+{
+    size_t i;
+    int    res = TARSTEX_ESUCCESS;
+
+    /* the state machine already carries partial blocks from one call to the next */
+    for (i = 0; (i < iovCnt) && (TARSTEX_ESUCCESS == res); i++)
+    {
+        res = tarStrEx_process_buffer(tar, iov[i].data, iov[i].dataSz);
+    }
+    return res;
+}
+
+uint64_t tarStrEx_skippable(const tarStrEx_t *tar)
+{
+    if ((tar_fileSkip == tar->status) && (NULL == tar->archHash))
+    {
+        return tar->remaining_filedata;
+    }
+    return 0;
+}
+
+int tarStrEx_skip(tarStrEx_t *tar, uint64_t skipSz)
+{
+    if (skipSz > tarStrEx_skippable(tar))
+    {
+        return TARSTEX_EFAILURE;
+    }
+    if (0 == skipSz)
+    {
+        return TARSTEX_ESUCCESS;
+    }
+    tar->remaining_filedata -= skipSz;
+    tar->offset += skipSz;
+    STAT_ADD(tar, bytesSkipped, skipSz);
+    if (0 == tar->remaining_filedata)
+    {
+        tar->status = tar_header;
+    }
+    return TARSTEX_ESUCCESS;
+}
+
+uint64_t tarStrEx_payload_pending(const tarStrEx_t *tar, uint64_t *fileOffset)
+{
+    if ((tar_fileData == tar->status) && tar->passthrough && (NULL == tar->archHash))
+    {
+        if (NULL != fileOffset)
+        {
+            *fileOffset = tar->hdr.size - tar->remaining_filedata;
+        }
+        return tar->remaining_filedata;
+    }
+    return 0;
+}
+
+int tarStrEx_payload_consumed(tarStrEx_t *tar, uint64_t payloadSz)
+{
+    if (payloadSz > tarStrEx_payload_pending(tar, NULL))
+    {
+        return TARSTEX_EFAILURE;
+    }
+    if (0 == payloadSz)
+    {
+        return TARSTEX_ESUCCESS;
+    }
+    tar->remaining_filedata -= payloadSz;
+    tar->offset += payloadSz;
+    STAT_ADD(tar, bytesMoved, payloadSz);
+    if (0 == tar->remaining_filedata)
+    {
+        file_complete(tar); /* a failure is staged, as for data pushed through the process functions */
+    }
+    return TARSTEX_ESUCCESS;
+}
+
+size_t tarStrEx_data_direct(const tarStrEx_t *tar, size_t dataSz, size_t *processSz)
+{
+    uint64_t directSz;
+    uint64_t wanted;
+
+    if ((tar_fileData == tar->status) && !tar->passthrough && (SPARSE_NONE == tar->sparse) && (0 == tar->buffIdx))
+    {
+        /* the same bytes the zero-copy path of state_fileData() would deliver */
+        directSz = min(tar->remaining_filedata, (uint64_t)dataSz);
+        if (directSz < tar->remaining_filedata)
+        {
+            directSz -= directSz % TAR_BLOCK_SIZE;
+        }
+        if (directSz > 0)
+        {
+            *processSz = 0;
+            return (size_t)directSz;
+        }
+    }
+    if ((tar_fileData == tar->status) && (0 != tar->buffIdx))
+    {
+        wanted = min(tar->remaining_filedata, (uint64_t)tar->remaining_buffBytes); /* complete the staged block */
+    }
+    else if ((tar_header == tar->status) && (NULL != tar->batch))
+    {
+        wanted = 0; /* batches are only collected from the whole buffer */
+    }
+    else
+    {
+        wanted = tarStrEx_bytes_wanted(tar);
+    }
+    *processSz = ((0 == wanted) || (wanted > dataSz)) ? dataSz : (size_t)wanted;
+    return 0;
+}
+
+int tarStrEx_data_delivered(tarStrEx_t *tar, const uint8_t *data, size_t dataSz, int res)
+{
+    size_t processSz;
+
+    if ((0 == dataSz) || (dataSz != tarStrEx_data_direct(tar, dataSz, &processSz)))
+    {
+        return TARSTEX_EFAILURE;
+    }
+    if (NULL != tar->archHash)
+    {
+        tar->archHash->update(tar->archHashCtx, data, dataSz);
+    }
+    if (0 != res)
+    {
+        tar->status = tar_error; /* the file is not finalized: it has not been received correctly */
+        return TARSTEX_EFAILURE;
+    }
+    if (hashed(tar))
+    {
+        tar->hash->update(tar->hashCtx, data, dataSz);
+    }
+    STAT_ADD(tar, bytesDirect, dataSz);
+    tar->remaining_filedata -= dataSz;
+    tar->offset += dataSz;
+    if (0 == tar->remaining_filedata)
+    {
+        file_complete(tar);
+    }
+    return TARSTEX_ESUCCESS;
+}
+
+uint64_t tarStrEx_bytes_wanted(const tarStrEx_t *tar)
+{
+    switch (tar->status)
+    {
+    case tar_header:
+        return tar->remaining_buffBytes;
+    case tar_filePad:
+        return tar->remaining_buffBytes + TAR_BLOCK_SIZE; /* a header always follows */
+    case tar_fileSkip:
+        return tar->remaining_filedata + TAR_BLOCK_SIZE;
+    case tar_fileData:
+    case tar_extHeader:
+        return tar->remaining_filedata;
+    case tar_sparseMap:
+        return (SPARSE_GNU == tar->sparse) ? tar->remaining_buffBytes : tar->remaining_filedata;
+    case tar_error:
+    default:
+        return 0;
+    }
+}
+
+int tarStrEx_set_entryCallback(tarStrEx_t *tar, cb_entry_t entry)
+{
+    tar->entry = entry;
+    return TARSTEX_ESUCCESS;
+}
+
+int tarStrEx_set_fileInitEx(tarStrEx_t *tar, cb_fileInitEx_t fileInitEx)
+{
+    tar->fileInitEx = fileInitEx;
+    return TARSTEX_ESUCCESS;
+}
+
+int tarStrEx_set_filter(tarStrEx_t *tar, tarStrEx_filter_t filter, const void *ctx)
+{
+    tar->filter    = filter;
+    tar->filterCtx = ctx;
+    return TARSTEX_ESUCCESS;
+}
+
+int tarStrEx_set_hash(tarStrEx_t *tar, const tarStrEx_hash_t *hash, void *hashCtx)
+{
+    tar->hash    = hash;
+    tar->hashCtx = hashCtx;
+    return TARSTEX_ESUCCESS;
+}
+
+int tarStrEx_set_archiveHash(tarStrEx_t *tar, const tarStrEx_hash_t *hash, void *hashCtx)
+{
+    tar->archHash    = hash;
+    tar->archHashCtx = hashCtx;
+    if (NULL != hash)
+    {
+        hash->init(hashCtx);
+    }
+    return TARSTEX_ESUCCESS;
+}
+
+int tarStrEx_set_commit(tarStrEx_t *tar, cb_verify_t verify, cb_commit_t commit)
+{
+    tar->verify = verify;
+    tar->commit = commit;
+    return TARSTEX_ESUCCESS;
+}
+
+int tarStrEx_set_linkCallback(tarStrEx_t *tar, cb_link_t link)
+{
+    tar->link = link;
+    return TARSTEX_ESUCCESS;
+}
+
+int tarStrEx_set_batchCallback(tarStrEx_t *tar, cb_batch_t batch, tarStrEx_member_t *members, size_t maxMembers,
+                               char *names, size_t namesSz)
+{
+    if ((NULL != batch) && ((NULL == members) || (0 == maxMembers) || (NULL == names) || (0 == namesSz)))
+    {
+        return TARSTEX_EFAILURE;
+    }
+    tar->batch        = batch;
+    tar->batchMembers = members;
+    tar->batchMax     = maxMembers;
+    tar->batchNames   = names;
+    tar->batchNamesSz = namesSz;
+    return TARSTEX_ESUCCESS;
+}
+
+int tarStrEx_set_sparse(tarStrEx_t *tar, cb_recvDataAt_t recvDataAt, tarStrEx_extent_t *map, size_t maxExtents)
+{
+    if ((NULL != recvDataAt) && ((NULL == map) || (0 == maxExtents)))
+    {
+        return TARSTEX_EFAILURE;
+    }
+    tar->recvDataAt = recvDataAt;
+    tar->sparseMap  = map;
+    tar->sparseMax  = (uint32_t)min(maxExtents, (size_t)(UINT32_MAX / 2)); /* twice it must fit the parser */
+    return TARSTEX_ESUCCESS;
+}
+
+uint64_t tarStrEx_offset(const tarStrEx_t *tar)
+{
+    return tar->offset;
+}
+
+int tarStrEx_complete(const tarStrEx_t *tar)
+{
+    return tar_end == tar->status;
+}
+
+int tarStrEx_set_clock(tarStrEx_t *tar, tarStrEx_clock_t clock)
+{
+#ifdef TARSTEX_STATS
+    tar->clock = clock;
+#else
+    (void)tar;
+    (void)clock;
+#endif
+    return TARSTEX_ESUCCESS;
+}
+
+int tarStrEx_stats(tarStrEx_t *tar, tarStrEx_stats_t *stats, int reset)
+{
+#ifdef TARSTEX_STATS
+    *stats = tar->stats;
+    if (reset)
+    {
+        memset(&tar->stats, 0, sizeof(tar->stats));
+    }
+#else
+    (void)tar;
+    (void)reset;
+    memset(stats, 0, sizeof(*stats));
+#endif
+    return TARSTEX_ESUCCESS;
+}
+
+/*
+ * checkpoint layout, all numbers little-endian:
+ * magic (4), version (1), TARSTEX_PATH_MAX (2), status (1), pending (1), passthrough (1), offset (8),
+ * remaining_filedata (8), buffIdx (2), remaining_buffBytes (2), hdr (29), pax (29), ext (44), blockBuff (512),
+ * name and linkname (TARSTEX_PATH_MAX each), nullRun (1), finFailed (1), reserved (6, zero), checksum (4)
+ */
+#define CHECKPOINT_MAGIC   (0x43585354) /* "TSXC" */
+#define CHECKPOINT_VERSION (2)
+
+_Static_assert(4 + 1 + 2 + 3 + 8 + 8 + 2 + 2 + 2 * 29 + 44 + TAR_BLOCK_SIZE + 2 * TARSTEX_PATH_MAX + 2 + 6 + 4 ==
+                   TARSTEX_CHECKPOINT_SZ,
+               "checkpoint size does not match its layout");
+
+/**
+ * @brief store a number, little-endian, and move the cursor past it
+ *
+ * @param[in,out] p cursor
+ * @param val number
+ * @param len bytes of the number
+ */
+static void put_le(uint8_t **p, uint64_t val, unsigned len)
+{
+    unsigned i;
+    for (i = 0; i < len; i++)
+    {
+        (*p)[i] = (uint8_t)(val >> (8 * i));
+    }
+    *p += len;
+}
+
+/**
+ * @brief load a number, little-endian, and move the cursor past it
+ *
+ * @param[in,out] p cursor
+ * @param len bytes of the number
+ * @return number
+ */
+static uint64_t get_le(const uint8_t **p, unsigned len)
+{
+    uint64_t val = 0;
+    unsigned i;
+    for (i = 0; i < len; i++)
+    {
+        val |= (uint64_t)(*p)[i] << (8 * i);
+    }
+    *p += len;
+    return val;
+}
+
+static void put_header(uint8_t **p, const tarStrEx_header_t *h)
+{
+    put_le(p, h->size, 8);
+    put_le(p, (uint64_t)h->mtime, 8);
+    put_le(p, h->mode, 4);
+    put_le(p, h->owner, 4);
+    put_le(p, h->group, 4);
+    put_le(p, (uint8_t)h->type, 1);
+}
+
+static void get_header(const uint8_t **p, tarStrEx_header_t *h)
+{
+    h->size  = get_le(p, 8);
+    h->mtime = (int64_t)get_le(p, 8);
+    h->mode  = (uint32_t)get_le(p, 4);
+    h->owner = (uint32_t)get_le(p, 4);
+    h->group = (uint32_t)get_le(p, 4);
+    h->type  = (char)get_le(p, 1);
+}
+
+/**
+ * @brief checksum of a checkpoint (FNV-1a), to detect storage corruption
+ *
+ * @param data checkpoint bytes
+ * @param len number of bytes
+ * @return checksum
+ */
+static uint32_t checkpoint_sum(const uint8_t *data, size_t len)
+{
+    uint32_t sum = 2166136261u;
+    size_t   i;
+    for (i = 0; i < len; i++)
+    {
+        sum = (sum ^ data[i]) * 16777619u;
+    }
+    return sum;
+}
+
+/**
+ * @brief check the state of the metadata parser found in a checkpoint: it writes into the path buffers
+ *
+ * @param tar pointer to tar handle
+ * @return non-zero if the parser can go on from that state
+ */
+static int ext_restorable(const tarStrEx_t *tar)
+{
+    const tarStrEx_ext_t *x = &tar->ext;
+
+    if ((0 == tar->remaining_filedata) || (tar->remaining_filedata > tar->hdr.size) ||
+        (x->valLen >= TARSTEX_PATH_MAX) || (x->keyLen > sizeof(x->keyBuf) + 1))
+    {
+        return 0;
+    }
+    switch (tar->hdr.type)
+    {
+    case TAR_TYPE_PAX:
+        return 1;
+    case TAR_TYPE_LONGNAME:
+    case TAR_TYPE_LONGLINK:
+        /* the payload is copied as is, ext_start() bounded it to the buffer */
+        return (tar->hdr.size <= TARSTEX_PATH_MAX) && (tar->hdr.size - tar->remaining_filedata == x->valLen);
+    default:
+        return 0;
+    }
+}
+
+int tarStrEx_checkpoint(const tarStrEx_t *tar, tarStrEx_checkpoint_t *cp)
+{
+    uint8_t *p = cp->data;
+
+    if ((tar_error == tar->status) || (SPARSE_NONE != tar->sparse) || (0 != (tar->pending & PENDING_SPARSE)))
+    {
+        return TARSTEX_EFAILURE; /* the map of a sparse file lives in the caller's storage, it is not saved */
+    }
+    put_le(&p, CHECKPOINT_MAGIC, 4);
+    put_le(&p, CHECKPOINT_VERSION, 1);
+    put_le(&p, TARSTEX_PATH_MAX, 2);
+    put_le(&p, tar->status, 1);
+    put_le(&p, tar->pending, 1);
+    put_le(&p, tar->passthrough, 1);
+    put_le(&p, tar->offset, 8);
+    put_le(&p, tar->remaining_filedata, 8);
+    put_le(&p, tar->buffIdx, 2);
+    put_le(&p, tar->remaining_buffBytes, 2);
+    put_header(&p, &tar->hdr);
+    put_header(&p, &tar->pax);
+    put_le(&p, tar->ext.num, 8);
+    put_le(&p, tar->ext.recLen, 4);
+    put_le(&p, tar->ext.recPos, 4);
+    put_le(&p, tar->ext.valLen, 4);
+    put_le(&p, tar->ext.status, 1);
+    put_le(&p, tar->ext.key, 1);
+    put_le(&p, tar->ext.keyLen, 1);
+    put_le(&p, tar->ext.frac, 1);
+    memcpy(p, tar->ext.keyBuf, sizeof(tar->ext.keyBuf));
+    p += sizeof(tar->ext.keyBuf);
+    memcpy(p, tar->blockBuff, TAR_BLOCK_SIZE);
+    p += TAR_BLOCK_SIZE;
+    memcpy(p, tar->name, TARSTEX_PATH_MAX);
+    p += TARSTEX_PATH_MAX;
+    memcpy(p, tar->linkname, TARSTEX_PATH_MAX);
+    p += TARSTEX_PATH_MAX;
+    put_le(&p, tar->nullRun, 1);
+    put_le(&p, tar->finFailed, 1);
+    put_le(&p, tar->ext.neg, 1);
+    put_le(&p, 0, 5);
+    put_le(&p, checkpoint_sum(cp->data, TARSTEX_CHECKPOINT_SZ - 4), 4);
+    return TARSTEX_ESUCCESS;
+}
+
+int tarStrEx_restore(tarStrEx_t *tar, const tarStrEx_checkpoint_t *cp, cb_fileResume_t resume)
+{
+    const uint8_t   *p = &cp->data[TARSTEX_CHECKPOINT_SZ - 4];
+    tarStrEx_entry_t entry;
+    uint64_t         dataOffset;
+
+    if (get_le(&p, 4) != checkpoint_sum(cp->data, TARSTEX_CHECKPOINT_SZ - 4))
+    {
+        return TARSTEX_EBADCHKSUM;
+    }
+    p = cp->data;
+    if ((CHECKPOINT_MAGIC != get_le(&p, 4)) || (CHECKPOINT_VERSION != get_le(&p, 1)) ||
+        (TARSTEX_PATH_MAX != get_le(&p, 2)))
+    {
+        return TARSTEX_EFAILURE; /* not a checkpoint, or saved by a different version or configuration */
+    }
+    tar->status              = (tarStatus_t)get_le(&p, 1);
+    tar->pending             = (uint8_t)get_le(&p, 1);
+    tar->passthrough         = (uint8_t)get_le(&p, 1);
+    tar->offset              = get_le(&p, 8);
+    tar->remaining_filedata  = get_le(&p, 8);
+    tar->buffIdx             = (uint16_t)get_le(&p, 2);
+    tar->remaining_buffBytes = (uint16_t)get_le(&p, 2);
+    get_header(&p, &tar->hdr);
+    get_header(&p, &tar->pax);
+    tar->ext.num    = get_le(&p, 8);
+    tar->ext.recLen = (uint32_t)get_le(&p, 4);
+    tar->ext.recPos = (uint32_t)get_le(&p, 4);
+    tar->ext.valLen = (uint32_t)get_le(&p, 4);
+    tar->ext.status = (uint8_t)get_le(&p, 1);
+    tar->ext.key    = (uint8_t)get_le(&p, 1);
+    tar->ext.keyLen = (uint8_t)get_le(&p, 1);
+    tar->ext.frac   = (uint8_t)get_le(&p, 1);
+    memcpy(tar->ext.keyBuf, p, sizeof(tar->ext.keyBuf));
+    p += sizeof(tar->ext.keyBuf);
+    memcpy(tar->blockBuff, p, TAR_BLOCK_SIZE);
+    p += TAR_BLOCK_SIZE;
+    memcpy(tar->name, p, TARSTEX_PATH_MAX);
+    p += TARSTEX_PATH_MAX;
+    memcpy(tar->linkname, p, TARSTEX_PATH_MAX);
+    p += TARSTEX_PATH_MAX;
+    tar->nullRun   = (uint8_t)get_le(&p, 1);
+    tar->finFailed = (uint8_t)get_le(&p, 1);
+    tar->ext.neg   = (uint8_t)get_le(&p, 1);
+
+    /* a good checksum does not make a consistent state: reject what would make the engine misbehave */
+    if ((tar_sparseMap == tar->status) || (tar->status > tar_end) || (0 != (tar->pending & PENDING_SPARSE)) ||
+        (tar->buffIdx + tar->remaining_buffBytes > TAR_BLOCK_SIZE) || ('\0' != tar->name[TARSTEX_PATH_MAX - 1]) ||
+        ('\0' != tar->linkname[TARSTEX_PATH_MAX - 1]) || (tar->nullRun > 2) ||
+        ((tar_fileData == tar->status) &&
+         ((tar->remaining_filedata > tar->hdr.size) || (tar->buffIdx > tar->hdr.size - tar->remaining_filedata))) ||
+        ((tar_extHeader == tar->status) && !ext_restorable(tar)))
+    {
+        tar->status = tar_error;
+        return TARSTEX_EFAILURE;
+    }
+
+    if ((tar_fileData == tar->status) && (NULL != resume))
+    {
+        dataOffset = tar->offset - (tar->hdr.size - tar->remaining_filedata);
+
+        entry = (tarStrEx_entry_t){
+            .name       = tar->name,
+            .linkname   = ('\0' != tar->linkname[0]) ? tar->linkname : NULL,
+            .size       = tar->hdr.size,
+            .mtime      = tar->hdr.mtime,
+            .hdrOffset  = dataOffset - TAR_BLOCK_SIZE,
+            .dataOffset = dataOffset,
+            .mode       = tar->hdr.mode,
+            .owner      = tar->hdr.owner,
+            .group      = tar->hdr.group,
+            .type       = tar->hdr.type,
+        };
+        /* the bytes staged into the block buffer have not been handed to recvData yet */
+        if (0 != resume(tar->cbParam, &entry, tar->hdr.size - tar->remaining_filedata - tar->buffIdx))
+        {
+            tar->status = tar_error;
+            return TARSTEX_EFAILURE;
         }
     }
     return TARSTEX_ESUCCESS;
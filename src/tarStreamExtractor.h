@@ -21,9 +21,8 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
 #include <stdint.h>
-#include <stdio.h>
-#include <stdlib.h>
 
 enum
 {
@@ -31,18 +30,105 @@ enum
     TARSTEX_EFAILURE    = -1,
     TARSTEX_EBADCHKSUM  = -2,
     TARSTEX_ENULLRECORD = -3,
+    TARSTEX_EBADFIELD   = -4,
+    TARSTEX_ETOOLONG    = -5,
 };
 
+/* member types, as found in the header (type field follows the POSIX IEEE P1003.1 specs) */
+enum
+{
+    TAR_TYPE_REG    = '0',
+    TAR_TYPE_LNK    = '1',
+    TAR_TYPE_SYM    = '2',
+    TAR_TYPE_CHR    = '3',
+    TAR_TYPE_BLK    = '4',
+    TAR_TYPE_DIR    = '5',
+    TAR_TYPE_FIFO   = '6',
+    TAR_TYPE_CONTIG = '7', /* contiguous file, handled as a regular file */
+    TAR_TYPE_SPARSE = 'S', /* GNU sparse file. Sparse files stored with PAX headers are reported with this type too */
+
+    /* metadata members, consumed by the engine: they describe the member that follows */
+    TAR_TYPE_PAX       = 'x', /* PAX extended header */
+    TAR_TYPE_PAXGLOBAL = 'g', /* PAX global extended header */
+    TAR_TYPE_LONGNAME  = 'L', /* GNU long name */
+    TAR_TYPE_LONGLINK  = 'K', /* GNU long link name */
+};
+
+/* values that callbacks can return, besides 0 (success) */
+enum
+{
+    TARSTEX_CB_SKIP        = 1, /* returned by fileInit: ignore the file, neither recvData nor fileFinalize will be
+                                   called */
+    TARSTEX_CB_PASSTHROUGH = 2, /* returned by fileInit: the caller moves the file data by itself (e.g. with splice),
+                                   see tarStrEx_payload_pending() */
+};
+
+/* size of the buffers holding the path and the link target of the current member, NUL terminator included. Longer
+ * paths (from PAX or GNU long name headers) are rejected with TARSTEX_ETOOLONG. Must be a multiple of 8, and large
+ * enough for a ustar prefix + name */
+#ifndef TARSTEX_PATH_MAX
+#define TARSTEX_PATH_MAX 512
+#endif
+
+/* callbacks timed by the statistics */
+enum
+{
+    TARSTEX_STAT_FILEINIT, /* fileInit or fileInitEx */
+    TARSTEX_STAT_DIRCREATE,
+    TARSTEX_STAT_RECVDATA,
+    TARSTEX_STAT_FILEFINALIZE,
+    TARSTEX_STAT_ENTRY,
+    TARSTEX_STAT_LINK,
+    TARSTEX_STAT_BATCH,
+
+    TARSTEX_STAT_CB_NUM,
+};
+
+/* number of bins of the callback latency histograms */
+#define TARSTEX_STAT_HIST_BINS 16
+
+/**
+ * @brief statistics of the engine, collected only when built with TARSTEX_STATS defined
+ * times are in ticks of the clock set with tarStrEx_set_clock(), and are 0 without one
+ */
+typedef struct tarStrEx_stats
+{
+    uint64_t bytesStaged;                     /* file data collected into the block buffer before being delivered */
+    uint64_t bytesDirect;                     /* file data delivered straight from the caller's buffers */
+    uint64_t bytesMoved;                      /* file data moved by the caller (TARSTEX_CB_PASSTHROUGH) */
+    uint64_t bytesSkipped;                    /* data (and padding) of skipped members */
+    uint64_t headers;                         /* member headers parsed, metadata members included */
+    uint64_t extHeaders;                      /* metadata members (PAX extended headers, GNU long names) */
+    uint64_t nullRecords;                     /* blocks of zeros */
+    uint64_t filtered;                        /* members rejected by the filter */
+    uint64_t cbCalls[TARSTEX_STAT_CB_NUM];    /* invocations of each callback */
+    uint64_t cbTicks[TARSTEX_STAT_CB_NUM];    /* time spent in each callback */
+    uint64_t cbMaxTicks[TARSTEX_STAT_CB_NUM]; /* longest invocation of each callback */
+    /* latencies of each callback: bin i counts the invocations that took from 2^i to 2^(i+1) - 1 ticks (bin 0
+     * includes 0 ticks, the last bin includes all the longer ones) */
+    uint32_t cbHist[TARSTEX_STAT_CB_NUM][TARSTEX_STAT_HIST_BINS];
+} tarStrEx_stats_t;
+
+#ifdef TARSTEX_STATS
+#define TARSTEX_STATS_SZ (sizeof(tarStrEx_stats_t) + 8) /* statistics and clock */
+#else
+#define TARSTEX_STATS_SZ 0
+#endif
+
 /* sed struct dimension depending on platform */
 #if UINTPTR_MAX == 0xFFFFFFFF
-#define STATIC_SETAR_BUFF_SZ 652 /* for 32-bit platforms */
+#define STATIC_SETAR_BUFF_SZ (784 + 2 * TARSTEX_PATH_MAX + TARSTEX_STATS_SZ) /* for 32-bit platforms */
 #elif UINTPTR_MAX == 0xFFFFFFFFFFFFFFFF
-#define STATIC_SETAR_BUFF_SZ 680 /* for 64-bit platforms */
+#define STATIC_SETAR_BUFF_SZ (880 + 2 * TARSTEX_PATH_MAX + TARSTEX_STATS_SZ) /* for 64-bit platforms */
 #else
 #error "Unknown platform"
 #endif
 
-#define ALIGNMENT (__SIZEOF_POINTER__)
+/* size of a serialized checkpoint (see tarStrEx_checkpoint()), the same on all platforms */
+#define TARSTEX_CHECKPOINT_SZ (656 + 2 * TARSTEX_PATH_MAX)
+
+/* 64-bit members require 8-byte alignment on some 32-bit ABIs too */
+#define ALIGNMENT (__SIZEOF_POINTER__ > 8 ? __SIZEOF_POINTER__ : 8)
 
 typedef struct __attribute__((aligned(ALIGNMENT))) static_seTar
 {
@@ -51,6 +137,42 @@ typedef struct __attribute__((aligned(ALIGNMENT))) static_seTar
 
 typedef struct tarStrEx_t tarStrEx_t;
 
+/**
+ * @brief state of the engine, serialized in a platform-independent format that can be stored (e.g. in flash)
+ */
+typedef struct tarStrEx_checkpoint
+{
+    uint8_t data[TARSTEX_CHECKPOINT_SZ];
+} tarStrEx_checkpoint_t;
+
+/**
+ * @brief a segment of the stream, for scatter/gather processing
+ * has the same layout as the POSIX struct iovec, apart from the constness
+ */
+typedef struct tarStrEx_iovec
+{
+    const uint8_t *data;   /* bytes of the segment */
+    size_t         dataSz; /* number of bytes */
+} tarStrEx_iovec_t;
+
+/**
+ * @brief description of an archive member, as found in its header
+ */
+typedef struct tarStrEx_entry
+{
+    const char *name;       /* path of the member */
+    const char *linkname;   /* target of a link, NULL if the header has none */
+    uint64_t    size;       /* number of data bytes (for sparse files, the size of the file, holes included) */
+    int64_t     mtime;      /* modification time, seconds since the epoch (negative before 1970) */
+    uint64_t    hdrOffset;  /* offset of the header block from the beginning of the stream */
+    uint64_t    dataOffset; /* offset of the first data byte from the beginning of the stream (for sparse files, the
+                               map of the extents may come first) */
+    uint32_t    mode;       /* permission bits */
+    uint32_t    owner;      /* user id */
+    uint32_t    group;      /* group id */
+    char        type;       /* type of member, as found in the header (TAR_TYPE_*) */
+} tarStrEx_entry_t;
+
 /**
  * @brief called once processed a file header, before data block processing
  * can be used to open file or initialize the storage
@@ -58,7 +180,7 @@ typedef struct tarStrEx_t tarStrEx_t;
  * @param param user parameter
  * @param path path if file
  *
- * @return 0 on success
+ * @return 0 on success, TARSTEX_CB_SKIP to skip file data, TARSTEX_CB_PASSTHROUGH to move file data by itself
  */
 typedef int (*cb_fileInit_t)(void *param, const char *path);
 
@@ -74,8 +196,10 @@ typedef int (*cb_fileInit_t)(void *param, const char *path);
 typedef int (*cb_dirCreate_t)(void *param, const char *path);
 
 /**
- * @brief called every data block
+ * @brief called every run of data blocks
  * can be used to store data in the storage
+ * dataSz is always a multiple of the tar block size (512 bytes), except for the last call of each file. A single call
+ * can cover many blocks, up to all the file data available in the buffer passed to the process function
  *
  * @param param user parameter
  * @param data array of data to store
@@ -85,9 +209,34 @@ typedef int (*cb_dirCreate_t)(void *param, const char *path);
  */
 typedef int (*cb_recvData_t)(void *param, const uint8_t *data, size_t dataSz);
 
+/**
+ * @brief same as cb_recvData_t, for sparse files: the data are those of an extent, at the given offset within the
+ * file. The holes between the extents (and at the end of the file, up to its size) are left to the callback, that
+ * will typically seek over them, leaving them unallocated. Runs have no size constraint
+ *
+ * @param param user parameter
+ * @param fileOffset offset of the data within the file
+ * @param data array of data to store
+ * @param dataSz array length of data
+ *
+ * @return 0 on success
+ */
+typedef int (*cb_recvDataAt_t)(void *param, uint64_t fileOffset, const uint8_t *data, size_t dataSz);
+
+/**
+ * @brief a region of a sparse file holding data
+ */
+typedef struct tarStrEx_extent
+{
+    uint64_t offset; /* offset within the file */
+    uint64_t size;   /* number of bytes */
+} tarStrEx_extent_t;
+
 /**
  * @brief called when all byte of a file hes been received
- * can be used to close file or deinitialize the storage
+ * can be used to close file or deinitialize the storage. A failure does not stop the extraction, whichever way the
+ * data came (pushed, delivered by the caller or moved with tarStrEx_payload_consumed()): it is staged, and reported by
+ * tarStrEx_finalize()
  *
  * @param param user parameter
  *
@@ -95,6 +244,136 @@ typedef int (*cb_recvData_t)(void *param, const uint8_t *data, size_t dataSz);
  */
 typedef int (*cb_fileFinalize_t)(void *param);
 
+/**
+ * @brief called once processed any member header, before fileInit or dirCreate
+ * can be used to index the archive. The entry is valid only during the call
+ *
+ * @param param user parameter
+ * @param entry description of the member
+ *
+ * @return 0 to go on processing the member, TARSTEX_CB_SKIP to skip it entirely (whatever its type)
+ */
+typedef int (*cb_entry_t)(void *param, const tarStrEx_entry_t *entry);
+
+/**
+ * @brief same as cb_fileInit_t, but all the metadata of the file are provided
+ * the entry is valid only during the call
+ *
+ * @param param user parameter
+ * @param entry description of the file
+ *
+ * @return 0 on success, TARSTEX_CB_SKIP to skip file data, TARSTEX_CB_PASSTHROUGH to move file data by itself
+ */
+typedef int (*cb_fileInitEx_t)(void *param, const tarStrEx_entry_t *entry);
+
+/**
+ * @brief called once processed a hard link (TAR_TYPE_LNK) or symbolic link (TAR_TYPE_SYM) header
+ * the target is entry->linkname, NULL if the header has none (a malformed archive: the callback decides whether to
+ * fail). A hard link target is a member already found earlier in the archive, so its data need not be stored again.
+ * The entry is valid only during the call
+ *
+ * @param param user parameter
+ * @param entry description of the link
+ *
+ * @return 0 on success
+ */
+typedef int (*cb_link_t)(void *param, const tarStrEx_entry_t *entry);
+
+/**
+ * @brief called by tarStrEx_restore() when the checkpoint was taken while the data of a file were being delivered
+ * the file must be opened again where it was left: its first `delivered` bytes were handed to recvData before the
+ * checkpoint, anything past them must be discarded (e.g. the file is truncated to that size). The next bytes handed
+ * to recvData are those that follow. The entry is valid only during the call
+ *
+ * @param param user parameter
+ * @param entry description of the file
+ * @param delivered bytes of the file handed to recvData before the checkpoint
+ *
+ * @return 0 on success
+ */
+typedef int (*cb_fileResume_t)(void *param, const tarStrEx_entry_t *entry, uint64_t delivered);
+
+/**
+ * @brief a file delivered within a batch (see tarStrEx_set_batchCallback())
+ */
+typedef struct tarStrEx_member
+{
+    tarStrEx_entry_t entry; /* description of the file */
+    const uint8_t   *data;  /* all the data of the file (entry.size bytes), within the buffer passed to the process
+                               function */
+} tarStrEx_member_t;
+
+/**
+ * @brief called with a batch of regular files whose header and data are all found in the buffer passed to the
+ * process function. It replaces fileInit, recvData and fileFinalize for them. Members and data are valid only during
+ * the call
+ *
+ * @param param user parameter
+ * @param members files, in the order of the archive
+ * @param count number of files
+ *
+ * @return 0 on success
+ */
+typedef int (*cb_batch_t)(void *param, const tarStrEx_member_t *members, size_t count);
+
+/**
+ * @brief selects the members to extract, evaluated as soon as a header is complete
+ *
+ * @param ctx context set along with the filter (e.g. a compiled tarStrFlt_t, see tarStreamFilter.h)
+ * @param path path of the member
+ *
+ * @return non-zero to extract the member, 0 to skip it
+ */
+typedef int (*tarStrEx_filter_t)(const void *ctx, const char *path);
+
+/**
+ * @brief a digest algorithm, run by the engine over the data of every file
+ * data is digested straight from the buffers passed to the process functions, before being handed to recvData.
+ * The result is stored into the context, and can be read in the fileFinalize callback
+ */
+typedef struct tarStrEx_hash
+{
+    /**
+     * @brief start a new digest, called after fileInit accepted the file
+     * @param ctx digest context
+     */
+    void (*init)(void *ctx);
+    /**
+     * @brief digest some file data
+     * @param ctx digest context
+     * @param data bytes to digest
+     * @param dataSz number of bytes
+     */
+    void (*update)(void *ctx, const uint8_t *data, size_t dataSz);
+    /**
+     * @brief complete the digest and store the result into the context, called just before fileFinalize
+     * @param ctx digest context
+     */
+    void (*final)(void *ctx);
+} tarStrEx_hash_t;
+
+/**
+ * @brief called by tarStrEx_finalize() in two-phase mode, to authenticate the archive before the commit
+ * the digest of the whole archive (see tarStrEx_set_archiveHash()) is complete in its context by then, so that e.g.
+ * the signature can be checked against it
+ *
+ * @param param user parameter
+ *
+ * @return 0 if the archive is authentic
+ */
+typedef int (*cb_verify_t)(void *param);
+
+/**
+ * @brief called once by tarStrEx_finalize() in two-phase mode, to make the extracted files permanent or to discard
+ * them (e.g. by swapping the update partition, or by renaming the files out of a staging directory)
+ *
+ * @param param user parameter
+ * @param commit non-zero if the archive has been found complete, correct and authentic, 0 if it must be discarded
+ *
+ * @return 0 on success
+ */
+typedef int (*cb_commit_t)(void *param, int commit);
+
 /**
  * @brief initialization function
  *
@@ -113,9 +392,11 @@ int tarStrEx_init(static_tarStrEx_t *static_seTar, tarStrEx_t **tar, void *cbPar
 
 /**
  * @brief finalization function
+ * in two-phase mode (see tarStrEx_set_commit()) it also verifies and commits the archive
  *
  * @param tar pointer to tar handle
- * @return 0 on success, or a negative value representing fault
+ * @return 0 on success, or a negative value representing fault (also if any fileFinalize failed, and in two-phase
+ * mode if the archive has been discarded)
  */
 int tarStrEx_finalize(tarStrEx_t *tar);
 
@@ -131,6 +412,311 @@ int tarStrEx_finalize(tarStrEx_t *tar);
  */
 int tarStrEx_process_data(tarStrEx_t *tar, const uint8_t *data, uint16_t dataSz);
 
+/**
+ * @brief same as tarStrEx_process_data, but accepting buffers of any size
+ * the larger the buffer, the fewer (and larger) the recvData calls
+ *
+ * @param tar pointer to tar handle
+ * @param data data array to process
+ * @param dataSz array length of data
+ * @return 0 on success, or a negative value representing fault
+ */
+int tarStrEx_process_buffer(tarStrEx_t *tar, const uint8_t *data, size_t dataSz);
+
+/**
+ * @brief same as tarStrEx_process_buffer, but the data is scattered over an array of segments
+ * segments are processed in order, as if they were contiguous: a block spanning two segments is collected into the
+ * block buffer, otherwise file data is delivered straight from each segment. Empty segments are allowed
+ *
+ * @param tar pointer to tar handle
+ * @param iov array of segments
+ * @param iovCnt number of segments
+ * @return 0 on success, or a negative value representing fault
+ */
+int tarStrEx_process_iov(tarStrEx_t *tar, const tarStrEx_iovec_t *iov, size_t iovCnt);
+
+/**
+ * @brief number of bytes of the stream that can be skipped without being processed
+ * it is not 0 only after fileInit returned TARSTEX_CB_SKIP: the data and the padding of the skipped file are of no
+ * interest, so a caller reading from a seekable source can jump past them (e.g. with lseek) and notify the engine
+ * with tarStrEx_skip(). Bytes pushed through the process functions are counted down as well. It is always 0 while
+ * the whole archive is digested (see tarStrEx_set_archiveHash())
+ *
+ * @param tar pointer to tar handle
+ * @return number of bytes that can be skipped
+ */
+uint64_t tarStrEx_skippable(const tarStrEx_t *tar);
+
+/**
+ * @brief notify the engine that some bytes of the stream have been skipped by the caller
+ *
+ * @param tar pointer to tar handle
+ * @param skipSz number of bytes skipped, no more than tarStrEx_skippable()
+ * @return 0 on success, or a negative value representing fault
+ */
+int tarStrEx_skip(tarStrEx_t *tar, uint64_t skipSz);
+
+/**
+ * @brief number of payload bytes of the current file that the caller can move by itself
+ * it is not 0 only after fileInit returned TARSTEX_CB_PASSTHROUGH: the next bytes of the stream are file data, which a
+ * caller reading from a file descriptor can move kernel-side (e.g. with splice) and then notify the engine with
+ * tarStrEx_payload_consumed(). Bytes pushed through the process functions are still delivered to recvData (never
+ * staged), and counted down as well. No digest is computed over the data of such files. It is always 0 while the
+ * whole archive is digested (see tarStrEx_set_archiveHash())
+ *
+ * @param tar pointer to tar handle
+ * @param[out] fileOffset position of the next payload byte within the file, can be NULL
+ * @return number of bytes of file data still to be consumed
+ */
+uint64_t tarStrEx_payload_pending(const tarStrEx_t *tar, uint64_t *fileOffset);
+
+/**
+ * @brief notify the engine that some payload bytes have been moved by the caller
+ * once the file is complete, fileFinalize is called; its failure is staged (see cb_fileFinalize_t)
+ *
+ * @param tar pointer to tar handle
+ * @param payloadSz number of bytes moved, no more than tarStrEx_payload_pending()
+ * @return 0 on success, or a negative value representing fault
+ */
+int tarStrEx_payload_consumed(tarStrEx_t *tar, uint64_t payloadSz);
+
+/**
+ * @brief number of the next bytes of the stream that the caller can deliver to recvData by itself
+ * they are data of a plain file, none of them staged: a caller that knows its recvData at compile time (see
+ * tarStreamExtractor.hpp) calls it directly on them, then notifies the engine with tarStrEx_data_delivered(). When it
+ * is 0, the next processSz bytes must be pushed through the process functions before asking again. Sparse files,
+ * files moved by the caller and batches of small files are always left to the engine
+ *
+ * @param tar pointer to tar handle
+ * @param dataSz number of bytes available to the caller
+ * @param[out] processSz number of bytes to push through the process functions when none can be delivered
+ * @return number of bytes to deliver, no more than dataSz
+ */
+size_t tarStrEx_data_direct(const tarStrEx_t *tar, size_t dataSz, size_t *processSz);
+
+/**
+ * @brief notify the engine that some bytes have been delivered to recvData by the caller
+ * the file digest and the archive digest (if any) are updated over them, and the file is finalized once complete. If
+ * recvData failed, the engine is put in error, as if the bytes had been pushed through the process functions.
+ * Deliveries are counted as bytesDirect, but their recvData calls are not timed
+ *
+ * @param tar pointer to tar handle
+ * @param data bytes delivered
+ * @param dataSz number of bytes delivered, as returned by tarStrEx_data_direct()
+ * @param res result of recvData
+ * @return 0 on success, or a negative value representing fault
+ */
+int tarStrEx_data_delivered(tarStrEx_t *tar, const uint8_t *data, size_t dataSz, int res);
+
+/**
+ * @brief number of bytes that complete the element of the stream being processed
+ * that is the rest of a header, of the data of a file, or of a padding (or of a skipped file) together with the
+ * header that follows it. A caller that never pushes more than this does not read past the end of a header, so it
+ * gets back control exactly where tarStrEx_payload_pending() or tarStrEx_skippable() can take over
+ *
+ * @param tar pointer to tar handle
+ * @return number of bytes, 0 once the engine is in error or the archive is complete (see tarStrEx_complete())
+ */
+uint64_t tarStrEx_bytes_wanted(const tarStrEx_t *tar);
+
+/**
+ * @brief set the optional callback called for every member header
+ * must be called after tarStrEx_init()
+ *
+ * @param tar pointer to tar handle
+ * @param entry callback, or NULL to disable it
+ * @return 0 on success, or a negative value representing fault
+ */
+int tarStrEx_set_entryCallback(tarStrEx_t *tar, cb_entry_t entry);
+
+/**
+ * @brief set the optional callback called in place of fileInit, receiving all the metadata of the file
+ * must be called after tarStrEx_init()
+ *
+ * @param tar pointer to tar handle
+ * @param fileInitEx callback, or NULL to call fileInit again
+ * @return 0 on success, or a negative value representing fault
+ */
+int tarStrEx_set_fileInitEx(tarStrEx_t *tar, cb_fileInitEx_t fileInitEx);
+
+/**
+ * @brief set the optional callback called for every link
+ * must be called after tarStrEx_init(). Without it links are ignored
+ *
+ * @param tar pointer to tar handle
+ * @param link callback, or NULL to ignore links
+ * @return 0 on success, or a negative value representing fault
+ */
+int tarStrEx_set_linkCallback(tarStrEx_t *tar, cb_link_t link);
+
+/**
+ * @brief set the optional callback delivering small files in batches
+ * must be called after tarStrEx_init(). Whenever the header, the data and the padding of a regular file are all
+ * found in the buffer being processed, the file is added to a batch instead of going through fileInit, recvData and
+ * fileFinalize. Batches are delivered before any other callback is called (the entry callback, if set, is still
+ * called for every file as it is found), so the order of the archive is kept; files that straddle the buffers are
+ * handled by the usual callbacks. Batching is not used while a digest is set.
+ * Files are kept into the caller-provided storage until the batch is delivered: their paths are copied into the
+ * names buffer
+ *
+ * @param tar pointer to tar handle
+ * @param batch callback, or NULL to disable batches
+ * @param members storage of the files of a batch
+ * @param maxMembers number of elements of members, that is the largest batch
+ * @param names storage of the paths of the files of a batch
+ * @param namesSz size of names, in bytes
+ * @return 0 on success, or a negative value representing fault
+ */
+int tarStrEx_set_batchCallback(tarStrEx_t *tar, cb_batch_t batch, tarStrEx_member_t *members, size_t maxMembers,
+                               char *names, size_t namesSz);
+
+/**
+ * @brief enable sparse files (GNU sparse members, and the PAX sparse formats 0.0, 0.1 and 1.0)
+ * must be called after tarStrEx_init(). A sparse file is reported with the TAR_TYPE_SPARSE type and its whole size,
+ * holes included; its data is delivered to recvDataAt, along with the offset of every run within the file, in place
+ * of recvData. fileInit and fileFinalize are called as for regular files, but TARSTEX_CB_PASSTHROUGH is not
+ * accepted, and the data are not digested. Without this, sparse files are extracted as they are stored: GNU sparse
+ * members keep the TAR_TYPE_SPARSE type but are reported with the size of their data and delivered to recvData (their
+ * map is walked through and discarded), and so are PAX sparse files, under the path stored in their header (the map
+ * of the format 1.0 comes with the data). The map of the extents of the file is kept into the caller-provided
+ * storage: files with more extents make the engine fail with TARSTEX_ETOOLONG.
+ * Checkpoints cannot be taken within a sparse file
+ *
+ * @param tar pointer to tar handle
+ * @param recvDataAt callback, or NULL to disable sparse files
+ * @param map storage of the map of a file
+ * @param maxExtents number of elements of map
+ * @return 0 on success, or a negative value representing fault
+ */
+int tarStrEx_set_sparse(tarStrEx_t *tar, cb_recvDataAt_t recvDataAt, tarStrEx_extent_t *map, size_t maxExtents);
+
+/**
+ * @brief set the optional filter of the members
+ * must be called after tarStrEx_init(). Members of any type that the filter rejects are skipped before any callback
+ * is called for them, the entry callback included: their data are only counted, as for TARSTEX_CB_SKIP
+ *
+ * @param tar pointer to tar handle
+ * @param filter filter, or NULL to extract all the members
+ * @param ctx context passed to the filter
+ * @return 0 on success, or a negative value representing fault
+ */
+int tarStrEx_set_filter(tarStrEx_t *tar, tarStrEx_filter_t filter, const void *ctx);
+
+/**
+ * @brief set the optional digest computed over the data of every file
+ * must be called after tarStrEx_init(). See tarStreamDigest.h for ready-made algorithms
+ *
+ * @param tar pointer to tar handle
+ * @param hash algorithm, or NULL to disable digests
+ * @param hashCtx context passed to the algorithm
+ * @return 0 on success, or a negative value representing fault
+ */
+int tarStrEx_set_hash(tarStrEx_t *tar, const tarStrEx_hash_t *hash, void *hashCtx);
+
+/**
+ * @brief set the optional digest computed over the whole archive
+ * must be called after tarStrEx_init() and before any data is processed: init is called at once. Every byte passed
+ * to the process functions is digested, headers, padding and the end-of-archive blocks included, so that the result
+ * is the digest of the archive file. final is called by tarStrEx_finalize(). No bytes can then be skipped or moved by
+ * the caller (tarStrEx_skippable() and tarStrEx_payload_pending() return 0), and the context is not saved by
+ * tarStrEx_checkpoint(): the user must save it along with the checkpoint. Can be used along with tarStrEx_set_hash(),
+ * with a different context. The bytes that follow the end of the archive are digested too, as long as they are
+ * pushed: to digest a whole archive file, keep pushing its tail once tarStrEx_complete() is true
+ *
+ * @param tar pointer to tar handle
+ * @param hash algorithm, or NULL to disable the digest
+ * @param hashCtx context passed to the algorithm
+ * @return 0 on success, or a negative value representing fault
+ */
+int tarStrEx_set_archiveHash(tarStrEx_t *tar, const tarStrEx_hash_t *hash, void *hashCtx);
+
+/**
+ * @brief enable the two-phase mode, where the extraction is committed only once the whole archive has been checked
+ * must be called after tarStrEx_init(). Files are extracted as usual, but the results of fileFinalize are staged:
+ * tarStrEx_finalize() calls verify (if any) and then commit, which is told to keep the files only if the
+ * end-of-archive blocks have been seen, no fault occurred, every fileFinalize succeeded and verify succeeded. A
+ * truncated or corrupted archive is thus discarded, and it is never read twice
+ *
+ * @param tar pointer to tar handle
+ * @param verify callback, can be NULL if the archive has not to be authenticated
+ * @param commit callback, or NULL to disable the two-phase mode
+ * @return 0 on success, or a negative value representing fault
+ */
+int tarStrEx_set_commit(tarStrEx_t *tar, cb_verify_t verify, cb_commit_t commit);
+
+/**
+ * @brief number of bytes of the stream consumed so far, either processed or skipped
+ *
+ * @param tar pointer to tar handle
+ * @return stream offset
+ */
+uint64_t tarStrEx_offset(const tarStrEx_t *tar);
+
+/**
+ * @brief tell whether the end of the archive has been reached
+ * that is once the two blocks of zeros that end a tar archive have been processed. Any byte pushed afterwards (e.g.
+ * the zeros that fill the last record) is consumed and ignored, so a caller can stop reading the source at once
+ *
+ * @param tar pointer to tar handle
+ * @return non-zero if the archive is complete
+ */
+int tarStrEx_complete(const tarStrEx_t *tar);
+
+/**
+ * @brief a clock, for the statistics
+ * any monotonic counter will do (e.g. a cycle counter, or a hardware timer on a microcontroller)
+ *
+ * @return current time, in ticks
+ */
+typedef uint64_t (*tarStrEx_clock_t)(void);
+
+/**
+ * @brief set the clock used to time the callbacks
+ * must be called after tarStrEx_init(). Without TARSTEX_STATS it does nothing
+ *
+ * @param tar pointer to tar handle
+ * @param clock clock, or NULL not to time the callbacks
+ * @return 0 on success, or a negative value representing fault
+ */
+int tarStrEx_set_clock(tarStrEx_t *tar, tarStrEx_clock_t clock);
+
+/**
+ * @brief read the statistics collected since tarStrEx_init() or the last reset
+ * they are all 0 if the engine has been built without TARSTEX_STATS
+ *
+ * @param tar pointer to tar handle
+ * @param[out] stats statistics
+ * @param reset restart collecting from 0
+ * @return 0 on success, or a negative value representing fault
+ */
+int tarStrEx_stats(tarStrEx_t *tar, tarStrEx_stats_t *stats, int reset);
+
+/**
+ * @brief save the state of the engine, so that the extraction can be resumed later (e.g. after a reboot)
+ * the checkpoint holds the parser state and the stream offset, but neither the callbacks nor the user state: the
+ * user must save along with it whatever its callbacks need to go on. Digest contexts are not saved either, so a
+ * digest is wrong for a file being extracted across a restore. Can be called between any two process calls, except
+ * within a sparse file (whose map is kept in user storage)
+ *
+ * @param tar pointer to tar handle
+ * @param[out] cp checkpoint
+ * @return 0 on success, or a negative value representing fault (the engine is in error, or within a sparse file)
+ */
+int tarStrEx_checkpoint(const tarStrEx_t *tar, tarStrEx_checkpoint_t *cp);
+
+/**
+ * @brief restore the state saved by tarStrEx_checkpoint()
+ * must be called after tarStrEx_init() and the optional setters. Processing then goes on with the stream bytes
+ * starting at tarStrEx_offset(). If the checkpoint was taken within the data of a file, resume is called so that the
+ * user opens it again (fileInit is not called)
+ *
+ * @param tar pointer to tar handle
+ * @param cp checkpoint
+ * @param resume callback, can be NULL if the user restores its own state in other ways
+ * @return 0 on success, TARSTEX_EBADCHKSUM if the checkpoint is corrupted, or a negative value representing fault
+ */
+int tarStrEx_restore(tarStrEx_t *tar, const tarStrEx_checkpoint_t *cp, cb_fileResume_t resume);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,322 @@
+
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TARSTREAMEXTRACTOR_HPP
+#define SRC_TARSTREAMEXTRACTOR_HPP
+
+/*
+ * Header-only C++ (C++11 or later) front end of the extraction engine.
+ *
+ * The callbacks are the member functions of a handler class: tarStrEx<Handler> registers with the C engine, for each
+ * handler type, static functions that forward every callback to the handler object. The data path is instantiated
+ * here for the handler: process() asks the engine which bytes are plain file data (see tarStrEx_data_direct()) and
+ * calls Handler::recvData on them directly, so that the compiler can inline it into the loop. Headers, paddings,
+ * staged blocks, sparse files and batches are still pushed through the C engine, which reaches the callbacks through
+ * its function pointers, as with the C API.
+ *
+ * A handler must provide:
+ *
+ *     int fileInit(const char *path);
+ *     int dirCreate(const char *path);
+ *     int recvData(const uint8_t *data, size_t dataSz);
+ *     int fileFinalize();
+ *
+ * and may provide any of the optional callbacks, which are then registered:
+ *
+ *     int entry(const tarStrEx_entry_t *entry);
+ *     int fileInitEx(const tarStrEx_entry_t *entry);
+ *     int link(const tarStrEx_entry_t *entry);
+ *     int batch(const tarStrEx_member_t *members, size_t count);
+ *     int fileResume(const tarStrEx_entry_t *entry, uint64_t delivered);
+ *
+ * with the same meaning and return values as the C callbacks (see tarStreamExtractor.h). Whatever is not wrapped is
+ * available through native().
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "tarStreamExtractor.h"
+
+namespace tarStrEx_detail
+{
+/* detection of the optional callbacks of a handler */
+template <class H, class = void> struct has_entry : std::false_type
+{
+};
+template <class H>
+struct has_entry<H, decltype((void)std::declval<H &>().entry(std::declval<const tarStrEx_entry_t *>()))>
+    : std::true_type
+{
+};
+
+template <class H, class = void> struct has_fileInitEx : std::false_type
+{
+};
+template <class H>
+struct has_fileInitEx<H, decltype((void)std::declval<H &>().fileInitEx(std::declval<const tarStrEx_entry_t *>()))>
+    : std::true_type
+{
+};
+
+template <class H, class = void> struct has_link : std::false_type
+{
+};
+template <class H>
+struct has_link<H, decltype((void)std::declval<H &>().link(std::declval<const tarStrEx_entry_t *>()))>
+    : std::true_type
+{
+};
+
+template <class H, class = void> struct has_fileResume : std::false_type
+{
+};
+template <class H>
+struct has_fileResume<H, decltype((void)std::declval<H &>().fileResume(std::declval<const tarStrEx_entry_t *>(),
+                                                                         std::declval<uint64_t>()))> : std::true_type
+{
+};
+} // namespace tarStrEx_detail
+
+/**
+ * @brief an extraction engine bound to a handler type
+ * the object holds the state of the engine, so it must not be copied nor moved. The handler is referenced, and must
+ * outlive the object
+ */
+template <class Handler> class tarStrEx
+{
+  public:
+    /**
+     * @brief initialize the engine, registering the callbacks of the handler
+     *
+     * @param handler object receiving the callbacks
+     */
+    explicit tarStrEx(Handler &handler) : h(handler)
+    {
+        tarStrEx_init(&storage, &tar, &h, fileInit_cb, dirCreate_cb, recvData_cb, fileFinalize_cb);
+        set_entry(has_entry());
+        set_fileInitEx(has_fileInitEx());
+        set_link(has_link());
+    }
+
+    tarStrEx(const tarStrEx &)            = delete;
+    tarStrEx &operator=(const tarStrEx &) = delete;
+
+    /**
+     * @brief process a buffer of any size (see tarStrEx_process_buffer())
+     * plain file data are delivered to Handler::recvData by this inlined loop, the rest is left to the engine
+     *
+     * @param data buffer
+     * @param dataSz number of bytes in the buffer
+     * @return 0 on success, or a negative value representing fault
+     */
+    int process(const uint8_t *data, size_t dataSz)
+    {
+        size_t directSz;
+        size_t processSz;
+        int    res;
+
+        while (dataSz > 0)
+        {
+            directSz = tarStrEx_data_direct(tar, dataSz, &processSz);
+            if (directSz > 0)
+            {
+                /* the handler type is known here: the call is not made through a function pointer */
+                res       = tarStrEx_data_delivered(tar, data, directSz, h.recvData(data, directSz));
+                processSz = directSz;
+            }
+            else
+            {
+                res = tarStrEx_process_buffer(tar, data, processSz);
+            }
+            if (TARSTEX_ESUCCESS != res)
+            {
+                return res;
+            }
+            data += processSz;
+            dataSz -= processSz;
+        }
+        return TARSTEX_ESUCCESS;
+    }
+
+    /**
+     * @brief process scattered fragments (see tarStrEx_process_iov())
+     *
+     * @param iov fragments
+     * @param iovCnt number of fragments
+     * @return 0 on success, or a negative value representing fault
+     */
+    int process(const tarStrEx_iovec_t *iov, size_t iovCnt)
+    {
+        size_t i;
+        int    res = TARSTEX_ESUCCESS;
+
+        for (i = 0; (i < iovCnt) && (TARSTEX_ESUCCESS == res); i++)
+        {
+            res = process(iov[i].data, iov[i].dataSz);
+        }
+        return res;
+    }
+
+    /**
+     * @brief end the extraction (see tarStrEx_finalize())
+     *
+     * @return 0 on success, or a negative value representing fault
+     */
+    int finalize()
+    {
+        return tarStrEx_finalize(tar);
+    }
+
+    /**
+     * @brief deliver small files in batches to Handler::batch (see tarStrEx_set_batchCallback())
+     *
+     * @param members storage of the files of a batch
+     * @param maxMembers number of elements of members
+     * @param names storage of the paths of the files of a batch
+     * @param namesSz size of names, in bytes
+     * @return 0 on success, or a negative value representing fault
+     */
+    int enable_batch(tarStrEx_member_t *members, size_t maxMembers, char *names, size_t namesSz)
+    {
+        return tarStrEx_set_batchCallback(tar, batch_cb, members, maxMembers, names, namesSz);
+    }
+
+    /**
+     * @brief bring the engine back to a checkpoint (see tarStrEx_restore())
+     * Handler::fileResume, if provided, is called when the checkpoint was taken in the middle of a file
+     *
+     * @param cp checkpoint
+     * @return 0 on success, or a negative value representing fault
+     */
+    int restore(const tarStrEx_checkpoint_t &cp)
+    {
+        return tarStrEx_restore(tar, &cp, resume_cb(has_fileResume()));
+    }
+
+    /**
+     * @brief number of bytes of the stream consumed so far (see tarStrEx_offset())
+     *
+     * @return stream offset
+     */
+    uint64_t offset() const
+    {
+        return tarStrEx_offset(tar);
+    }
+
+    /**
+     * @brief the underlying C handle, for the rest of the API
+     *
+     * @return pointer to tar handle
+     */
+    tarStrEx_t *native()
+    {
+        return tar;
+    }
+
+    /**
+     * @brief the handler receiving the callbacks
+     *
+     * @return handler
+     */
+    Handler &handler()
+    {
+        return h;
+    }
+
+  private:
+    typedef tarStrEx_detail::has_entry<Handler>      has_entry;
+    typedef tarStrEx_detail::has_fileInitEx<Handler> has_fileInitEx;
+    typedef tarStrEx_detail::has_link<Handler>       has_link;
+    typedef tarStrEx_detail::has_fileResume<Handler> has_fileResume;
+
+    /* trampolines, one set per handler type */
+    static int fileInit_cb(void *param, const char *path)
+    {
+        return static_cast<Handler *>(param)->fileInit(path);
+    }
+    static int dirCreate_cb(void *param, const char *path)
+    {
+        return static_cast<Handler *>(param)->dirCreate(path);
+    }
+    static int recvData_cb(void *param, const uint8_t *data, size_t dataSz)
+    {
+        return static_cast<Handler *>(param)->recvData(data, dataSz);
+    }
+    static int fileFinalize_cb(void *param)
+    {
+        return static_cast<Handler *>(param)->fileFinalize();
+    }
+    static int entry_cb(void *param, const tarStrEx_entry_t *entry)
+    {
+        return static_cast<Handler *>(param)->entry(entry);
+    }
+    static int fileInitEx_cb(void *param, const tarStrEx_entry_t *entry)
+    {
+        return static_cast<Handler *>(param)->fileInitEx(entry);
+    }
+    static int link_cb(void *param, const tarStrEx_entry_t *entry)
+    {
+        return static_cast<Handler *>(param)->link(entry);
+    }
+    static int batch_cb(void *param, const tarStrEx_member_t *members, size_t count)
+    {
+        return static_cast<Handler *>(param)->batch(members, count);
+    }
+    static int fileResume_cb(void *param, const tarStrEx_entry_t *entry, uint64_t delivered)
+    {
+        return static_cast<Handler *>(param)->fileResume(entry, delivered);
+    }
+
+    /* the optional callbacks are registered only if the handler provides them */
+    void set_entry(std::true_type)
+    {
+        tarStrEx_set_entryCallback(tar, entry_cb);
+    }
+    void set_entry(std::false_type)
+    {
+    }
+    void set_fileInitEx(std::true_type)
+    {
+        tarStrEx_set_fileInitEx(tar, fileInitEx_cb);
+    }
+    void set_fileInitEx(std::false_type)
+    {
+    }
+    void set_link(std::true_type)
+    {
+        tarStrEx_set_linkCallback(tar, link_cb);
+    }
+    void set_link(std::false_type)
+    {
+    }
+    static cb_fileResume_t resume_cb(std::true_type)
+    {
+        return fileResume_cb;
+    }
+    static cb_fileResume_t resume_cb(std::false_type)
+    {
+        return nullptr;
+    }
+
+    static_tarStrEx_t storage;
+    tarStrEx_t       *tar;
+    Handler          &h;
+};
+
+#endif /* SRC_TARSTREAMEXTRACTOR_HPP */
@@ -0,0 +1,425 @@
+
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Path filter. Every pattern is compiled into a small nondeterministic automaton: one state per element of the
+ * pattern, stored as a 2-byte instruction, followed by the 256-bit maps of its bracket expressions. A path is
+ * matched by running all the active states at once over its characters, with a bitset of states, so the time is
+ * linear in the length of the path whatever the wildcards, and there is no recursion.
+ * Wildcards only ever lead forward, so the states reached without consuming characters are added in one ascending
+ * pass.
+ *
+ * compiled pattern: number of bracket expressions (1), number of instructions (2, little-endian), then the maps of
+ * the bracket expressions (32 bytes each) and the instructions. The last instruction is always OP_END. Include
+ * patterns come first
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "tarStreamFilter.h"
+
+enum
+{
+    OP_LIT,   /* the character arg */
+    OP_ANY,   /* any character but '/' */
+    OP_CLASS, /* a character of the map arg */
+    OP_STAR,  /* any number of characters but '/' */
+    OP_DSTAR, /* any number of characters */
+    OP_SKIP,  /* the following arg instructions are optional (a "**" followed by '/') */
+    OP_END,   /* the pattern is complete */
+};
+
+#define HDR_SZ   3
+#define CLASS_SZ 32
+#define WORDS    ((TARSTRFLT_MAX_OPS + 1 + 31) / 32)
+
+/**
+ * @brief skip the leading "./" and '/' of a path or a pattern
+ *
+ * @param p path
+ * @return first significant character
+ */
+static const char *path_start(const char *p)
+{
+    while ('/' == p[0] || (('.' == p[0]) && ('/' == p[1])))
+    {
+        p += ('/' == p[0]) ? 1 : 2;
+    }
+    return p;
+}
+
+/**
+ * @brief length of a path or a pattern without its trailing '/'
+ *
+ * @param p path
+ * @return number of significant characters
+ */
+static size_t path_len(const char *p)
+{
+    size_t len = strlen(p);
+    while ((len > 0) && ('/' == p[len - 1]))
+    {
+        len--;
+    }
+    return len;
+}
+
+/**
+ * @brief parse a bracket expression into a map
+ *
+ * @param pat first character after the '['
+ * @param len characters left in the pattern
+ * @param[out] map map of the characters, NULL to parse only
+ * @return characters parsed up to and including the ']', or 0 if it is not terminated
+ */
+static size_t class_parse(const char *pat, size_t len, uint8_t *map)
+{
+    size_t   i      = 0;
+    int      negate = 0;
+    uint8_t  lo, hi;
+    unsigned c;
+
+    if ((i < len) && (('!' == pat[i]) || ('^' == pat[i])))
+    {
+        negate = 1;
+        i++;
+    }
+    if (NULL != map)
+    {
+        memset(map, negate ? 0xFF : 0x00, CLASS_SZ);
+    }
+    do
+    {
+        if (i >= len)
+        {
+            return 0;
+        }
+        /* a ']' right after the '[' (or the '!') is a member of the set */
+        lo = hi = (uint8_t)pat[i++];
+        if ((i + 1 < len) && ('-' == pat[i]) && (']' != pat[i + 1]))
+        {
+            hi = (uint8_t)pat[i + 1];
+            i += 2;
+        }
+        for (c = lo; (NULL != map) && (c <= hi); c++)
+        {
+            map[c / 8] = (uint8_t)(negate ? (map[c / 8] & ~(1u << (c % 8))) : (map[c / 8] | (1u << (c % 8))));
+        }
+    } while ((i >= len) || (']' != pat[i]));
+    if (NULL != map)
+    {
+        map['/' / 8] &= (uint8_t)~(1u << ('/' % 8)); /* never matched but literally */
+    }
+    return i + 1;
+}
+
+/**
+ * @brief compile a pattern
+ *
+ * @param pat pattern
+ * @param[out] out storage of the compiled pattern
+ * @param space size of out
+ * @param[out] used bytes of out used
+ * @return 0 on success, or a negative value representing fault
+ */
+static int pattern_compile(const char *pat, uint8_t *out, size_t space, size_t *used)
+{
+    size_t   len;
+    size_t   i, n;
+    unsigned nOps, nClasses, pass;
+    uint8_t *ops     = NULL;
+    uint8_t *classes = NULL;
+
+    pat = path_start(pat);
+    len = path_len(pat);
+    /* the first pass counts, the second one emits */
+    for (pass = 0; pass < 2; pass++)
+    {
+        nOps     = 0;
+        nClasses = 0;
+        for (i = 0; i < len; i++)
+        {
+            if (nOps + 3 > TARSTRFLT_MAX_OPS)
+            {
+                return TARSTEX_ETOOLONG;
+            }
+#define EMIT(op, arg)                                                                                                  \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if (NULL != ops)                                                                                               \
+        {                                                                                                              \
+            ops[2 * nOps]     = (op);                                                                                  \
+            ops[2 * nOps + 1] = (uint8_t)(arg);                                                                        \
+        }                                                                                                              \
+        nOps++;                                                                                                        \
+    } while (0)
+            switch (pat[i])
+            {
+            case '*':
+                if ((i + 1 < len) && ('*' == pat[i + 1]))
+                {
+                    while ((i + 1 < len) && ('*' == pat[i + 1]))
+                    {
+                        i++;
+                    }
+                    if ((i + 1 < len) && ('/' == pat[i + 1]))
+                    {
+                        /* "**" and the '/' after it may match nothing at all */
+                        EMIT(OP_SKIP, 2);
+                        EMIT(OP_DSTAR, 0);
+                        EMIT(OP_LIT, '/');
+                        i++;
+                    }
+                    else
+                    {
+                        EMIT(OP_DSTAR, 0);
+                    }
+                }
+                else
+                {
+                    EMIT(OP_STAR, 0);
+                }
+                break;
+            case '?':
+                EMIT(OP_ANY, 0);
+                break;
+            case '[':
+                n = class_parse(&pat[i + 1], len - i - 1, (NULL != classes) ? &classes[CLASS_SZ * nClasses] : NULL);
+                if (0 == n)
+                {
+                    return TARSTEX_EBADFIELD;
+                }
+                if (UINT8_MAX == nClasses)
+                {
+                    return TARSTEX_ETOOLONG;
+                }
+                EMIT(OP_CLASS, nClasses);
+                nClasses++;
+                i += n;
+                break;
+            case '\\':
+                if (i + 1 < len)
+                {
+                    i++;
+                }
+                /* fall through */
+            default:
+                EMIT(OP_LIT, pat[i]);
+                break;
+            }
+        }
+        EMIT(OP_END, 0);
+#undef EMIT
+        *used = HDR_SZ + CLASS_SZ * nClasses + 2 * nOps;
+        if (*used > space)
+        {
+            return TARSTEX_ETOOLONG;
+        }
+        out[0]  = (uint8_t)nClasses;
+        out[1]  = (uint8_t)nOps;
+        out[2]  = (uint8_t)(nOps >> 8);
+        classes = &out[HDR_SZ];
+        ops     = &out[HDR_SZ + CLASS_SZ * nClasses];
+    }
+    return TARSTEX_ESUCCESS;
+}
+
+int tarStrFlt_compile(tarStrFlt_t *flt, uint8_t *mem, size_t memSz, const char *const *include, size_t nInclude,
+                      const char *const *exclude, size_t nExclude)
+{
+    size_t idx = 0;
+    size_t used;
+    size_t i;
+    int    res;
+
+    for (i = 0; i < nInclude + nExclude; i++)
+    {
+        res = pattern_compile((i < nInclude) ? include[i] : exclude[i - nInclude], &mem[idx], memSz - idx, &used);
+        if (TARSTEX_ESUCCESS != res)
+        {
+            return res;
+        }
+        idx += used;
+    }
+    flt->mem      = mem;
+    flt->nInclude = (unsigned)nInclude;
+    flt->nExclude = (unsigned)nExclude;
+    return TARSTEX_ESUCCESS;
+}
+
+/**
+ * @brief size of a compiled pattern
+ *
+ * @param prog compiled pattern
+ * @return number of bytes
+ */
+static size_t pattern_size(const uint8_t *prog)
+{
+    return HDR_SZ + CLASS_SZ * prog[0] + 2 * (prog[1] | ((size_t)prog[2] << 8));
+}
+
+#define STATE_SET(s, i)  ((s)[(i) / 32] |= 1u << ((i) % 32))
+#define STATE_TEST(s, i) (0 != ((s)[(i) / 32] & (1u << ((i) % 32))))
+
+/**
+ * @brief add to a set the states reached without consuming characters
+ *
+ * @param ops instructions
+ * @param nOps number of instructions
+ * @param s set of states
+ */
+static void states_close(const uint8_t *ops, unsigned nOps, uint32_t *s)
+{
+    unsigned i;
+    for (i = 0; i < nOps; i++)
+    {
+        if (STATE_TEST(s, i))
+        {
+            switch (ops[2 * i])
+            {
+            case OP_SKIP:
+                STATE_SET(s, i + 1 + ops[2 * i + 1]);
+                /* fall through */
+            case OP_STAR:
+            case OP_DSTAR:
+                STATE_SET(s, i + 1);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * @brief match a path against a compiled pattern
+ *
+ * @param prog compiled pattern
+ * @param path path, without the leading "./"
+ * @param len length of the path, without the trailing '/'
+ * @return non-zero if the path, or one of the directories it lies in, matches
+ */
+static int pattern_match(const uint8_t *prog, const char *path, size_t len)
+{
+    const uint8_t *classes = &prog[HDR_SZ];
+    const uint8_t *ops     = &prog[HDR_SZ + CLASS_SZ * prog[0]];
+    unsigned       nOps    = prog[1] | ((unsigned)prog[2] << 8);
+    unsigned       words   = (nOps + 31) / 32;
+    uint32_t       cur[WORDS];
+    uint32_t       next[WORDS];
+    uint32_t       alive;
+    unsigned       i, arg;
+    size_t         k;
+    uint8_t        c;
+
+    memset(cur, 0, sizeof(cur));
+    STATE_SET(cur, 0);
+    states_close(ops, nOps, cur);
+    for (k = 0; k < len; k++)
+    {
+        c = (uint8_t)path[k];
+        if (('/' == c) && STATE_TEST(cur, nOps - 1))
+        {
+            return 1; /* a directory the path lies in matches */
+        }
+        memset(next, 0, words * sizeof(next[0]));
+        for (i = 0; i < nOps; i++)
+        {
+            if (!STATE_TEST(cur, i))
+            {
+                continue;
+            }
+            arg = ops[2 * i + 1];
+            switch (ops[2 * i])
+            {
+            case OP_LIT:
+                if (c == arg)
+                {
+                    STATE_SET(next, i + 1);
+                }
+                break;
+            case OP_ANY:
+                if ('/' != c)
+                {
+                    STATE_SET(next, i + 1);
+                }
+                break;
+            case OP_CLASS:
+                if (0 != (classes[CLASS_SZ * arg + c / 8] & (1u << (c % 8))))
+                {
+                    STATE_SET(next, i + 1);
+                }
+                break;
+            case OP_STAR:
+                if ('/' != c)
+                {
+                    STATE_SET(next, i);
+                }
+                break;
+            case OP_DSTAR:
+                STATE_SET(next, i);
+                break;
+            default:
+                break;
+            }
+        }
+        states_close(ops, nOps, next);
+        alive = 0;
+        for (i = 0; i < words; i++)
+        {
+            cur[i] = next[i];
+            alive |= next[i];
+        }
+        if (0 == alive)
+        {
+            return 0;
+        }
+    }
+    return STATE_TEST(cur, nOps - 1);
+}
+
+int tarStrFlt_match(const void *flt, const char *path)
+{
+    const tarStrFlt_t *f        = (const tarStrFlt_t *)flt;
+    const uint8_t     *prog     = f->mem;
+    int                selected = (0 == f->nInclude);
+    size_t             len;
+    unsigned           i;
+
+    path = path_start(path);
+    len  = path_len(path);
+    if (0 == len)
+    {
+        return 1; /* the root of the archive */
+    }
+    for (i = 0; i < f->nInclude; i++, prog += pattern_size(prog))
+    {
+        selected = selected || pattern_match(prog, path, len);
+    }
+    if (!selected)
+    {
+        return 0;
+    }
+    for (i = 0; i < f->nExclude; i++, prog += pattern_size(prog))
+    {
+        if (pattern_match(prog, path, len))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
@@ -0,0 +1,83 @@
+
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TARSTREAMFILTER_H
+#define SRC_TARSTREAMFILTER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tarStreamExtractor.h"
+
+/* longest pattern, in elements (characters, wildcards and classes) */
+#ifndef TARSTRFLT_MAX_OPS
+#define TARSTRFLT_MAX_OPS 256
+#endif
+
+/* storage needed by a pattern of len characters and nClasses bracket expressions */
+#define TARSTRFLT_PATTERN_SZ(len, nClasses) (3 + 2 * ((len) + 1) + 32 * (nClasses))
+
+/**
+ * @brief compiled set of patterns. Members are private
+ */
+typedef struct tarStrFlt
+{
+    const uint8_t *mem;      /* compiled patterns, includes first */
+    unsigned       nInclude; /* number of include patterns */
+    unsigned       nExclude; /* number of exclude patterns */
+} tarStrFlt_t;
+
+/**
+ * @brief compile include and exclude patterns into caller-provided storage
+ * patterns are shell globs matched against the whole path, with the leading "./" and the trailing '/' removed:
+ * '*' matches any sequence of characters but '/', '?' a single character but '/', "[...]" (or "[!...]") one
+ * character of a set (ranges allowed), "**" any sequence of characters, '/' included, and "**" followed by '/' zero
+ * or more whole directories. '\' makes the following character literal. A pattern matching a directory also
+ * matches everything below it: "etc" selects the directory etc and its whole content, while "etc/" followed by
+ * "**" selects its content only.
+ * A member is selected when it matches at least one include pattern (or there are none) and no exclude pattern
+ *
+ * @param[out] flt filter to compile
+ * @param mem storage of the compiled patterns, see TARSTRFLT_PATTERN_SZ()
+ * @param memSz size of mem
+ * @param include patterns of the members to select
+ * @param nInclude number of include patterns
+ * @param exclude patterns of the members to leave out
+ * @param nExclude number of exclude patterns
+ * @return 0 on success, TARSTEX_ETOOLONG if the storage is too small or a pattern too long, TARSTEX_EBADFIELD if a
+ * bracket expression is not terminated
+ */
+int tarStrFlt_compile(tarStrFlt_t *flt, uint8_t *mem, size_t memSz, const char *const *include, size_t nInclude,
+                      const char *const *exclude, size_t nExclude);
+
+/**
+ * @brief tell whether a member is selected. Suitable for tarStrEx_set_filter(), with the compiled filter as context
+ *
+ * @param flt compiled filter (tarStrFlt_t)
+ * @param path path of the member
+ * @return non-zero if the member is selected
+ */
+int tarStrFlt_match(const void *flt, const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_TARSTREAMFILTER_H */
@@ -0,0 +1,106 @@
+
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The index is built on top of the extraction engine: an entry callback records every member header and asks the
+ * engine to skip the member, so that data blocks are never copied nor delivered.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "tarStreamIndex.h"
+
+int tarStrIdx_init(tarStrIdx_t *idx, tarStrIdx_entry_t *entries, size_t capacity)
+{
+    idx->entries  = entries;
+    idx->capacity = capacity;
+    idx->count    = 0;
+    return TARSTEX_ESUCCESS;
+}
+
+int tarStrIdx_attach(tarStrIdx_t *idx, static_tarStrEx_t *static_seTar, tarStrEx_t **tar)
+{
+    int res;
+
+    /* file and directory callbacks are never called, since every member is skipped */
+    res = tarStrEx_init(static_seTar, tar, idx, NULL, NULL, NULL, NULL);
+    if (TARSTEX_ESUCCESS != res)
+    {
+        return res;
+    }
+    return tarStrEx_set_entryCallback(*tar, tarStrIdx_append);
+}
+
+int tarStrIdx_append(void *param, const tarStrEx_entry_t *entry)
+{
+    tarStrIdx_t       *idx = (tarStrIdx_t *)param;
+    tarStrIdx_entry_t *rec;
+    size_t             nameLen;
+
+    if (idx->count >= idx->capacity)
+    {
+        return TARSTEX_EFAILURE;
+    }
+    rec             = &idx->entries[idx->count];
+    rec->size       = entry->size;
+    rec->hdrOffset  = entry->hdrOffset;
+    rec->dataOffset = entry->dataOffset;
+    rec->type       = entry->type;
+    rec->flags      = 0;
+    nameLen         = strlen(entry->name);
+    if (nameLen >= TARSTRIDX_NAME_SZ)
+    {
+        /* the member is still recorded, so that the index stays complete */
+        nameLen    = TARSTRIDX_NAME_SZ - 1;
+        rec->flags = TARSTRIDX_F_TRUNCATED;
+    }
+    memcpy(rec->name, entry->name, nameLen);
+    rec->name[nameLen] = '\0';
+    if ((TAR_TYPE_LNK == entry->type) && (NULL != entry->linkname))
+    {
+        /* only earlier records are searched, as the target must precede the link; chains are already collapsed. The
+         * scan is linear: the hash table of the reader does not exist yet while the index is being built */
+        long pos = tarStrIdx_find(idx, entry->linkname);
+
+        if ((pos >= 0) && ((TAR_TYPE_REG == idx->entries[pos].type) ||
+                           (0 != (idx->entries[pos].flags & TARSTRIDX_F_LINKED))))
+        {
+            rec->size       = idx->entries[pos].size;
+            rec->dataOffset = idx->entries[pos].dataOffset;
+            rec->flags |= TARSTRIDX_F_LINKED;
+        }
+    }
+    idx->count++;
+    return TARSTEX_CB_SKIP;
+}
+
+long tarStrIdx_find(const tarStrIdx_t *idx, const char *name)
+{
+    size_t i;
+
+    /* the same path may appear more than once: as tar does, the last occurrence wins */
+    for (i = idx->count; i > 0; i--)
+    {
+        const tarStrIdx_entry_t *rec = &idx->entries[i - 1];
+
+        if ((0 == (rec->flags & TARSTRIDX_F_TRUNCATED)) && (0 == strcmp(rec->name, name)))
+        {
+            return (long)(i - 1);
+        }
+    }
+    return -1;
+}
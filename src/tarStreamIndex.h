@@ -0,0 +1,116 @@
+
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TARSTREAMINDEX_H
+#define SRC_TARSTREAMINDEX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tarStreamExtractor.h"
+
+/* maximum length of a path stored in the index, including the terminator. Records stay small by default, longer
+ * paths being truncated (TARSTRIDX_F_TRUNCATED); define it as TARSTEX_PATH_MAX to keep any path the engine accepts */
+#ifndef TARSTRIDX_NAME_SZ
+#define TARSTRIDX_NAME_SZ 104
+#endif
+
+/* flags of a record */
+#define TARSTRIDX_F_TRUNCATED 0x01 /* the path did not fit TARSTRIDX_NAME_SZ: only its beginning is stored */
+#define TARSTRIDX_F_LINKED    0x02 /* hard link resolved to an earlier regular file: size and data are its target's */
+
+/**
+ * @brief one record of the index
+ * records contain no pointers, so a table can be persisted as is and loaded back on the same platform
+ */
+typedef struct tarStrIdx_entry
+{
+    uint64_t size;                    /* number of data bytes of the member */
+    uint64_t hdrOffset;               /* offset of the header block within the archive */
+    uint64_t dataOffset;              /* offset of the first data byte within the archive */
+    char     name[TARSTRIDX_NAME_SZ]; /* NUL terminated path of the member */
+    char     type;                    /* type of member, as found in the header */
+    uint8_t  flags;                   /* TARSTRIDX_F_* flags */
+} tarStrIdx_entry_t;
+
+/**
+ * @brief index of an archive, stored into a caller-provided table
+ */
+typedef struct tarStrIdx
+{
+    tarStrIdx_entry_t *entries;  /* table of records */
+    size_t             capacity; /* number of records the table can hold */
+    size_t             count;    /* number of records populated */
+} tarStrIdx_t;
+
+/**
+ * @brief initialization function
+ *
+ * @param idx index to initialize
+ * @param entries table to be populated
+ * @param capacity number of records the table can hold
+ * @return 0 on success, or a negative value representing fault
+ */
+int tarStrIdx_init(tarStrIdx_t *idx, tarStrIdx_entry_t *entries, size_t capacity);
+
+/**
+ * @brief initialize an extraction engine in indexing mode
+ * every member header is recorded into the index and all member data is skipped, so only headers are processed.
+ * The archive is then pushed with the usual process functions; when the source is seekable, data can be jumped over
+ * as described for tarStrEx_skippable()
+ *
+ * @param idx index to be populated
+ * @param static_seTar pointer to struct buffer used to store actual seTar handle structure
+ * @param[out] tar pointer to handle pointer do be populated
+ * @return 0 on success, or a negative value representing fault
+ */
+int tarStrIdx_attach(tarStrIdx_t *idx, static_tarStrEx_t *static_seTar, tarStrEx_t **tar);
+
+/**
+ * @brief entry callback that appends a record to the index
+ * exposed to let the user build the index while extracting: call it from a cb_entry_t callback with the index as
+ * parameter
+ * a path longer than TARSTRIDX_NAME_SZ allows is truncated and the record flagged with TARSTRIDX_F_TRUNCATED
+ * a hard link whose target is a regular file recorded earlier gets the size and data offset of the target and is
+ * flagged with TARSTRIDX_F_LINKED, so that its data can be reached without parsing the archive again. The target is
+ * looked up with tarStrIdx_find(), a scan of the records: indexing costs O(links * records) on archives with many
+ * hard links
+ *
+ * @param param pointer to the index
+ * @param entry description of the member
+ * @return TARSTEX_CB_SKIP on success, or a negative value if the table is full
+ */
+int tarStrIdx_append(void *param, const tarStrEx_entry_t *entry);
+
+/**
+ * @brief look for a member by path
+ * records with a truncated path never match
+ *
+ * @param idx index
+ * @param name path of the member
+ * @return position of the last record with that path within the table, or a negative value if not found
+ */
+long tarStrIdx_find(const tarStrIdx_t *idx, const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_TARSTREAMINDEX_H */
@@ -0,0 +1,307 @@
+
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Headers of a tar archive can only be walked sequentially, but the data of different files are independent.
+ * The scanner runs the extraction engine over the whole archive with an entry callback that skips every file
+ * after having queued its byte range; workers pop file jobs from the queue and run the user callbacks over the
+ * archive memory. Sparse files, whose data may not follow their header directly, are instead let through to the
+ * scanner engine, which extracts them as stored with the callbacks of the scanner.
+ *
+ * This module requires POSIX threads; the core engine does not depend on it.
+ */
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "tarStreamParallel.h"
+
+typedef struct
+{
+    char           name[TARSTRPAR_NAME_SZ];
+    const uint8_t *data;
+    uint64_t       size;
+} parJob_t;
+
+typedef struct
+{
+    const tarStrPar_cfg_t *cfg;
+    const uint8_t         *base;
+    size_t                 len;
+
+    pthread_mutex_t lock;
+    pthread_cond_t  notEmpty;
+    pthread_cond_t  notFull;
+    parJob_t        queue[TARSTRPAR_QUEUE_SZ]; /* circular queue of jobs */
+    unsigned        head;                      /* index of the next job to pop */
+    unsigned        count;                     /* number of jobs in the queue */
+    int             done;                      /* no more jobs will be pushed */
+    int             error;                     /* first error met, 0 if none */
+} parCtx_t;
+
+typedef struct
+{
+    parCtx_t *ctx;
+    void     *cbParam;
+} parWorker_t;
+
+/**
+ * @brief record an error, unless another one has already been recorded
+ * must be called with the lock held
+ *
+ * @param ctx context
+ * @param err error
+ */
+static void set_error(parCtx_t *ctx, int err)
+{
+    if (0 == ctx->error)
+    {
+        ctx->error = err;
+    }
+    /* nobody has to wait anymore */
+    pthread_cond_broadcast(&ctx->notEmpty);
+    pthread_cond_broadcast(&ctx->notFull);
+}
+
+/**
+ * @brief run the user callbacks over a file
+ *
+ * @param cfg configuration
+ * @param cbParam parameter of the worker
+ * @param job file to process
+ * @return 0 on success, or a negative value representing fault
+ */
+static int run_job(const tarStrPar_cfg_t *cfg, void *cbParam, const parJob_t *job)
+{
+    const uint8_t *data = job->data;
+    uint64_t       remaining;
+    size_t         chunkSz;
+    int            res;
+
+    res = cfg->fileInit(cbParam, job->name);
+    if (TARSTEX_CB_SKIP == res)
+    {
+        return TARSTEX_ESUCCESS;
+    }
+    else if (0 != res)
+    {
+        return TARSTEX_EFAILURE;
+    }
+    remaining = job->size;
+    while ((0 == res) && (remaining > 0))
+    {
+        chunkSz = (size_t)remaining;
+        if ((0 != cfg->chunkSz) && (chunkSz > cfg->chunkSz))
+        {
+            chunkSz = cfg->chunkSz;
+        }
+        res = cfg->recvData(cbParam, data, chunkSz);
+        data += chunkSz;
+        remaining -= chunkSz;
+    }
+    if (0 != res)
+    {
+        /* as in the engine, a file whose data could not all be delivered is not finalized */
+        return TARSTEX_EFAILURE;
+    }
+    if (0 != cfg->fileFinalize(cbParam))
+    {
+        return TARSTEX_EFAILURE;
+    }
+    return TARSTEX_ESUCCESS;
+}
+
+static void *worker_main(void *arg)
+{
+    parWorker_t *w   = (parWorker_t *)arg;
+    parCtx_t    *ctx = w->ctx;
+    parJob_t     job;
+    int          res;
+
+    pthread_mutex_lock(&ctx->lock);
+    for (;;)
+    {
+        while ((0 == ctx->count) && !ctx->done && (0 == ctx->error))
+        {
+            pthread_cond_wait(&ctx->notEmpty, &ctx->lock);
+        }
+        if ((0 == ctx->count) || (0 != ctx->error))
+        {
+            break;
+        }
+        job       = ctx->queue[ctx->head];
+        ctx->head = (ctx->head + 1) % TARSTRPAR_QUEUE_SZ;
+        ctx->count--;
+        pthread_cond_signal(&ctx->notFull);
+        pthread_mutex_unlock(&ctx->lock);
+
+        res = run_job(ctx->cfg, w->cbParam, &job);
+
+        pthread_mutex_lock(&ctx->lock);
+        if (TARSTEX_ESUCCESS != res)
+        {
+            set_error(ctx, res);
+        }
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    return NULL;
+}
+
+/**
+ * @brief entry callback of the scanner: directories are created immediately, files are queued for the workers
+ */
+static int scan_entry(void *param, const tarStrEx_entry_t *entry)
+{
+    parCtx_t *ctx = (parCtx_t *)param;
+    parJob_t *job;
+    size_t    nameLen;
+    int       res;
+
+    switch (entry->type)
+    {
+    case TAR_TYPE_REG:
+        nameLen = strlen(entry->name);
+        if ((nameLen >= TARSTRPAR_NAME_SZ) || (entry->dataOffset > ctx->len) ||
+            (entry->size > ctx->len - entry->dataOffset))
+        {
+            return TARSTEX_EFAILURE; /* the file is truncated */
+        }
+        pthread_mutex_lock(&ctx->lock);
+        while ((TARSTRPAR_QUEUE_SZ == ctx->count) && (0 == ctx->error))
+        {
+            pthread_cond_wait(&ctx->notFull, &ctx->lock);
+        }
+        if (0 != ctx->error)
+        {
+            pthread_mutex_unlock(&ctx->lock);
+            return TARSTEX_EFAILURE;
+        }
+        job = &ctx->queue[(ctx->head + ctx->count) % TARSTRPAR_QUEUE_SZ];
+        memcpy(job->name, entry->name, nameLen + 1);
+        job->data = ctx->base + entry->dataOffset;
+        job->size = entry->size;
+        ctx->count++;
+        pthread_cond_signal(&ctx->notEmpty);
+        pthread_mutex_unlock(&ctx->lock);
+        return TARSTEX_CB_SKIP;
+    case TAR_TYPE_DIR:
+        res = ctx->cfg->dirCreate(ctx->cfg->dirParam, entry->name);
+        return (0 == res) ? TARSTEX_CB_SKIP : TARSTEX_EFAILURE;
+    case TAR_TYPE_SPARSE:
+        return 0; /* extracted by the scanner engine, through the scan_* callbacks */
+    default:
+        return TARSTEX_CB_SKIP; /* links, devices and fifos are not extracted */
+    }
+}
+
+/* callbacks of the scanner engine, for the files it extracts itself: the user callbacks, with dirParam */
+static int scan_fileInit(void *param, const char *path)
+{
+    parCtx_t *ctx = (parCtx_t *)param;
+
+    return ctx->cfg->fileInit(ctx->cfg->dirParam, path);
+}
+
+static int scan_dirCreate(void *param, const char *path)
+{
+    parCtx_t *ctx = (parCtx_t *)param;
+
+    return ctx->cfg->dirCreate(ctx->cfg->dirParam, path);
+}
+
+static int scan_recvData(void *param, const uint8_t *data, size_t dataSz)
+{
+    parCtx_t *ctx = (parCtx_t *)param;
+
+    return ctx->cfg->recvData(ctx->cfg->dirParam, data, dataSz);
+}
+
+static int scan_fileFinalize(void *param)
+{
+    parCtx_t *ctx = (parCtx_t *)param;
+
+    return ctx->cfg->fileFinalize(ctx->cfg->dirParam);
+}
+
+int tarStrPar_extract(const tarStrPar_cfg_t *cfg, const uint8_t *base, size_t len)
+{
+    static_tarStrEx_t static_seTar;
+    tarStrEx_t       *tar;
+    parCtx_t          ctx;
+    parWorker_t       workers[TARSTRPAR_MAX_WORKERS];
+    pthread_t         threads[TARSTRPAR_MAX_WORKERS];
+    unsigned          i, started;
+    int               res;
+
+    if ((0 == cfg->nWorkers) || (cfg->nWorkers > TARSTRPAR_MAX_WORKERS))
+    {
+        return TARSTEX_EFAILURE;
+    }
+
+    ctx.cfg   = cfg;
+    ctx.base  = base;
+    ctx.len   = len;
+    ctx.head  = 0;
+    ctx.count = 0;
+    ctx.done  = 0;
+    ctx.error = 0;
+    pthread_mutex_init(&ctx.lock, NULL);
+    pthread_cond_init(&ctx.notEmpty, NULL);
+    pthread_cond_init(&ctx.notFull, NULL);
+
+    for (started = 0; started < cfg->nWorkers; started++)
+    {
+        workers[started].ctx     = &ctx;
+        workers[started].cbParam = cfg->workerParams[started];
+        if (0 != pthread_create(&threads[started], NULL, worker_main, &workers[started]))
+        {
+            break;
+        }
+    }
+
+    res = TARSTEX_EFAILURE;
+    if (started == cfg->nWorkers)
+    {
+        /* the scanner: every member is skipped by the entry callback, but sparse files */
+        tarStrEx_init(&static_seTar, &tar, &ctx, scan_fileInit, scan_dirCreate, scan_recvData, scan_fileFinalize);
+        tarStrEx_set_entryCallback(tar, scan_entry);
+        res = tarStrEx_process_buffer(tar, base, len);
+        /* closes a sparse file the archive ends within; an archive without its end-of-archive blocks is truncated */
+        if (((TARSTEX_ESUCCESS != tarStrEx_finalize(tar)) || !tarStrEx_complete(tar)) && (TARSTEX_ESUCCESS == res))
+        {
+            res = TARSTEX_EFAILURE;
+        }
+    }
+
+    pthread_mutex_lock(&ctx.lock);
+    if (TARSTEX_ESUCCESS != res)
+    {
+        set_error(&ctx, res);
+    }
+    ctx.done = 1;
+    pthread_cond_broadcast(&ctx.notEmpty);
+    pthread_mutex_unlock(&ctx.lock);
+
+    for (i = 0; i < started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_cond_destroy(&ctx.notFull);
+    pthread_cond_destroy(&ctx.notEmpty);
+    pthread_mutex_destroy(&ctx.lock);
+    return (0 != ctx.error) ? ctx.error : TARSTEX_ESUCCESS;
+}
@@ -0,0 +1,83 @@
+
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TARSTREAMPARALLEL_H
+#define SRC_TARSTREAMPARALLEL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tarStreamExtractor.h"
+
+/* maximum number of workers */
+#ifndef TARSTRPAR_MAX_WORKERS
+#define TARSTRPAR_MAX_WORKERS 64
+#endif
+
+/* maximum length of a member path, including the terminator */
+#ifndef TARSTRPAR_NAME_SZ
+#define TARSTRPAR_NAME_SZ TARSTEX_PATH_MAX
+#endif
+
+/* number of members that can be waiting for a worker */
+#ifndef TARSTRPAR_QUEUE_SZ
+#define TARSTRPAR_QUEUE_SZ 64
+#endif
+
+/**
+ * @brief configuration of a parallel extraction
+ * the callbacks have the same meaning as for tarStrEx_init(). File callbacks are called by the workers, each with
+ * its own parameter, so they must not share state. Files are processed concurrently and in no particular order,
+ * but all the callbacks of a file are called by the same worker. Directories are created by the scanner, in
+ * archive order, before any file that follows them is handed to a worker. Sparse files are extracted as they are
+ * stored (see tarStrEx_set_sparse()) by the scanner too, with dirParam; links and special files are ignored
+ */
+typedef struct tarStrPar_cfg
+{
+    unsigned     nWorkers;     /* number of worker threads, 1 to TARSTRPAR_MAX_WORKERS */
+    void *const *workerParams; /* nWorkers parameters: workerParams[i] is passed to the callbacks of worker i */
+    void        *dirParam;     /* parameter of the callbacks called by the scanner: dirCreate, and sparse files */
+    size_t       chunkSz;      /* maximum number of bytes of a recvData call, 0 for the whole file at once */
+
+    cb_fileInit_t     fileInit;
+    cb_dirCreate_t    dirCreate;
+    cb_recvData_t     recvData;
+    cb_fileFinalize_t fileFinalize;
+} tarStrPar_cfg_t;
+
+/**
+ * @brief extract an archive entirely available in memory (e.g. mmap'd) using a pool of workers
+ * the calling thread scans the headers, skipping file data, and hands the byte range of each file to the first
+ * free worker. Data is delivered to recvData straight from the archive memory. Returns once all files have been
+ * processed
+ *
+ * @param cfg configuration
+ * @param base first byte of the archive
+ * @param len length of the archive
+ * @return 0 on success, or a negative value representing fault (the first one met by the scanner or any worker), also
+ * if the archive is truncated
+ */
+int tarStrPar_extract(const tarStrPar_cfg_t *cfg, const uint8_t *base, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_TARSTREAMPARALLEL_H */
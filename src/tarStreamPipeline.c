@@ -0,0 +1,531 @@
+
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Three-stage pipeline:
+ *
+ *  caller thread          parser thread              callback thread
+ * ┌─────────────┐ chunks ┌─────────────────┐ events ┌────────────────┐
+ * │ decompress  │ ─────> │ engine (headers)│ ─────> │ user callbacks │
+ * └─────────────┘        └─────────────────┘        └────────────────┘
+ *        ∧                                                  │
+ *        └──────────────────── free buffers ────────────────┘
+ *
+ * Decompressed bytes are written into a pool of handoff buffers. The parser runs the extraction engine over them,
+ * with callbacks that only turn engine calls into events, which carry no more than a pointer and a length. Data
+ * delivered straight from a handoff buffer is passed by reference; data staged by the engine into its block buffer
+ * (at most a block) is copied into one of a few staging slots, recycled by the callback stage. Once a buffer has been
+ * parsed, a release event follows all the events referring to it: the callback stage hands the buffer back to the
+ * decompression stage when it meets it.
+ *
+ * No callback is waited for, so that parsing never stalls on the callback stage: the path of fileInit and dirCreate is
+ * copied into a staging slot too. A file skipped by fileInit is still parsed by the engine: the callback stage drops
+ * the events of its data, and publishes its sequence number, so that the parser stops queueing them as soon as it
+ * sees it. Errors are recorded and stop the other stages. This module requires POSIX threads.
+ */
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "tarStreamPipeline.h"
+
+#define min(a, b)                                                                                                      \
+    ({                                                                                                                 \
+        typeof(a) _a = (a);                                                                                            \
+        typeof(b) _b = (b);                                                                                            \
+        _a < _b ? _a : _b;                                                                                             \
+    })
+
+#define BUF_EOS (~0u) /* buffer id of the end of stream chunk */
+
+enum
+{
+    EV_FILE_INIT,
+    EV_DIR_CREATE,
+    EV_DATA,
+    EV_DATA_STAGED, /* data into a staging slot, released by the event */
+    EV_FILE_FINALIZE,
+    EV_COMMIT, /* end of the archive in two-phase mode, id tells whether the engine found it complete */
+    EV_RELEASE,
+    EV_EOS,
+};
+
+static void queue_init(tarStrPipe_queue_t *q, void *elems, size_t elemSz, unsigned capacity)
+{
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->notEmpty, NULL);
+    pthread_cond_init(&q->notFull, NULL);
+    q->elems    = (uint8_t *)elems;
+    q->elemSz   = elemSz;
+    q->capacity = capacity;
+    q->head     = 0;
+    q->count    = 0;
+}
+
+static void queue_destroy(tarStrPipe_queue_t *q)
+{
+    pthread_cond_destroy(&q->notFull);
+    pthread_cond_destroy(&q->notEmpty);
+    pthread_mutex_destroy(&q->lock);
+}
+
+static void queue_push(tarStrPipe_queue_t *q, const void *elem)
+{
+    pthread_mutex_lock(&q->lock);
+    while (q->count == q->capacity)
+    {
+        pthread_cond_wait(&q->notFull, &q->lock);
+    }
+    memcpy(&q->elems[((q->head + q->count) % q->capacity) * q->elemSz], elem, q->elemSz);
+    q->count++;
+    pthread_cond_signal(&q->notEmpty);
+    pthread_mutex_unlock(&q->lock);
+}
+
+static void queue_pop(tarStrPipe_queue_t *q, void *elem)
+{
+    pthread_mutex_lock(&q->lock);
+    while (0 == q->count)
+    {
+        pthread_cond_wait(&q->notEmpty, &q->lock);
+    }
+    memcpy(elem, &q->elems[q->head * q->elemSz], q->elemSz);
+    q->head = (q->head + 1) % q->capacity;
+    q->count--;
+    pthread_cond_signal(&q->notFull);
+    pthread_mutex_unlock(&q->lock);
+}
+
+static void set_error(tarStrPipe_t *pipe, int err)
+{
+    pthread_mutex_lock(&pipe->errLock);
+    if (0 == pipe->error)
+    {
+        pipe->error = err;
+    }
+    pthread_mutex_unlock(&pipe->errLock);
+}
+
+static int get_error(tarStrPipe_t *pipe)
+{
+    int err;
+    pthread_mutex_lock(&pipe->errLock);
+    err = pipe->error;
+    pthread_mutex_unlock(&pipe->errLock);
+    return err;
+}
+
+static uint8_t *buffer(const tarStrPipe_t *pipe, unsigned bufId)
+{
+    return &pipe->cfg.bufMem[bufId * pipe->cfg.bufSz];
+}
+
+/* engine callbacks, called by the parser thread: they turn calls into events */
+
+/**
+ * @brief queue a header callback, with a copy of the path
+ *
+ * @param pipe pointer to pipeline
+ * @param kind kind of event
+ * @param path path of the member
+ * @return 0 on success, or a negative value if the pipeline is stopping
+ */
+static int ev_header(tarStrPipe_t *pipe, int kind, const char *path)
+{
+    tarStrPipe_event_t ev  = {.kind = kind, .file = pipe->fileSeq};
+    size_t             len = strlen(path);
+
+    /* once another stage failed, the engine is stopped at the next member rather than at the next buffer */
+    if ((len >= TARSTRPIPE_STAGED_SZ) || (0 != get_error(pipe)))
+    {
+        return TARSTEX_EFAILURE;
+    }
+    queue_pop(&pipe->stagedQ, &ev.id);
+    memcpy(pipe->staged[ev.id], path, len + 1);
+    ev.data = pipe->staged[ev.id];
+    ev.len  = len;
+    queue_push(&pipe->eventQ, &ev);
+    return 0;
+}
+
+static int ev_fileInit(void *param, const char *path)
+{
+    tarStrPipe_t *pipe = (tarStrPipe_t *)param;
+
+    pipe->fileSeq++;
+    return ev_header(pipe, EV_FILE_INIT, path);
+}
+
+static int ev_dirCreate(void *param, const char *path)
+{
+    return ev_header((tarStrPipe_t *)param, EV_DIR_CREATE, path);
+}
+
+/**
+ * @brief tell whether the file being parsed is known to be skipped by fileInit
+ *
+ * @param pipe pointer to pipeline
+ * @return 1 if its events can be dropped, 0 otherwise
+ */
+static int file_skipped(tarStrPipe_t *pipe)
+{
+    /* a hint only: until the skip is seen, the callback stage drops the events itself */
+    return __atomic_load_n(&pipe->skipFile, __ATOMIC_RELAXED) == pipe->fileSeq;
+}
+
+static int ev_recvData(void *param, const uint8_t *data, size_t dataSz)
+{
+    tarStrPipe_t      *pipe = (tarStrPipe_t *)param;
+    const uint8_t     *buf  = buffer(pipe, pipe->curBuf);
+    tarStrPipe_event_t ev;
+
+    if (file_skipped(pipe))
+    {
+        return 0;
+    }
+    ev.kind = EV_DATA;
+    ev.data = data; /* into the handoff buffer, valid until its release event */
+    ev.len  = dataSz;
+    if ((data < buf) || (data >= buf + pipe->cfg.bufSz))
+    {
+        /* into the engine block buffer, that will be overwritten */
+        if (dataSz > TARSTRPIPE_STAGED_SZ)
+        {
+            return TARSTEX_EFAILURE;
+        }
+        queue_pop(&pipe->stagedQ, &ev.id);
+        memcpy(pipe->staged[ev.id], data, dataSz);
+        ev.kind = EV_DATA_STAGED;
+        ev.data = pipe->staged[ev.id];
+    }
+    queue_push(&pipe->eventQ, &ev);
+    return 0;
+}
+
+static int ev_fileFinalize(void *param)
+{
+    tarStrPipe_t      *pipe = (tarStrPipe_t *)param;
+    tarStrPipe_event_t ev   = {.kind = EV_FILE_FINALIZE};
+
+    if (file_skipped(pipe))
+    {
+        return 0;
+    }
+    queue_push(&pipe->eventQ, &ev);
+    return 0;
+}
+
+static int ev_commit(void *param, int commit)
+{
+    tarStrPipe_t      *pipe = (tarStrPipe_t *)param;
+    tarStrPipe_event_t ev   = {.kind = EV_COMMIT, .id = (unsigned)commit};
+
+    /* the files are still being finalized by the callback stage: the decision is taken there */
+    queue_push(&pipe->eventQ, &ev);
+    return 0;
+}
+
+static void *parser_main(void *arg)
+{
+    tarStrPipe_t      *pipe = (tarStrPipe_t *)arg;
+    tarStrPipe_chunk_t chunk;
+    tarStrPipe_event_t ev;
+    int                res;
+
+    for (;;)
+    {
+        queue_pop(&pipe->chunkQ, &chunk);
+        if (BUF_EOS == chunk.bufId)
+        {
+            break;
+        }
+        if (0 == get_error(pipe))
+        {
+            pipe->curBuf = chunk.bufId;
+            res          = tarStrEx_process_buffer(pipe->tar, buffer(pipe, chunk.bufId), chunk.len);
+            if (TARSTEX_ESUCCESS != res)
+            {
+                set_error(pipe, res);
+            }
+        }
+        ev.kind = EV_RELEASE;
+        ev.id   = chunk.bufId;
+        queue_push(&pipe->eventQ, &ev);
+    }
+    /* the decompression stage is over: a truncated compressed stream must be known before the commit is decided */
+    if ((NULL != pipe->cfg.codec) && (NULL != pipe->codecState))
+    {
+        if (TARSTEX_ESUCCESS != pipe->cfg.codec->end(pipe->codecState))
+        {
+            set_error(pipe, TARSTEX_EFAILURE);
+        }
+        pipe->codecState = NULL;
+    }
+    if (0 == get_error(pipe))
+    {
+        res = tarStrEx_finalize(pipe->tar);
+        if (TARSTEX_ESUCCESS != res)
+        {
+            set_error(pipe, res); /* a truncated archive, or one refused by the commit hook */
+        }
+    }
+    else if (NULL != pipe->cfg.commit)
+    {
+        ev.kind = EV_COMMIT; /* the files must be discarded */
+        ev.id   = 0;
+        queue_push(&pipe->eventQ, &ev);
+    }
+    ev.kind = EV_EOS;
+    queue_push(&pipe->eventQ, &ev);
+    return NULL;
+}
+
+static void *consumer_main(void *arg)
+{
+    tarStrPipe_t           *pipe = (tarStrPipe_t *)arg;
+    const tarStrPipe_cfg_t *cfg  = &pipe->cfg;
+    tarStrPipe_event_t      ev;
+    int                     res, ok;
+
+    for (;;)
+    {
+        queue_pop(&pipe->eventQ, &ev);
+        if (EV_EOS == ev.kind)
+        {
+            break;
+        }
+        if (EV_RELEASE == ev.kind)
+        {
+            queue_push(&pipe->freeQ, &ev.id);
+            continue;
+        }
+        if (EV_COMMIT == ev.kind)
+        {
+            /* called after an error too, so that the files are discarded */
+            ok = (0 != ev.id) && (0 == get_error(pipe));
+            ok = ok && ((NULL == cfg->verify) || (0 == cfg->verify(cfg->cbParam)));
+            if ((0 != cfg->commit(cfg->cbParam, ok)) || !ok)
+            {
+                set_error(pipe, TARSTEX_EFAILURE);
+            }
+            continue;
+        }
+        /* after an error the events are drained: buffers and slots must go back */
+        res = get_error(pipe);
+        if (0 == res)
+        {
+            switch (ev.kind)
+            {
+            case EV_FILE_INIT:
+                res        = cfg->fileInit(cfg->cbParam, (const char *)ev.data);
+                pipe->drop = (TARSTEX_CB_SKIP == res);
+                if (pipe->drop)
+                {
+                    __atomic_store_n(&pipe->skipFile, ev.file, __ATOMIC_RELAXED);
+                    res = 0;
+                }
+                /* the callback stage cannot move file data by itself: TARSTEX_CB_PASSTHROUGH is a failure */
+                break;
+            case EV_DIR_CREATE:
+                res = cfg->dirCreate(cfg->cbParam, (const char *)ev.data);
+                break;
+            case EV_DATA:
+            case EV_DATA_STAGED:
+                if (!pipe->drop)
+                {
+                    res = cfg->recvData(cfg->cbParam, ev.data, ev.len);
+                    /* a file whose data could not all be delivered is not finalized */
+                    pipe->drop = (0 != res);
+                }
+                break;
+            case EV_FILE_FINALIZE:
+                if (!pipe->drop)
+                {
+                    res = cfg->fileFinalize(cfg->cbParam);
+                }
+                break;
+            }
+        }
+        if ((EV_DATA_STAGED == ev.kind) || (EV_FILE_INIT == ev.kind) || (EV_DIR_CREATE == ev.kind))
+        {
+            queue_push(&pipe->stagedQ, &ev.id);
+        }
+        if (0 != res)
+        {
+            set_error(pipe, TARSTEX_EFAILURE);
+        }
+    }
+    return NULL;
+}
+
+int tarStrPipe_init(tarStrPipe_t *pipe, const tarStrPipe_cfg_t *cfg)
+{
+    unsigned i;
+    int      res;
+
+    if ((cfg->nBufs < 2) || (cfg->nBufs > TARSTRPIPE_MAX_BUFS) || (0 == cfg->bufSz))
+    {
+        return TARSTEX_EFAILURE;
+    }
+    pipe->cfg        = *cfg;
+    pipe->codecState = NULL;
+    pipe->fileSeq    = 0;
+    pipe->skipFile   = 0;
+    pipe->drop       = 0;
+    pipe->threads    = 0;
+    pipe->error      = 0;
+    if (NULL != cfg->codec)
+    {
+        res = cfg->codec->init(cfg->workMem, cfg->workMemSz, &pipe->codecState);
+        if (TARSTEX_ESUCCESS != res)
+        {
+            return res;
+        }
+    }
+    pthread_mutex_init(&pipe->errLock, NULL);
+    queue_init(&pipe->freeQ, pipe->freeElems, sizeof(pipe->freeElems[0]), cfg->nBufs);
+    /* one more element for the end of stream */
+    queue_init(&pipe->chunkQ, pipe->chunkElems, sizeof(pipe->chunkElems[0]), cfg->nBufs + 1);
+    queue_init(&pipe->eventQ, pipe->eventElems, sizeof(pipe->eventElems[0]), TARSTRPIPE_EVQ_SZ);
+    queue_init(&pipe->stagedQ, pipe->stagedElems, sizeof(pipe->stagedElems[0]), TARSTRPIPE_STAGED_NUM);
+    for (i = 0; i < cfg->nBufs; i++)
+    {
+        queue_push(&pipe->freeQ, &i);
+    }
+    for (i = 0; i < TARSTRPIPE_STAGED_NUM; i++)
+    {
+        queue_push(&pipe->stagedQ, &i);
+    }
+    tarStrEx_init(&pipe->static_seTar, &pipe->tar, pipe, ev_fileInit, ev_dirCreate, ev_recvData, ev_fileFinalize);
+    if (NULL != cfg->archHash)
+    {
+        tarStrEx_set_archiveHash(pipe->tar, cfg->archHash, cfg->archHashCtx);
+    }
+    if (NULL != cfg->commit)
+    {
+        tarStrEx_set_commit(pipe->tar, NULL, ev_commit);
+    }
+
+    if (0 != pthread_create(&pipe->consumer, NULL, consumer_main, pipe))
+    {
+        tarStrPipe_finalize(pipe);
+        return TARSTEX_EFAILURE;
+    }
+    pipe->threads++;
+    if (0 != pthread_create(&pipe->parser, NULL, parser_main, pipe))
+    {
+        tarStrPipe_finalize(pipe);
+        return TARSTEX_EFAILURE;
+    }
+    pipe->threads++;
+    return TARSTEX_ESUCCESS;
+}
+
+int tarStrPipe_process(tarStrPipe_t *pipe, const uint8_t *data, size_t dataSz)
+{
+    const tarStrPipe_cfg_t *cfg = &pipe->cfg;
+    tarStrPipe_chunk_t      chunk;
+    uint8_t                *buf;
+    size_t                  inSz, outSz, room;
+    int                     res;
+
+    do
+    {
+        res = get_error(pipe);
+        if (0 != res)
+        {
+            return res;
+        }
+        queue_pop(&pipe->freeQ, &chunk.bufId);
+        buf       = buffer(pipe, chunk.bufId);
+        chunk.len = 0;
+        /* fill the buffer as long as there are input bytes, or the decoder holds output */
+        while (chunk.len < cfg->bufSz)
+        {
+            room  = cfg->bufSz - chunk.len;
+            inSz  = dataSz;
+            outSz = room;
+            if (NULL != cfg->codec)
+            {
+                res = cfg->codec->run(pipe->codecState, data, &inSz, &buf[chunk.len], &outSz);
+                if (TARSTEX_ESUCCESS != res)
+                {
+                    queue_push(&pipe->freeQ, &chunk.bufId);
+                    set_error(pipe, res);
+                    return res;
+                }
+            }
+            else
+            {
+                inSz = outSz = min(dataSz, room);
+                memcpy(&buf[chunk.len], data, inSz);
+            }
+            data += inSz;
+            dataSz -= inSz;
+            chunk.len += outSz;
+            if (((0 == dataSz) && (outSz < room)) || ((0 == inSz) && (0 == outSz)))
+            {
+                break; /* input exhausted and decoder drained, or no progress possible */
+            }
+        }
+        if (chunk.len > 0)
+        {
+            queue_push(&pipe->chunkQ, &chunk);
+        }
+        else
+        {
+            queue_push(&pipe->freeQ, &chunk.bufId);
+        }
+    } while ((dataSz > 0) || (chunk.len == cfg->bufSz));
+    return TARSTEX_ESUCCESS;
+}
+
+int tarStrPipe_finalize(tarStrPipe_t *pipe)
+{
+    tarStrPipe_chunk_t eos = {.bufId = BUF_EOS, .len = 0};
+
+    if (pipe->threads > 0)
+    {
+        if (pipe->threads > 1)
+        {
+            queue_push(&pipe->chunkQ, &eos);
+            pthread_join(pipe->parser, NULL); /* the parser sends the end of stream event */
+        }
+        else
+        {
+            tarStrPipe_event_t ev = {.kind = EV_EOS};
+            queue_push(&pipe->eventQ, &ev);
+        }
+        pthread_join(pipe->consumer, NULL);
+    }
+    pipe->threads = 0;
+    /* normally ended by the parser, unless it could not be started */
+    if ((NULL != pipe->cfg.codec) && (NULL != pipe->codecState))
+    {
+        if (TARSTEX_ESUCCESS != pipe->cfg.codec->end(pipe->codecState))
+        {
+            set_error(pipe, TARSTEX_EFAILURE); /* the compressed stream was truncated */
+        }
+        pipe->codecState = NULL;
+    }
+    queue_destroy(&pipe->stagedQ);
+    queue_destroy(&pipe->eventQ);
+    queue_destroy(&pipe->chunkQ);
+    queue_destroy(&pipe->freeQ);
+    pthread_mutex_destroy(&pipe->errLock);
+    return pipe->error; /* all the other threads are gone */
+}
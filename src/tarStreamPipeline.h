@@ -0,0 +1,185 @@
+
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TARSTREAMPIPELINE_H
+#define SRC_TARSTREAMPIPELINE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tarStreamDecomp.h"
+#include "tarStreamExtractor.h"
+
+/* maximum number of handoff buffers */
+#ifndef TARSTRPIPE_MAX_BUFS
+#define TARSTRPIPE_MAX_BUFS 32
+#endif
+
+/* number of events that can be waiting for the callback stage */
+#ifndef TARSTRPIPE_EVQ_SZ
+#define TARSTRPIPE_EVQ_SZ 256
+#endif
+
+/* number of blocks staged by the engine, or paths, that can be waiting for the callback stage */
+#ifndef TARSTRPIPE_STAGED_NUM
+#define TARSTRPIPE_STAGED_NUM 16
+#endif
+
+/* room for a block staged by the engine, or a path */
+#define TARSTRPIPE_STAGED_SZ ((TARSTEX_PATH_MAX > 512) ? TARSTEX_PATH_MAX : 512)
+
+/**
+ * @brief configuration of a pipeline
+ * the callbacks have the same meaning as for tarStrEx_init(), and are all called by the callback stage thread.
+ * fileInit may return TARSTEX_CB_SKIP, but not TARSTEX_CB_PASSTHROUGH. Header callbacks are not waited for: the
+ * engine parses a skipped file anyway, and its data are dropped (by the parsing stage, once it learns of the skip)
+ */
+typedef struct tarStrPipe_cfg
+{
+    const tarStrDec_codec_t *codec;     /* decompression algorithm, NULL if the input is not compressed */
+    uint8_t                 *workMem;   /* working memory of the codec */
+    size_t                   workMemSz; /* size of working memory */
+
+    uint8_t *bufMem; /* memory of the handoff buffers: nBufs * bufSz bytes */
+    size_t   bufSz;  /* size of a handoff buffer */
+    unsigned nBufs;  /* number of handoff buffers, 2 to TARSTRPIPE_MAX_BUFS */
+
+    void             *cbParam;
+    cb_fileInit_t     fileInit;
+    cb_dirCreate_t    dirCreate;
+    cb_recvData_t     recvData;
+    cb_fileFinalize_t fileFinalize;
+
+    /* optional digest of the whole archive (see tarStrEx_set_archiveHash()), computed by the parsing stage */
+    const tarStrEx_hash_t *archHash;
+    void                  *archHashCtx;
+    /* optional two-phase mode (see tarStrEx_set_commit()): verify and commit are called by the callback stage, after
+     * the last fileFinalize, and commit is told to discard the files if any stage failed */
+    cb_verify_t verify;
+    cb_commit_t commit;
+} tarStrPipe_cfg_t;
+
+/**
+ * @brief bounded blocking queue of fixed-size elements (private)
+ */
+typedef struct tarStrPipe_queue
+{
+    pthread_mutex_t lock;
+    pthread_cond_t  notEmpty;
+    pthread_cond_t  notFull;
+    uint8_t        *elems;
+    size_t          elemSz;
+    unsigned        capacity;
+    unsigned        head;
+    unsigned        count;
+} tarStrPipe_queue_t;
+
+/**
+ * @brief event handed from the parsing stage to the callback stage (private)
+ */
+typedef struct tarStrPipe_event
+{
+    int            kind;
+    const uint8_t *data; /* data, into a handoff buffer or a staging slot, or path of the member (into a staging slot) */
+    size_t         len;  /* length of data */
+    unsigned       id;   /* handoff buffer released by the event, or staging slot of the data or the path */
+    unsigned       file; /* sequence number of the file (EV_FILE_INIT) */
+} tarStrPipe_event_t;
+
+/**
+ * @brief filled handoff buffer (private)
+ */
+typedef struct tarStrPipe_chunk
+{
+    unsigned bufId;
+    size_t   len;
+} tarStrPipe_chunk_t;
+
+/**
+ * @brief pipeline handle. Members are private
+ */
+typedef struct tarStrPipe
+{
+    tarStrPipe_cfg_t cfg;
+    void            *codecState;
+
+    static_tarStrEx_t static_seTar;
+    tarStrEx_t       *tar;
+    unsigned          curBuf;   /* buffer being parsed */
+    unsigned          fileSeq;  /* sequence number of the file being parsed */
+    unsigned          skipFile; /* sequence number of the last file skipped by fileInit, read by the parser (atomic) */
+    int               drop;     /* the current file is skipped, or its data could not be delivered: not finalized */
+
+    tarStrPipe_queue_t freeQ;   /* empty buffers, to the decompression stage */
+    tarStrPipe_queue_t chunkQ;  /* filled buffers, to the parsing stage */
+    tarStrPipe_queue_t eventQ;  /* events, to the callback stage */
+    tarStrPipe_queue_t stagedQ; /* free staging slots, to the parsing stage */
+    unsigned           freeElems[TARSTRPIPE_MAX_BUFS];
+    tarStrPipe_chunk_t chunkElems[TARSTRPIPE_MAX_BUFS];
+    tarStrPipe_event_t eventElems[TARSTRPIPE_EVQ_SZ];
+    unsigned           stagedElems[TARSTRPIPE_STAGED_NUM];
+    uint8_t            staged[TARSTRPIPE_STAGED_NUM][TARSTRPIPE_STAGED_SZ];
+
+    pthread_t parser;
+    pthread_t consumer;
+    int       threads; /* number of threads started */
+
+    pthread_mutex_t errLock;
+    int             error; /* first error met by any stage */
+} tarStrPipe_t;
+
+/**
+ * @brief initialization function, starts the parsing and the callback stage threads
+ * the calling thread is the decompression stage: it feeds the pipeline with tarStrPipe_process()
+ *
+ * @param pipe pipeline to initialize
+ * @param cfg configuration, copied
+ * @return 0 on success, or a negative value representing fault
+ */
+int tarStrPipe_init(tarStrPipe_t *pipe, const tarStrPipe_cfg_t *cfg);
+
+/**
+ * @brief collect (compressed) data coming from an archive
+ * bytes are decompressed into the handoff buffers, that are parsed and delivered concurrently by the other stages.
+ * Blocks only when all handoff buffers are in use
+ *
+ * @param pipe pointer to pipeline
+ * @param data data array to process
+ * @param dataSz array length of data
+ * @return 0 on success, or a negative value representing fault (of any stage)
+ */
+int tarStrPipe_process(tarStrPipe_t *pipe, const uint8_t *data, size_t dataSz);
+
+/**
+ * @brief finalization function: waits for all the data to be delivered and stops the threads
+ * in two-phase mode the archive is committed, or discarded, before it returns; it is discarded as well when the
+ * compressed stream turns out to be truncated
+ *
+ * @param pipe pointer to pipeline
+ * @return 0 on success, or a negative value representing fault (the first one met by any stage)
+ */
+int tarStrPipe_finalize(tarStrPipe_t *pipe);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_TARSTREAMPIPELINE_H */
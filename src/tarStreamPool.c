@@ -0,0 +1,122 @@
+
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Fixed-capacity pool of engine states. The free slots form a lock-free stack (a Treiber stack): its head holds the
+ * index of the first free slot and a counter incremented on every allocation, so that a slot taken and given back
+ * by another thread in between does not fool the compare-and-swap (the ABA problem).
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tarStreamPool.h"
+
+#define NO_SLOT UINT32_MAX
+
+_Static_assert(offsetof(tarStrPool_slot_t, ctx) == 0, "the engine state must start the slot");
+
+int tarStrPool_init(tarStrPool_t *pool, tarStrPool_slot_t *slots, size_t nSlots)
+{
+    uint32_t i;
+
+    if ((NULL == slots) || (0 == nSlots) || (nSlots >= NO_SLOT))
+    {
+        return TARSTEX_EFAILURE;
+    }
+    for (i = 0; i < nSlots; i++)
+    {
+        slots[i].next = (i + 1 < nSlots) ? i + 1 : NO_SLOT;
+    }
+    pool->cfg.slots      = slots;
+    pool->cfg.nSlots     = (uint32_t)nSlots;
+    pool->free.inUse     = 0;
+    pool->free.highWater = 0;
+    __atomic_store_n(&pool->free.head, 0, __ATOMIC_RELEASE);
+    return TARSTEX_ESUCCESS;
+}
+
+static_tarStrEx_t *tarStrPool_get(tarStrPool_t *pool)
+{
+    uint64_t head = __atomic_load_n(&pool->free.head, __ATOMIC_ACQUIRE);
+    uint64_t next;
+    uint32_t idx;
+    uint32_t inUse;
+    uint32_t high;
+
+    do
+    {
+        idx = (uint32_t)head;
+        if (NO_SLOT == idx)
+        {
+            return NULL; /* exhausted */
+        }
+        /* the slot may be taken by another thread meanwhile: then the counter has changed and the CAS fails */
+        next = (((head >> 32) + 1) << 32) | __atomic_load_n(&pool->cfg.slots[idx].next, __ATOMIC_RELAXED);
+    } while (!__atomic_compare_exchange_n(&pool->free.head, &head, next, 1, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+
+    inUse = __atomic_add_fetch(&pool->free.inUse, 1, __ATOMIC_RELAXED);
+    high  = __atomic_load_n(&pool->free.highWater, __ATOMIC_RELAXED);
+    while ((inUse > high) &&
+           !__atomic_compare_exchange_n(&pool->free.highWater, &high, inUse, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+    return &pool->cfg.slots[idx].ctx;
+}
+
+int tarStrPool_index(const tarStrPool_t *pool, const static_tarStrEx_t *ctx)
+{
+    const tarStrPool_slot_t *slot = (const tarStrPool_slot_t *)ctx;
+
+    if ((slot < pool->cfg.slots) || (slot >= pool->cfg.slots + pool->cfg.nSlots) || (&slot->ctx != ctx))
+    {
+        return TARSTEX_EFAILURE;
+    }
+    return (int)(slot - pool->cfg.slots);
+}
+
+int tarStrPool_put(tarStrPool_t *pool, static_tarStrEx_t *ctx)
+{
+    int      idx  = tarStrPool_index(pool, ctx);
+    uint64_t head = __atomic_load_n(&pool->free.head, __ATOMIC_RELAXED);
+
+    if (idx < 0)
+    {
+        return TARSTEX_EFAILURE;
+    }
+    do
+    {
+        /* the counter is only advanced by allocations: a push cannot be fooled */
+        __atomic_store_n(&pool->cfg.slots[idx].next, (uint32_t)head, __ATOMIC_RELAXED);
+    } while (!__atomic_compare_exchange_n(&pool->free.head, &head, (head & ~(uint64_t)UINT32_MAX) | (uint32_t)idx, 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    __atomic_sub_fetch(&pool->free.inUse, 1, __ATOMIC_RELAXED);
+    return TARSTEX_ESUCCESS;
+}
+
+size_t tarStrPool_size(const tarStrPool_t *pool)
+{
+    return pool->cfg.nSlots;
+}
+
+size_t tarStrPool_inUse(const tarStrPool_t *pool)
+{
+    return __atomic_load_n(&pool->free.inUse, __ATOMIC_RELAXED);
+}
+
+size_t tarStrPool_highWater(const tarStrPool_t *pool)
+{
+    return __atomic_load_n(&pool->free.highWater, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,131 @@
+
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TARSTREAMPOOL_H
+#define SRC_TARSTREAMPOOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tarStreamExtractor.h"
+
+/* granularity of false sharing: every engine state starts on its own cache line */
+#ifndef TARSTRPOOL_CACHELINE
+#define TARSTRPOOL_CACHELINE 64
+#endif
+
+/**
+ * @brief an element of the pool: an engine state, padded to whole cache lines. Members other than ctx are private
+ */
+typedef struct __attribute__((aligned(TARSTRPOOL_CACHELINE))) tarStrPool_slot
+{
+    static_tarStrEx_t ctx;  /* engine state handed out by tarStrPool_get() */
+    uint32_t          next; /* next free slot */
+} tarStrPool_slot_t;
+
+/**
+ * @brief pool handle. Members are private
+ */
+typedef struct tarStrPool
+{
+    /* written by every allocation and release */
+    struct __attribute__((aligned(TARSTRPOOL_CACHELINE)))
+    {
+        uint64_t head;      /* first free slot in the low 32 bits, a counter against ABA in the high ones */
+        uint32_t inUse;     /* slots handed out */
+        uint32_t highWater; /* highest number of slots ever handed out */
+    } free;
+
+    /* read-only after initialization */
+    struct __attribute__((aligned(TARSTRPOOL_CACHELINE)))
+    {
+        tarStrPool_slot_t *slots;
+        uint32_t           nSlots;
+    } cfg;
+} tarStrPool_t;
+
+/**
+ * @brief initialization function
+ * the pool hands out engine states from caller-provided storage, with no dynamic memory. Allocation and release
+ * are lock-free and can be called from any thread
+ *
+ * @param pool pool to initialize
+ * @param slots storage of the engine states
+ * @param nSlots number of elements of slots
+ * @return 0 on success, or a negative value representing fault
+ */
+int tarStrPool_init(tarStrPool_t *pool, tarStrPool_slot_t *slots, size_t nSlots);
+
+/**
+ * @brief take an engine state from the pool, to be passed to tarStrEx_init() (or to any function initializing an
+ * engine, e.g. tarStrDisk_attach())
+ *
+ * @param pool pointer to pool handle
+ * @return engine state, or NULL if all of them are in use
+ */
+static_tarStrEx_t *tarStrPool_get(tarStrPool_t *pool);
+
+/**
+ * @brief give an engine state back to the pool
+ *
+ * @param pool pointer to pool handle
+ * @param ctx engine state obtained from tarStrPool_get()
+ * @return 0 on success, or a negative value if ctx does not belong to the pool
+ */
+int tarStrPool_put(tarStrPool_t *pool, static_tarStrEx_t *ctx);
+
+/**
+ * @brief position of an engine state within the pool, e.g. to index per-connection data kept aside
+ *
+ * @param pool pointer to pool handle
+ * @param ctx engine state obtained from tarStrPool_get()
+ * @return index, from 0 to nSlots - 1, or a negative value if ctx does not belong to the pool
+ */
+int tarStrPool_index(const tarStrPool_t *pool, const static_tarStrEx_t *ctx);
+
+/**
+ * @brief number of engine states of the pool
+ *
+ * @param pool pointer to pool handle
+ * @return number of slots
+ */
+size_t tarStrPool_size(const tarStrPool_t *pool);
+
+/**
+ * @brief number of engine states currently handed out
+ *
+ * @param pool pointer to pool handle
+ * @return number of states in use
+ */
+size_t tarStrPool_inUse(const tarStrPool_t *pool);
+
+/**
+ * @brief highest number of engine states ever handed out, useful to size the pool
+ *
+ * @param pool pointer to pool handle
+ * @return high-water mark
+ */
+size_t tarStrPool_highWater(const tarStrPool_t *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_TARSTREAMPOOL_H */
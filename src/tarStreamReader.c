@@ -0,0 +1,141 @@
+
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The reader never touches the headers: member data is located from the offsets recorded in the index, and lookups
+ * by path go through an open-addressing hash table (linear probing) that stores, for each used slot, the position of
+ * the record within the index plus one. Zero marks an empty slot.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "tarStreamReader.h"
+
+/**
+ * @brief FNV-1a hash of a path
+ *
+ * @param name path
+ * @return hash
+ */
+static uint32_t name_hash(const char *name)
+{
+    uint32_t h = 2166136261u;
+    while ('\0' != *name)
+    {
+        h ^= (uint8_t)*name++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+int tarStrRd_init(tarStrRd_t *rd, const uint8_t *base, size_t len, const tarStrIdx_t *idx, uint32_t *slots,
+                  size_t slotCount)
+{
+    size_t i;
+    size_t mask = slotCount - 1;
+
+    rd->base      = base;
+    rd->len       = len;
+    rd->idx       = idx;
+    rd->slots     = NULL;
+    rd->slotCount = 0;
+
+    if (NULL == slots)
+    {
+        return TARSTEX_ESUCCESS;
+    }
+    /* at least one slot must stay empty, to terminate probing; positions must fit the slots */
+    if ((0 == slotCount) || (0 != (slotCount & mask)) || (idx->count >= slotCount) || (idx->count >= UINT32_MAX))
+    {
+        return TARSTEX_EFAILURE;
+    }
+    memset(slots, 0, slotCount * sizeof(*slots));
+    for (i = 0; i < idx->count; i++)
+    {
+        size_t s;
+
+        if (0 != (idx->entries[i].flags & TARSTRIDX_F_TRUNCATED))
+        {
+            continue; /* not found by path, as with tarStrIdx_find() */
+        }
+        s = name_hash(idx->entries[i].name) & mask;
+        while (0 != slots[s])
+        {
+            if (0 == strcmp(idx->entries[slots[s] - 1].name, idx->entries[i].name))
+            {
+                break; /* the same path appears more than once: as tar does, the last occurrence wins */
+            }
+            s = (s + 1) & mask;
+        }
+        slots[s] = (uint32_t)(i + 1);
+    }
+    rd->slots     = slots;
+    rd->slotCount = slotCount;
+    return TARSTEX_ESUCCESS;
+}
+
+int tarStrRd_view(const tarStrRd_t *rd, size_t pos, const uint8_t **data, size_t *dataSz)
+{
+    const tarStrIdx_entry_t *rec;
+
+    if (pos >= rd->idx->count)
+    {
+        return TARSTEX_EFAILURE;
+    }
+    rec = &rd->idx->entries[pos];
+    /* the engine reports contiguous and old-style regular files as TAR_TYPE_REG */
+    if ((TAR_TYPE_REG != rec->type) && (0 == (rec->flags & TARSTRIDX_F_LINKED)))
+    {
+        return TARSTEX_EFAILURE;
+    }
+    /* the recorded range must lie within the archive memory */
+    if ((rec->dataOffset > rd->len) || (rec->size > rd->len - rec->dataOffset))
+    {
+        return TARSTEX_EFAILURE;
+    }
+    *data   = rd->base + rec->dataOffset;
+    *dataSz = (size_t)rec->size;
+    return TARSTEX_ESUCCESS;
+}
+
+int tarStrRd_lookup(const tarStrRd_t *rd, const char *name, const uint8_t **data, size_t *dataSz)
+{
+    long   pos;
+    size_t mask;
+    size_t s;
+
+    if (NULL == rd->slots)
+    {
+        pos = tarStrIdx_find(rd->idx, name);
+        if (pos < 0)
+        {
+            return TARSTEX_EFAILURE;
+        }
+        return tarStrRd_view(rd, (size_t)pos, data, dataSz);
+    }
+    mask = rd->slotCount - 1;
+    s    = name_hash(name) & mask;
+    while (0 != rd->slots[s])
+    {
+        if (0 == strcmp(rd->idx->entries[rd->slots[s] - 1].name, name))
+        {
+            return tarStrRd_view(rd, rd->slots[s] - 1, data, dataSz);
+        }
+        s = (s + 1) & mask;
+    }
+    return TARSTEX_EFAILURE;
+}
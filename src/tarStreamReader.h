@@ -0,0 +1,88 @@
+
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TARSTREAMREADER_H
+#define SRC_TARSTREAMREADER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tarStreamIndex.h"
+
+/**
+ * @brief random-access reader over an archive entirely available in memory (e.g. mmap'd)
+ * members are located through an index built beforehand (see tarStreamIndex.h), so headers are never parsed again
+ */
+typedef struct tarStrRd
+{
+    const uint8_t     *base;      /* first byte of the archive */
+    size_t             len;       /* length of the archive */
+    const tarStrIdx_t *idx;       /* index of the archive */
+    uint32_t          *slots;     /* optional hash table used to look members up by path */
+    size_t             slotCount; /* number of slots of the hash table (a power of 2) */
+} tarStrRd_t;
+
+/**
+ * @brief initialization function
+ * when a hash table is provided, it is populated here and lookups by path take constant time; otherwise they scan
+ * the index
+ *
+ * @param rd reader to initialize
+ * @param base first byte of the archive
+ * @param len length of the archive
+ * @param idx index of the archive, must outlive the reader
+ * @param slots storage for the hash table, or NULL
+ * @param slotCount number of slots, a power of 2 greater than the number of records of the index
+ * @return 0 on success, or a negative value representing fault
+ */
+int tarStrRd_init(tarStrRd_t *rd, const uint8_t *base, size_t len, const tarStrIdx_t *idx, uint32_t *slots,
+                  size_t slotCount);
+
+/**
+ * @brief get the data of a member, given its position within the index
+ * no copy is made: the view points into the archive memory. Only regular files have a view, hard links resolved by
+ * the index (TARSTRIDX_F_LINKED) giving the data of their target; any other member fails, sparse files included,
+ * since the index does not keep their map and the stored data is not the content of the file
+ *
+ * @param rd reader
+ * @param pos position of the member within the index
+ * @param[out] data pointer to the first data byte
+ * @param[out] dataSz number of data bytes
+ * @return 0 on success, or a negative value representing fault
+ */
+int tarStrRd_view(const tarStrRd_t *rd, size_t pos, const uint8_t **data, size_t *dataSz);
+
+/**
+ * @brief get the data of a member, given its path
+ * no copy is made: the view points into the archive memory. Members are accepted as by tarStrRd_view()
+ *
+ * @param rd reader
+ * @param name path of the member
+ * @param[out] data pointer to the first data byte
+ * @param[out] dataSz number of data bytes
+ * @return 0 on success, or a negative value representing fault (e.g. member not found, or not a regular file)
+ */
+int tarStrRd_lookup(const tarStrRd_t *rd, const char *name, const uint8_t **data, size_t *dataSz);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_TARSTREAMREADER_H */
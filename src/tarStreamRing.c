@@ -0,0 +1,174 @@
+
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Single-producer/single-consumer ring buffer. head and tail are free-running counters: head is only written by the
+ * producer, tail only by the consumer, so that no locks are needed. Each side keeps its own copy of the other
+ * side's counter, refreshed only when the ring looks full (or empty), to limit the traffic between the two cache
+ * lines.
+ */
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "tarStreamRing.h"
+
+#define min(a, b)                                                                                                      \
+    ({                                                                                                                 \
+        typeof(a) _a = (a);                                                                                            \
+        typeof(b) _b = (b);                                                                                            \
+        _a < _b ? _a : _b;                                                                                             \
+    })
+
+_Static_assert(TARSTRRING_CACHELINE >= 32, "cache line size too small");
+
+struct tarStrRing_t
+{
+    /* producer side */
+    struct __attribute__((aligned(TARSTRRING_CACHELINE)))
+    {
+        atomic_size_t head;       /* number of bytes ever written */
+        atomic_size_t highWater;  /* highest level ever seen */
+        size_t        cachedTail; /* last tail seen by the producer */
+    } prod;
+
+    /* consumer side */
+    struct __attribute__((aligned(TARSTRRING_CACHELINE)))
+    {
+        atomic_size_t tail;       /* number of bytes ever processed */
+        size_t        cachedHead; /* last head seen by the consumer */
+    } cons;
+
+    /* read-only after initialization */
+    struct __attribute__((aligned(TARSTRRING_CACHELINE)))
+    {
+        uint8_t    *buff;
+        size_t      mask; /* buffer size - 1 */
+        tarStrEx_t *tar;
+    } cfg;
+};
+
+_Static_assert(sizeof(struct tarStrRing_t) <= sizeof(static_tarStrRing_t),
+               "public structure must be large enough to hold the private one");
+
+int tarStrRing_init(static_tarStrRing_t *static_ring, tarStrRing_t **ring, uint8_t *buff, size_t buffSz,
+                    tarStrEx_t *tar)
+{
+    if ((0 == buffSz) || (0 != (buffSz & (buffSz - 1))))
+    {
+        return TARSTEX_EFAILURE;
+    }
+    *ring                    = (tarStrRing_t *)static_ring;
+    (*ring)->cfg.buff        = buff;
+    (*ring)->cfg.mask        = buffSz - 1;
+    (*ring)->cfg.tar         = tar;
+    (*ring)->prod.cachedTail = 0;
+    (*ring)->cons.cachedHead = 0;
+    atomic_init(&(*ring)->prod.head, 0);
+    atomic_init(&(*ring)->prod.highWater, 0);
+    atomic_init(&(*ring)->cons.tail, 0);
+    return TARSTEX_ESUCCESS;
+}
+
+size_t tarStrRing_reserve(tarStrRing_t *ring, uint8_t **ptr)
+{
+    size_t head   = atomic_load_explicit(&ring->prod.head, memory_order_relaxed);
+    size_t buffSz = ring->cfg.mask + 1;
+    size_t idx    = head & ring->cfg.mask;
+
+    if (buffSz - (head - ring->prod.cachedTail) < buffSz - idx)
+    {
+        /* the free space could be limited by a stale consumer position: refresh it */
+        ring->prod.cachedTail = atomic_load_explicit(&ring->cons.tail, memory_order_acquire);
+    }
+    *ptr = &ring->cfg.buff[idx];
+    /* free space, bounded by the end of the buffer */
+    return min(buffSz - (head - ring->prod.cachedTail), buffSz - idx);
+}
+
+void tarStrRing_commit(tarStrRing_t *ring, size_t dataSz)
+{
+    size_t head = atomic_load_explicit(&ring->prod.head, memory_order_relaxed) + dataSz;
+    size_t level;
+
+    atomic_store_explicit(&ring->prod.head, head, memory_order_release);
+    level = head - ring->prod.cachedTail; /* upper bound of the actual level, exact when the consumer lags behind */
+    if (level > atomic_load_explicit(&ring->prod.highWater, memory_order_relaxed))
+    {
+        ring->prod.cachedTail = atomic_load_explicit(&ring->cons.tail, memory_order_acquire);
+        level                 = head - ring->prod.cachedTail;
+        if (level > atomic_load_explicit(&ring->prod.highWater, memory_order_relaxed))
+        {
+            atomic_store_explicit(&ring->prod.highWater, level, memory_order_relaxed);
+        }
+    }
+}
+
+size_t tarStrRing_write(tarStrRing_t *ring, const uint8_t *data, size_t dataSz)
+{
+    size_t   written = 0;
+    size_t   chunkSz;
+    uint8_t *ptr;
+
+    /* at most two runs: up to the end of the buffer, then from its beginning */
+    while (written < dataSz)
+    {
+        chunkSz = min(tarStrRing_reserve(ring, &ptr), dataSz - written);
+        if (0 == chunkSz)
+        {
+            break; /* full */
+        }
+        memcpy(ptr, &data[written], chunkSz);
+        tarStrRing_commit(ring, chunkSz);
+        written += chunkSz;
+    }
+    return written;
+}
+
+int tarStrRing_pump(tarStrRing_t *ring)
+{
+    size_t tail = atomic_load_explicit(&ring->cons.tail, memory_order_relaxed);
+    size_t idx, chunkSz;
+    int    res;
+
+    ring->cons.cachedHead = atomic_load_explicit(&ring->prod.head, memory_order_acquire);
+    while (tail != ring->cons.cachedHead)
+    {
+        idx     = tail & ring->cfg.mask;
+        chunkSz = min(ring->cons.cachedHead - tail, ring->cfg.mask + 1 - idx);
+        res     = tarStrEx_process_buffer(ring->cfg.tar, &ring->cfg.buff[idx], chunkSz);
+        tail += chunkSz;
+        /* release the space as soon as possible, the producer may be waiting for it */
+        atomic_store_explicit(&ring->cons.tail, tail, memory_order_release);
+        if (TARSTEX_ESUCCESS != res)
+        {
+            return res;
+        }
+    }
+    return TARSTEX_ESUCCESS;
+}
+
+size_t tarStrRing_level(const tarStrRing_t *ring)
+{
+    return atomic_load_explicit(&ring->prod.head, memory_order_acquire) -
+           atomic_load_explicit(&ring->cons.tail, memory_order_acquire);
+}
+
+size_t tarStrRing_highWater(const tarStrRing_t *ring)
+{
+    return atomic_load_explicit(&ring->prod.highWater, memory_order_relaxed);
+}
@@ -0,0 +1,116 @@
+
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TARSTREAMRING_H
+#define SRC_TARSTREAMRING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tarStreamExtractor.h"
+
+/* granularity of false sharing: producer and consumer indexes are kept this far apart. 32 is the minimum, targets
+ * without caches can use it to save memory */
+#ifndef TARSTRRING_CACHELINE
+#define TARSTRRING_CACHELINE 64
+#endif
+
+#define STATIC_TARSTRRING_SZ (3 * TARSTRRING_CACHELINE)
+
+typedef struct __attribute__((aligned(TARSTRRING_CACHELINE))) static_tarStrRing
+{
+    uint8_t dummy[STATIC_TARSTRRING_SZ];
+} static_tarStrRing_t;
+
+typedef struct tarStrRing_t tarStrRing_t;
+
+/**
+ * @brief initialization function
+ * the ring decouples the thread (or interrupt) receiving the stream, the producer, from the one driving the
+ * extraction engine, the consumer. Exactly one producer and one consumer are allowed; no locks are taken
+ *
+ * @param static_ring pointer to struct buffer used to store actual ring handle structure
+ * @param[out] ring pointer to handle pointer do be populated
+ * @param buff memory used to store stream bytes
+ * @param buffSz size of buff, must be a power of 2
+ * @param tar extraction engine fed by the consumer
+ * @return 0 on success, or a negative value representing fault
+ */
+int tarStrRing_init(static_tarStrRing_t *static_ring, tarStrRing_t **ring, uint8_t *buff, size_t buffSz,
+                    tarStrEx_t *tar);
+
+/**
+ * @brief producer side: copy stream bytes into the ring
+ *
+ * @param ring pointer to ring handle
+ * @param data bytes to store
+ * @param dataSz number of bytes to store
+ * @return number of bytes actually stored, less than dataSz if the ring is full
+ */
+size_t tarStrRing_write(tarStrRing_t *ring, const uint8_t *data, size_t dataSz);
+
+/**
+ * @brief producer side: get the contiguous free space of the ring, to receive bytes directly into it
+ * the space must be published by tarStrRing_commit()
+ *
+ * @param ring pointer to ring handle
+ * @param[out] ptr first free byte
+ * @return number of contiguous free bytes from ptr (0 if the ring is full)
+ */
+size_t tarStrRing_reserve(tarStrRing_t *ring, uint8_t **ptr);
+
+/**
+ * @brief producer side: publish bytes written into the space obtained by tarStrRing_reserve()
+ *
+ * @param ring pointer to ring handle
+ * @param dataSz number of bytes written
+ */
+void tarStrRing_commit(tarStrRing_t *ring, size_t dataSz);
+
+/**
+ * @brief consumer side: push all the bytes stored into the ring into the extraction engine
+ * the engine reads straight from the ring memory, no copy is made
+ *
+ * @param ring pointer to ring handle
+ * @return 0 on success, or the negative value returned by the engine
+ */
+int tarStrRing_pump(tarStrRing_t *ring);
+
+/**
+ * @brief number of bytes currently stored into the ring
+ *
+ * @param ring pointer to ring handle
+ * @return number of bytes
+ */
+size_t tarStrRing_level(const tarStrRing_t *ring);
+
+/**
+ * @brief highest number of bytes ever stored into the ring, useful to size it
+ *
+ * @param ring pointer to ring handle
+ * @return high-water mark
+ */
+size_t tarStrRing_highWater(const tarStrRing_t *ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_TARSTREAMRING_H */
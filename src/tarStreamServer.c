@@ -0,0 +1,234 @@
+
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Linux driver serving many connections with a few threads. Every thread owns an epoll instance and the connections
+ * assigned to it, so that the engine of a connection is only touched by one thread and no lock is taken on the data
+ * path. The engine states come from a pool; the records of the connections are indexed as the slots of the pool, so
+ * that the epoll events carry that index only. A single eventfd, never read, wakes all the threads up to stop them.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "tarStreamServer.h"
+
+/* epoll identifier of the wakeup event, never the index of a connection */
+#define WAKE_ID UINT64_MAX
+
+/**
+ * @brief close a connection and give its engine state back to the pool
+ *
+ * @param srv server
+ * @param conn connection
+ * @param res outcome, passed to the done callback
+ */
+static void conn_close(tarStrSrv_t *srv, tarStrSrv_conn_t *conn, int res)
+{
+    int fd  = conn->fd;
+    int err = errno;
+
+    epoll_ctl(srv->threads[conn->thread].epollFd, EPOLL_CTL_DEL, fd, NULL);
+    errno = err; /* as the failure left it */
+    srv->cfg.done(srv->cfg.param, fd, conn->param, res);
+    close(fd);
+    conn->fd = -1;
+    tarStrPool_put(srv->cfg.pool, conn->ctx); /* publishes the record to the next tarStrSrv_add() */
+}
+
+/**
+ * @brief thread serving connections: one read per readable socket, pushed into its engine
+ *
+ * @param arg thread
+ * @return NULL
+ */
+static void *thread_main(void *arg)
+{
+    tarStrSrv_thread_t *thr = (tarStrSrv_thread_t *)arg;
+    tarStrSrv_t        *srv = thr->srv;
+    uint8_t            *buf = srv->cfg.bufMem + (size_t)(thr - srv->threads) * srv->cfg.bufSz;
+    struct epoll_event  ev[TARSTRSRV_EVENTS];
+    tarStrSrv_conn_t   *conn;
+    ssize_t             len;
+    int                 n, i, res;
+
+    for (;;)
+    {
+        n = epoll_wait(thr->epollFd, ev, TARSTRSRV_EVENTS, -1);
+        if ((n < 0) && (EINTR != errno))
+        {
+            return NULL; /* the connections left are closed by tarStrSrv_stop() */
+        }
+        for (i = 0; i < n; i++)
+        {
+            if (WAKE_ID == ev[i].data.u64)
+            {
+                return NULL;
+            }
+            conn = &srv->conns[ev[i].data.u64];
+            len  = read(__atomic_load_n(&conn->fd, __ATOMIC_ACQUIRE), buf, srv->cfg.bufSz);
+            if (len > 0)
+            {
+                res = tarStrEx_process_buffer(conn->tar, buf, (size_t)len);
+                if (TARSTEX_ESUCCESS != res)
+                {
+                    conn_close(srv, conn, res);
+                }
+                else if (tarStrEx_complete(conn->tar))
+                {
+                    /* no need to wait for the peer to close: whatever else it sends is of no interest */
+                    conn_close(srv, conn, tarStrEx_finalize(conn->tar));
+                }
+            }
+            else if (0 == len)
+            {
+                /* the peer has sent everything */
+                conn_close(srv, conn, tarStrEx_finalize(conn->tar));
+            }
+            else if ((EAGAIN != errno) && (EWOULDBLOCK != errno) && (EINTR != errno))
+            {
+                conn_close(srv, conn, TARSTEX_EFAILURE);
+            }
+        }
+    }
+}
+
+int tarStrSrv_init(tarStrSrv_t *srv, const tarStrSrv_cfg_t *cfg, tarStrSrv_conn_t *conns)
+{
+    struct epoll_event ev = {.events = EPOLLIN, .data.u64 = WAKE_ID};
+    tarStrSrv_thread_t *thr;
+    size_t              i;
+
+    if ((0 == cfg->nThreads) || (cfg->nThreads > TARSTRSRV_MAX_THREADS) || (NULL == cfg->pool) ||
+        (NULL == cfg->bufMem) || (0 == cfg->bufSz) || (NULL == cfg->open) || (NULL == cfg->done) ||
+        (NULL == conns))
+    {
+        return TARSTEX_EFAILURE;
+    }
+    memset(srv, 0, sizeof(*srv));
+    srv->cfg    = *cfg;
+    srv->conns  = conns;
+    srv->nConns = tarStrPool_size(cfg->pool);
+    for (i = 0; i < srv->nConns; i++)
+    {
+        conns[i].fd = -1;
+    }
+    for (i = 0; i < TARSTRSRV_MAX_THREADS; i++)
+    {
+        srv->threads[i].epollFd = -1;
+    }
+    srv->wakeFd = eventfd(0, EFD_CLOEXEC);
+    if (srv->wakeFd < 0)
+    {
+        return TARSTEX_EFAILURE;
+    }
+    for (i = 0; i < cfg->nThreads; i++)
+    {
+        thr          = &srv->threads[i];
+        thr->srv     = srv;
+        thr->epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if ((thr->epollFd < 0) || (0 != epoll_ctl(thr->epollFd, EPOLL_CTL_ADD, srv->wakeFd, &ev)) ||
+            (0 != pthread_create(&thr->id, NULL, thread_main, thr)))
+        {
+            tarStrSrv_stop(srv);
+            return TARSTEX_EFAILURE;
+        }
+        srv->nThreads++;
+    }
+    return TARSTEX_ESUCCESS;
+}
+
+int tarStrSrv_add(tarStrSrv_t *srv, int fd)
+{
+    struct epoll_event ev = {.events = EPOLLIN | EPOLLRDHUP};
+    static_tarStrEx_t *ctx;
+    tarStrSrv_conn_t  *conn;
+    int                flags, err;
+
+    flags = fcntl(fd, F_GETFL);
+    if ((flags < 0) || (0 != fcntl(fd, F_SETFL, flags | O_NONBLOCK)))
+    {
+        return TARSTEX_EFAILURE;
+    }
+    ctx = tarStrPool_get(srv->cfg.pool);
+    if (NULL == ctx)
+    {
+        return TARSTEX_ETOOLONG;
+    }
+    ev.data.u64  = (uint64_t)tarStrPool_index(srv->cfg.pool, ctx);
+    conn         = &srv->conns[ev.data.u64];
+    conn->ctx    = ctx;
+    conn->thread = srv->next;
+    srv->next    = (srv->next + 1) % srv->nThreads;
+    if (0 != srv->cfg.open(srv->cfg.param, fd, ctx, &conn->tar, &conn->param))
+    {
+        tarStrPool_put(srv->cfg.pool, ctx);
+        return TARSTEX_EFAILURE;
+    }
+    /* the record is complete before the thread can see an event for it */
+    __atomic_store_n(&conn->fd, fd, __ATOMIC_RELEASE);
+    if (0 != epoll_ctl(srv->threads[conn->thread].epollFd, EPOLL_CTL_ADD, fd, &ev))
+    {
+        err = errno;
+        srv->cfg.done(srv->cfg.param, fd, conn->param, TARSTEX_EFAILURE);
+        conn->fd = -1;
+        tarStrPool_put(srv->cfg.pool, ctx);
+        errno = err;
+        return TARSTEX_EFAILURE;
+    }
+    return TARSTEX_ESUCCESS;
+}
+
+int tarStrSrv_stop(tarStrSrv_t *srv)
+{
+    uint64_t one = 1;
+    size_t   i;
+
+    if ((srv->nThreads > 0) && (sizeof(one) != write(srv->wakeFd, &one, sizeof(one))))
+    {
+        return TARSTEX_EFAILURE; /* the threads cannot be stopped */
+    }
+    for (i = 0; i < srv->nThreads; i++)
+    {
+        pthread_join(srv->threads[i].id, NULL);
+    }
+    srv->nThreads = 0;
+    for (i = 0; i < srv->nConns; i++)
+    {
+        if (srv->conns[i].fd >= 0)
+        {
+            errno = ECANCELED;
+            conn_close(srv, &srv->conns[i], TARSTEX_EFAILURE);
+        }
+    }
+    for (i = 0; i < TARSTRSRV_MAX_THREADS; i++)
+    {
+        if (srv->threads[i].epollFd >= 0)
+        {
+            close(srv->threads[i].epollFd);
+            srv->threads[i].epollFd = -1;
+        }
+    }
+    close(srv->wakeFd);
+    srv->wakeFd = -1;
+    return TARSTEX_ESUCCESS;
+}
@@ -0,0 +1,155 @@
+
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TARSTREAMSERVER_H
+#define SRC_TARSTREAMSERVER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tarStreamExtractor.h"
+#include "tarStreamPool.h"
+
+/* maximum number of threads serving the connections */
+#ifndef TARSTRSRV_MAX_THREADS
+#define TARSTRSRV_MAX_THREADS 64
+#endif
+
+/* maximum number of events handled by a thread per wakeup */
+#ifndef TARSTRSRV_EVENTS
+#define TARSTRSRV_EVENTS 64
+#endif
+
+/**
+ * @brief called when a connection is added, to initialize its engine
+ * the callbacks set on the engine are called by the thread serving the connection
+ *
+ * @param param user parameter
+ * @param fd socket of the connection
+ * @param ctx engine state, taken from the pool
+ * @param[out] tar engine handle, as populated e.g. by tarStrEx_init()
+ * @param[out] connParam parameter passed to the done callback
+ * @return 0 on success
+ */
+typedef int (*tarStrSrv_open_t)(void *param, int fd, static_tarStrEx_t *ctx, tarStrEx_t **tar, void **connParam);
+
+/**
+ * @brief called when a connection is over: the end of the archive has been reached (or the peer closed the
+ * connection) and the engine has been finalized, or an error occurred. The socket is closed and the engine state
+ * given back to the pool afterwards
+ *
+ * @param param user parameter
+ * @param fd socket of the connection
+ * @param connParam parameter set by the open callback
+ * @param res 0 if the archive has been extracted, or a negative value representing fault (errno is set on system
+ * call failures)
+ */
+typedef void (*tarStrSrv_done_t)(void *param, int fd, void *connParam, int res);
+
+/**
+ * @brief configuration of the server driver
+ */
+typedef struct tarStrSrv_cfg
+{
+    unsigned      nThreads; /* threads serving the connections, 1 to TARSTRSRV_MAX_THREADS */
+    tarStrPool_t *pool;     /* engine states of the connections: its size bounds the connections open at once */
+    uint8_t      *bufMem;   /* receive buffers, nThreads * bufSz bytes */
+    size_t       bufSz;     /* size of the receive buffer of a thread */
+
+    tarStrSrv_open_t open;
+    tarStrSrv_done_t done;
+    void            *param; /* parameter passed to open and done */
+} tarStrSrv_cfg_t;
+
+/**
+ * @brief a connection. Members are private
+ */
+typedef struct tarStrSrv_conn
+{
+    int                fd;     /* -1 if the slot is free */
+    unsigned           thread; /* thread serving the connection */
+    static_tarStrEx_t *ctx;    /* engine state, from the pool */
+    tarStrEx_t        *tar;
+    void              *param;
+} tarStrSrv_conn_t;
+
+/**
+ * @brief a thread of the server. Members are private
+ */
+typedef struct tarStrSrv_thread
+{
+    struct tarStrSrv *srv;
+    int               epollFd; /* connections assigned to the thread, and the wakeup event */
+    pthread_t         id;
+} tarStrSrv_thread_t;
+
+/**
+ * @brief server handle. Members are private
+ */
+typedef struct tarStrSrv
+{
+    tarStrSrv_cfg_t    cfg;
+    tarStrSrv_conn_t  *conns;  /* one per slot of the pool, indexed as the slots */
+    size_t             nConns; /* number of slots of the pool */
+    int                wakeFd; /* eventfd, made readable to stop the threads */
+    tarStrSrv_thread_t threads[TARSTRSRV_MAX_THREADS];
+    unsigned           nThreads; /* threads started */
+    unsigned           next;     /* thread the next connection is assigned to */
+} tarStrSrv_t;
+
+/**
+ * @brief initialization function: starts the threads
+ * every thread waits on its own epoll instance for the connections assigned to it, so that a connection, its engine
+ * and its callbacks are only ever handled by one thread, with no locks. Whenever a socket is readable, one read of
+ * up to bufSz bytes is pushed into its engine, so that busy connections do not starve the others
+ *
+ * @param srv server to initialize
+ * @param cfg configuration, copied
+ * @param conns storage of the connections, as many as the slots of the pool (see tarStrPool_size())
+ * @return 0 on success, or a negative value representing fault
+ */
+int tarStrSrv_init(tarStrSrv_t *srv, const tarStrSrv_cfg_t *cfg, tarStrSrv_conn_t *conns);
+
+/**
+ * @brief add a connection, typically just accepted: the server takes ownership of the socket, which is made
+ * non-blocking, and assigns it to a thread, round robin. Can be called from any thread, but by one at a time
+ *
+ * @param srv pointer to server handle
+ * @param fd socket
+ * @return 0 on success, or a negative value representing fault: the socket is then left to the caller, but if the
+ * open callback had succeeded the done callback is called. Fails with TARSTEX_ETOOLONG if the pool is exhausted
+ */
+int tarStrSrv_add(tarStrSrv_t *srv, int fd);
+
+/**
+ * @brief stop the threads and release the resources. The connections still open are closed, and reported to the
+ * done callback with TARSTEX_EFAILURE
+ *
+ * @param srv pointer to server handle
+ * @return 0 on success, or a negative value representing fault
+ */
+int tarStrSrv_stop(tarStrSrv_t *srv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_TARSTREAMSERVER_H */
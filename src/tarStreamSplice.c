@@ -0,0 +1,153 @@
+
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Linux driver for pass-through extraction. Headers and padding are read into a small buffer and pushed into the
+ * engine; once a header announces a file accepted with TARSTEX_CB_PASSTHROUGH, its data is moved from the source to
+ * the output file with splice(), through a pipe, so it never reaches user space. Reads never go past the end of a
+ * header (see tarStrEx_bytes_wanted()), so no payload byte is ever found in the buffer.
+ */
+#define _GNU_SOURCE /* splice(), pipe2(), F_SETPIPE_SZ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "tarStreamSplice.h"
+
+#define TAR_BLOCK_SIZE (512)
+
+/**
+ * @brief move all the bytes held by the pipe to the output file
+ *
+ * @param pipeFd read end of the pipe
+ * @param outFd output file
+ * @param off offset within the output file
+ * @param len number of bytes in the pipe
+ * @return 0 on success, -1 on failure (errno is set)
+ */
+static int pipe_drain(int pipeFd, int outFd, loff_t off, size_t len)
+{
+    ssize_t n;
+
+    while (len > 0)
+    {
+        n = splice(pipeFd, NULL, outFd, &off, len, SPLICE_F_MOVE);
+        if (n > 0)
+        {
+            len -= (size_t)n;
+        }
+        else if (0 == n)
+        {
+            errno = EIO;
+            return -1;
+        }
+        else if (EINTR != errno)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int tarStrSpl_run(tarStrEx_t *tar, const tarStrSpl_cfg_t *cfg)
+{
+    int      pipeFd[2];
+    int      canSplice = 1;
+    int      res       = TARSTEX_ESUCCESS;
+    int      outFd, err;
+    size_t   chunk;
+    ssize_t  n;
+    uint64_t pending, want, fileOff;
+
+    if ((cfg->bufSz < TAR_BLOCK_SIZE) || (0 != pipe2(pipeFd, O_CLOEXEC)))
+    {
+        return TARSTEX_EFAILURE;
+    }
+    /* the larger the pipe, the fewer the splice() calls */
+    n = fcntl(pipeFd[1], F_SETPIPE_SZ, TARSTRSPL_PIPE_SZ);
+    if (n <= 0)
+    {
+        n = fcntl(pipeFd[1], F_GETPIPE_SZ);
+    }
+    chunk = (n > 0) ? (size_t)n : 65536;
+
+    while (TARSTEX_ESUCCESS == res)
+    {
+        pending = tarStrEx_payload_pending(tar, &fileOff);
+        if ((0 != pending) && canSplice)
+        {
+            outFd = cfg->outFd(cfg->outParam);
+            if (outFd < 0)
+            {
+                res = TARSTEX_EFAILURE;
+                break;
+            }
+            n = splice(cfg->inFd, NULL, pipeFd[1], NULL, (pending < chunk) ? (size_t)pending : chunk,
+                       SPLICE_F_MOVE | SPLICE_F_MORE);
+            if (n > 0)
+            {
+                res = (0 == pipe_drain(pipeFd[0], outFd, (loff_t)fileOff, (size_t)n))
+                          ? tarStrEx_payload_consumed(tar, (uint64_t)n)
+                          : TARSTEX_EFAILURE;
+            }
+            else if (0 == n)
+            {
+                break; /* end of the source */
+            }
+            else if (EINVAL == errno)
+            {
+                canSplice = 0; /* the source does not support splice(): nothing moved, read it instead */
+            }
+            else if (EINTR != errno)
+            {
+                res = TARSTEX_EFAILURE;
+            }
+        }
+        else
+        {
+            /* headers, padding, skipped files and files not passed through */
+            want = tarStrEx_bytes_wanted(tar);
+            if (0 == want)
+            {
+                /* the archive is complete (the rest of the source is not read), or the engine is in error */
+                res = tarStrEx_complete(tar) ? TARSTEX_ESUCCESS : TARSTEX_EFAILURE;
+                break;
+            }
+            n = read(cfg->inFd, cfg->buf, (want < cfg->bufSz) ? (size_t)want : cfg->bufSz);
+            if (n > 0)
+            {
+                res = tarStrEx_process_buffer(tar, cfg->buf, (size_t)n);
+            }
+            else if (0 == n)
+            {
+                break; /* end of the source */
+            }
+            else if (EINTR != errno)
+            {
+                res = TARSTEX_EFAILURE;
+            }
+        }
+    }
+
+    err = errno;
+    close(pipeFd[0]);
+    close(pipeFd[1]);
+    errno = err;
+    return res;
+}
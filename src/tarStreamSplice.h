@@ -0,0 +1,74 @@
+
+/*
+ * Copyright 2024 Massimiliano Cialdi
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TARSTREAMSPLICE_H
+#define SRC_TARSTREAMSPLICE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tarStreamExtractor.h"
+
+/* requested capacity of the pipe the payload goes through, the kernel may grant less */
+#ifndef TARSTRSPL_PIPE_SZ
+#define TARSTRSPL_PIPE_SZ (1024 * 1024)
+#endif
+
+/**
+ * @brief tells where the payload of the current file must be written
+ * called while a file accepted with TARSTEX_CB_PASSTHROUGH is being extracted
+ *
+ * @param param user parameter
+ * @return file descriptor of the output file, or a negative value to stop the extraction
+ */
+typedef int (*tarStrSpl_outFd_t)(void *param);
+
+/**
+ * @brief configuration of the splice driver
+ */
+typedef struct tarStrSpl_cfg
+{
+    int               inFd;     /* source of the archive: a socket, a pipe or a file */
+    tarStrSpl_outFd_t outFd;    /* output file of the current member */
+    void             *outParam; /* parameter passed to outFd */
+    uint8_t          *buf;      /* buffer for headers, padding and the data of files not passed through */
+    size_t            bufSz;    /* size of the buffer, at least one tar block (512 bytes) */
+} tarStrSpl_cfg_t;
+
+/**
+ * @brief read an archive from a file descriptor until its end, moving the payload of passthrough files kernel-side
+ * headers and padding are read into the buffer and pushed into the engine, never reading past the end of a header.
+ * The data of files whose fileInit returned TARSTEX_CB_PASSTHROUGH goes from the source to the output file through
+ * a pipe with splice(), without being copied to user space. Other files are read and pushed as usual. If the
+ * descriptors do not support splice() the data is read and delivered to recvData instead.
+ * tarStrEx_finalize() is left to the caller
+ *
+ * @param tar pointer to tar handle
+ * @param cfg configuration
+ * @return 0 once the end of the archive (see tarStrEx_complete()) or of the source has been reached, or a negative
+ * value representing fault (errno is set on system call failures)
+ */
+int tarStrSpl_run(tarStrEx_t *tar, const tarStrSpl_cfg_t *cfg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_TARSTREAMSPLICE_H */